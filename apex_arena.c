@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "apex_arena.h"
+
+/* Takes a zeroed block of at least size bytes from the heap */
+static Arena_Block *
+new_block(size_t size) {
+  Arena_Block *block = calloc(1, sizeof(Arena_Block) + size);
+
+  if (block) {
+    block->size = size;
+  }
+  return block;
+}
+
+/**
+ * Method to create an arena, the arena itself lives at the start of its first block
+ *
+ * @param size - bytes reserved up front, a simulation that fits never goes back to the heap
+ * @return NULL if allocation fails
+ */
+APEX_Arena *
+arena_create(size_t size) {
+  Arena_Block *block = new_block(sizeof(APEX_Arena) + size);
+  APEX_Arena *arena;
+
+  if (!block) {
+    return NULL;
+  }
+  arena = (APEX_Arena *) (block + 1);
+  block->used = sizeof(APEX_Arena);
+  arena->blocks = block;
+  arena->bytes_used = sizeof(APEX_Arena);
+  arena->heap_allocations = 1;
+  return arena;
+}
+
+/**
+ * Method to allocate from an arena, a new block is taken from the heap when the current one is full.
+ * Memory is never reused, so it is always zeroed.
+ *
+ * @param arena - arena of the simulation
+ * @param size - bytes
+ * @param align - power of 2
+ * @return NULL if allocation fails
+ */
+void *
+arena_alloc(APEX_Arena *arena, size_t size, size_t align) {
+  Arena_Block *block = arena->blocks;
+  uintptr_t base = (uintptr_t) (block + 1);
+  uintptr_t start = (base + block->used + align - 1) & ~(uintptr_t) (align - 1);
+
+  if (start + size > base + block->size) {
+    block = new_block((size + align > ARENA_BLOCK_SIZE) ? size + align : ARENA_BLOCK_SIZE);
+    if (!block) {
+      fprintf(stderr, "APEX_Error: Unable to grow the arena by %zu bytes\n", size);
+      return NULL;
+    }
+    block->next = arena->blocks;
+    arena->blocks = block;
+    arena->heap_allocations++;
+
+    base = (uintptr_t) (block + 1);
+    start = (base + align - 1) & ~(uintptr_t) (align - 1);
+  }
+
+  arena->bytes_used += start + size - (base + block->used);
+  block->used = start + size - base;
+  return (void *) start;
+}
+
+/*
+ * Allocates an array from an arena, aligned for any type
+ */
+void *
+arena_calloc(APEX_Arena *arena, size_t count, size_t size) {
+  if (size && count > SIZE_MAX / size) {
+    return NULL;
+  }
+  return arena_alloc(arena, count * size, _Alignof(max_align_t));
+}
+
+/**
+ * Method to free an arena and everything allocated from it
+ *
+ * @param arena - may be NULL
+ */
+void
+arena_destroy(APEX_Arena *arena) {
+  Arena_Block *block;
+
+  if (!arena) {
+    return;
+  }
+  block = arena->blocks;
+  while (block) {
+    Arena_Block *next = block->next;
+
+    /* The arena is in the oldest block, the loop is done once that one is freed */
+    free(block);
+    block = next;
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef _APEX_ARENA_H_
+#define _APEX_ARENA_H_
+
+#include "apex_macros.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Block of an arena, the memory handed out follows the header */
+typedef struct Arena_Block {
+  struct Arena_Block *next;                     /* Older block */
+  size_t size;                                  /* Bytes after the header */
+  size_t used;
+} Arena_Block;
+
+/*
+ * Bump allocator owning everything a simulation allocates. Memory is only given back all at once,
+ * by arena_destroy(), so freeing a simulation costs one free() per block instead of one per object.
+ */
+typedef struct APEX_Arena {
+  Arena_Block *blocks;                          /* Most recent block first, the arena lives in the last */
+  size_t bytes_used;
+  int heap_allocations;                         /* Blocks taken from the heap, the first one included */
+} APEX_Arena;
+
+APEX_Arena *arena_create(size_t size);
+void *arena_alloc(APEX_Arena *arena, size_t size, size_t align);
+void *arena_calloc(APEX_Arena *arena, size_t count, size_t size);
+void arena_destroy(APEX_Arena *arena);
+
+#endif
@@ -0,0 +1,185 @@
+#include <pthread.h>
+#include <time.h>
+#include "apex_batch.h"
+#include "apex_memory.h"
+
+/* Work shared by the threads of the pool */
+typedef struct Batch_Pool {
+  const APEX_Instruction *code_memory;          /* Parsed once, read by every cpu */
+  int code_memory_size;
+  Batch_Run *runs;
+  int num_runs;
+  int next_run;                                 /* Index of the next run to be picked by a thread */
+  int max_cycles;
+  const char *dump_suffix;                      /* Final data memory of a run goes to <image><suffix> */
+  int dump_start;
+  int dump_end;
+  int num_settings;                             /* Applied to every cpu before it runs */
+  const char **settings;
+  pthread_mutex_t lock;                         /* Protects next_run */
+} Batch_Pool;
+
+/* Applies the settings to a scratch cpu, false if any of them is rejected */
+static bool settings_valid(const APEX_Instruction *code_memory, int code_memory_size, int num_settings,
+                           const char **settings) {
+  APEX_CPU *cpu = APEX_cpu_init_from_image(code_memory, code_memory_size);
+  bool valid;
+
+  if (!cpu) {
+    return false;
+  }
+  valid = APEX_cpu_apply_settings(cpu, num_settings, settings);
+  APEX_cpu_stop(cpu);
+  return valid;
+}
+
+static void run_one(Batch_Pool *pool, Batch_Run *run) {
+  APEX_CPU *cpu = APEX_cpu_init_from_image(pool->code_memory, pool->code_memory_size);
+
+  if (!cpu) {
+    return;
+  }
+
+  /* Event mode unless the settings turn it off */
+  cpu->event_driven = TRUE;
+  APEX_cpu_apply_settings(cpu, pool->num_settings, pool->settings);
+  run->loaded = load_data_memory(cpu->data_memory, run->image);
+  if (run->loaded) {
+    run->halted = APEX_cpu_run_to_halt(cpu, pool->max_cycles);
+    run->cycles = cpu->clock;
+    run->insn_completed = cpu->insn_completed;
+
+    if (pool->dump_suffix) {
+      char filename[strlen(run->image) + strlen(pool->dump_suffix) + 1];
+      sprintf(filename, "%s%s", run->image, pool->dump_suffix);
+      dump_data_memory(cpu->data_memory, filename, pool->dump_start, pool->dump_end);
+    }
+  }
+  APEX_cpu_stop(cpu);
+}
+
+static void *batch_worker(void *arg) {
+  Batch_Pool *pool = arg;
+  int index;
+
+  while (TRUE) {
+    pthread_mutex_lock(&pool->lock);
+    index = pool->next_run++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (index >= pool->num_runs) break;
+    run_one(pool, &pool->runs[index]);
+  }
+  return NULL;
+}
+
+static void print_batch_results(Batch_Pool *pool, int num_threads, double seconds) {
+  long total_cycles = 0;
+  int loaded = 0, completed = 0, min_cycles = INT_MAX, max_cycles = 0;
+
+  printf("\n-------------------------------------------------------------------------\n");
+  printf("|   %-32s   %-8s   %-10s   %-8s |\n", "Data Image", "Status", "Cycles", "Retired");
+  printf("-------------------------------------------------------------------------\n");
+
+  for (int i = 0; i < pool->num_runs; i++) {
+    Batch_Run *run = &pool->runs[i];
+    const char *status = !run->loaded ? "error" : (run->halted ? "halted" : "timeout");
+
+    printf("|   %-32.32s   %-8s   %-10d   %-8d |\n", run->image, status, run->cycles, run->insn_completed);
+    if (run->loaded) {
+      loaded++;
+      total_cycles += run->cycles;
+      if (run->cycles < min_cycles) min_cycles = run->cycles;
+      if (run->cycles > max_cycles) max_cycles = run->cycles;
+    }
+    if (run->halted) completed++;
+  }
+
+  printf("-------------------------------------------------------------------------\n");
+  printf("|   Runs : %-5d  Completed : %-5d  Threads : %-5d                    |\n", pool->num_runs, completed,
+         num_threads);
+  if (total_cycles > 0) {
+    printf("|   Cycles  min : %-10d max : %-10d mean : %-14.1f     |\n", min_cycles, max_cycles,
+           (double) total_cycles / loaded);
+  }
+  printf("|   Host time : %-9.3f s  Simulated : %-12.0f cycles/s          |\n", seconds,
+         seconds > 0 ? total_cycles / seconds : 0.0);
+  printf("-------------------------------------------------------------------------\n");
+}
+
+/*
+ * Runs one program against many data memory images on a pool of threads.
+ *
+ * The program is parsed once into a code memory image shared read only by every cpu; each cpu gets
+ * its own data memory loaded from one of the images and runs until HALT has drained or max_cycles.
+ * With a dump_suffix, data memory [dump_start, dump_end) of every run is written to <image><suffix>.
+ *
+ * Returns the number of runs that did not complete
+ */
+int APEX_batch_run(const char *filename, int num_images, const char **images, int num_threads,
+                   int max_cycles, const char *dump_suffix, int dump_start, int dump_end, int num_settings,
+                   const char **settings) {
+  Batch_Pool pool;
+  pthread_t *threads;
+  struct timespec start, end;
+  int failed = 0;
+
+  pool.code_memory = create_code_memory(filename, &pool.code_memory_size);
+  if (!pool.code_memory) {
+    fprintf(stderr, "APEX_Error: Unable to parse %s\n", filename);
+    return num_images;
+  }
+
+  /* Settings are checked once up front, so a bad one fails the batch instead of every run */
+  if (!settings_valid(pool.code_memory, pool.code_memory_size, num_settings, settings)) {
+    free((void *) pool.code_memory);
+    return num_images;
+  }
+
+  pool.runs = calloc(num_images, sizeof(Batch_Run));
+  threads = calloc(num_threads, sizeof(pthread_t));
+  if (!pool.runs || !threads) {
+    free(pool.runs);
+    free(threads);
+    free((void *) pool.code_memory);
+    return num_images;
+  }
+
+  for (int i = 0; i < num_images; i++) {
+    pool.runs[i].image = images[i];
+  }
+  pool.num_runs = num_images;
+  pool.next_run = 0;
+  pool.max_cycles = max_cycles;
+  pool.dump_suffix = dump_suffix;
+  pool.dump_start = dump_start;
+  pool.dump_end = dump_end;
+  pool.num_settings = num_settings;
+  pool.settings = settings;
+  pthread_mutex_init(&pool.lock, NULL);
+
+  fprintf(stderr, "APEX_Batch: %d instructions, %d data images, %d threads\n", pool.code_memory_size,
+          num_images, num_threads);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < num_threads; i++) {
+    pthread_create(&threads[i], NULL, batch_worker, &pool);
+  }
+  for (int i = 0; i < num_threads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  print_batch_results(&pool, num_threads,
+                      (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+  for (int i = 0; i < num_images; i++) {
+    if (!pool.runs[i].halted) failed++;
+  }
+
+  pthread_mutex_destroy(&pool.lock);
+  free(pool.runs);
+  free(threads);
+  free((void *) pool.code_memory);
+  return failed;
+}
@@ -0,0 +1,19 @@
+#ifndef _APEX_BATCH_H_
+#define _APEX_BATCH_H_
+
+#include "apex_cpu.h"
+
+/* Result of running the program against one data memory image */
+typedef struct Batch_Run {
+  const char *image;                            /* Data memory image file */
+  bool loaded;                                  /* Image was read successfully */
+  bool halted;                                  /* Program ran to completion within max_cycles */
+  int cycles;
+  int insn_completed;
+} Batch_Run;
+
+int APEX_batch_run(const char *filename, int num_images, const char **images, int num_threads,
+                   int max_cycles, const char *dump_suffix, int dump_start, int dump_end, int num_settings,
+                   const char **settings);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef _APEX_BITSET_H_
+#define _APEX_BITSET_H_
+
+#include <stdbool.h>
+
+/*
+ * Fixed size sets of small integers, one bit per member packed into 64 bit words. The ROB and the
+ * issue queue keep their hot per-entry state in such sets, so a scan visits a few words instead of
+ * every entry.
+ */
+
+typedef unsigned long long Bitset_Word;
+
+#define BITSET_WORDS(bits) (((bits) + 63) / 64)
+
+static inline void bitset_set(Bitset_Word *set, int i) {
+  set[i / 64] |= 1ULL << (i % 64);
+}
+
+static inline void bitset_clear(Bitset_Word *set, int i) {
+  set[i / 64] &= ~(1ULL << (i % 64));
+}
+
+static inline bool bitset_test(const Bitset_Word *set, int i) {
+  return (set[i / 64] >> (i % 64)) & 1;
+}
+
+/* Smallest member in [from, to), -1 if there is none */
+static inline int bitset_next(const Bitset_Word *set, int from, int to) {
+  while (from < to) {
+    Bitset_Word word = set[from / 64] & (~0ULL << (from % 64));
+
+    if (word) {
+      int i = (from & ~63) + __builtin_ctzll(word);
+      return (i < to) ? i : -1;
+    }
+    from = (from & ~63) + 64;
+  }
+  return -1;
+}
+
+/* Smallest non-member in [from, to), -1 if every one is a member */
+static inline int bitset_next_clear(const Bitset_Word *set, int from, int to) {
+  while (from < to) {
+    Bitset_Word word = ~set[from / 64] & (~0ULL << (from % 64));
+
+    if (word) {
+      int i = (from & ~63) + __builtin_ctzll(word);
+      return (i < to) ? i : -1;
+    }
+    from = (from & ~63) + 64;
+  }
+  return -1;
+}
+
+/* Number of members of a set of the given number of words */
+static inline int bitset_count(const Bitset_Word *set, int words) {
+  int count = 0;
+
+  for (int w = 0; w < words; w++) {
+    count += __builtin_popcountll(set[w]);
+  }
+  return count;
+}
+
+/* Whether two sets have a member in common */
+static inline bool bitset_intersects(const Bitset_Word *a, const Bitset_Word *b, int words) {
+  for (int w = 0; w < words; w++) {
+    if (a[w] & b[w]) return true;
+  }
+  return false;
+}
+
+/* Removes the members of other from set */
+static inline void bitset_remove(Bitset_Word *set, const Bitset_Word *other, int words) {
+  for (int w = 0; w < words; w++) {
+    set[w] &= ~other[w];
+  }
+}
+
+#endif
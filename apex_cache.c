@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include "apex_cache.h"
+
+/**
+ * Method to allocate the lines of a cache, all lines start invalid
+ *
+ * @param cache pointer to the cache to be initialized
+ * @param arena - arena the lines are allocated from
+ * @param sets - number of sets
+ * @param ways - associativity
+ * @return false if lines could not be allocated
+ */
+bool cache_init(APEX_Cache *cache, APEX_Arena *arena, int sets, int ways) {
+  cache->sets = sets;
+  cache->ways = ways;
+  cache->stamp = 0;
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->evictions = 0;
+  cache->writebacks = 0;
+  cache->last_access = ACCESS_HIT;
+  cache->prefetch_hits = 0;
+  cache->prefetch_late = 0;
+  cache->prefetch_unused = 0;
+  cache->lines = arena_calloc(arena, sets * ways, sizeof(Cache_Line));
+  return cache->lines != NULL;
+}
+
+/**
+ * Method to convert a data memory address into the address of the line holding it
+ *
+ * @param address - data memory address
+ * @return line address
+ */
+int cache_line_address(int address) {
+  return address / CACHE_LINE_SIZE;
+}
+
+/**
+ * Method to look up a line, does not update LRU or hit/miss counters
+ *
+ * @param cache pointer to the cache
+ * @param line_address - address of the line
+ * @return pointer to the line if present in a valid state, NULL otherwise
+ */
+Cache_Line *cache_find(APEX_Cache *cache, int line_address) {
+  Cache_Line *set = &cache->lines[(line_address % cache->sets) * cache->ways];
+
+  for (int i = 0; i < cache->ways; i++) {
+    if (set[i].state != LINE_INVALID && set[i].tag == line_address) return &set[i];
+  }
+  return NULL;
+}
+
+/**
+ * Method to find the line that a new tag would replace, an invalid way is preferred over the least
+ * recently used one. Nothing is changed, so the victim can be written back before cache_allocate().
+ *
+ * @param cache pointer to the cache
+ * @param line_address - address of the line to be filled
+ * @return pointer to the victim line
+ */
+Cache_Line *cache_victim(APEX_Cache *cache, int line_address) {
+  Cache_Line *set = &cache->lines[(line_address % cache->sets) * cache->ways];
+  Cache_Line *victim = &set[0];
+
+  for (int i = 0; i < cache->ways; i++) {
+    if (set[i].state == LINE_INVALID) {
+      return &set[i];
+    }
+    if (set[i].lru < victim->lru) victim = &set[i];
+  }
+  return victim;
+}
+
+/**
+ * Method to pick a line for a new tag, see cache_victim().
+ * The caller is responsible for notifying others about the victim before overwriting its state.
+ *
+ * @param cache pointer to the cache
+ * @param line_address - address of the line to be filled
+ * @return pointer to the victim line, tag is already set to line_address
+ */
+Cache_Line *cache_allocate(APEX_Cache *cache, int line_address) {
+  Cache_Line *victim = cache_victim(cache, line_address);
+
+  if (victim->state != LINE_INVALID) {
+    cache->evictions++;
+    if (victim->state == LINE_MODIFIED) cache->writebacks++;
+    if (victim->prefetched) cache->prefetch_unused++;
+  }
+
+  victim->tag = line_address;
+  victim->state = LINE_INVALID;
+  victim->prefetched = FALSE;
+  cache_touch(cache, victim);
+  return victim;
+}
+
+void cache_touch(APEX_Cache *cache, Cache_Line *line) {
+  line->lru = ++cache->stamp;
+}
+
+/**
+ * Method to account for a demand access that found its line, the first use of a prefetched line
+ * counts as a prefetch hit, a late one if the fill had not completed by then
+ *
+ * @param cache pointer to the cache
+ * @param line - line found by cache_find()
+ * @param clock - cycle of the access
+ */
+void cache_hit(APEX_Cache *cache, Cache_Line *line, int clock) {
+  cache->hits++;
+  cache->last_access = ACCESS_HIT;
+  cache_touch(cache, line);
+
+  if (line->prefetched) {
+    line->prefetched = FALSE;
+    cache->prefetch_hits++;
+    if (line->ready > clock) cache->prefetch_late++;
+    cache->last_access = ACCESS_PREFETCH_HIT;
+  }
+}
+
+void cache_miss(APEX_Cache *cache) {
+  cache->misses++;
+  cache->last_access = ACCESS_MISS;
+}
+
+/**
+ * Method to fill a line on behalf of a prefetcher, the line is not counted as an access
+ *
+ * @param cache pointer to the cache
+ * @param line_address - address of the line, must not be present
+ * @param state - coherence state of the new line
+ * @param ready - cycle the fill completes
+ * @return pointer to the filled line
+ */
+Cache_Line *cache_prefetch_fill(APEX_Cache *cache, int line_address, int state, int ready) {
+  Cache_Line *line = cache_allocate(cache, line_address);
+
+  line->state = state;
+  line->prefetched = TRUE;
+  line->ready = ready;
+  return line;
+}
+
+void print_cache_stats(APEX_Cache *cache, const char *name) {
+  int accesses = cache->hits + cache->misses;
+
+  printf("|   %-6s hits: %-6d misses: %-6d hit rate: %5.1f%% |\n", name, cache->hits, cache->misses,
+         accesses ? (100.0 * cache->hits / accesses) : 0.0);
+  printf("|          evictions: %-6d writebacks: %-6d         |\n", cache->evictions, cache->writebacks);
+}
@@ -0,0 +1,58 @@
+#ifndef _APEX_CACHE_H_
+#define _APEX_CACHE_H_
+
+#include "apex_macros.h"
+#include "apex_arena.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* Coherence state of a cache line (MESI) */
+#define LINE_INVALID 0x0
+#define LINE_SHARED 0x1
+#define LINE_EXCLUSIVE 0x2
+#define LINE_MODIFIED 0x3
+
+/* Outcome of a demand access, trains the prefetcher of the cache */
+#define ACCESS_HIT 0x0
+#define ACCESS_MISS 0x1
+#define ACCESS_PREFETCH_HIT 0x2                 /* First use of a line brought in by a prefetcher */
+
+/* Tag-only model of a cache line, data always lives in data memory */
+typedef struct Cache_Line {
+  int tag;                                      /* Line address (address / CACHE_LINE_SIZE) */
+  int state;                                    /* {LINE_INVALID, LINE_SHARED, LINE_EXCLUSIVE, LINE_MODIFIED} */
+  int lru;                                      /* Access stamp, lowest in the set is evicted first */
+  int prefetched;                               /* Filled by a prefetcher and not used by a demand access yet */
+  int ready;                                    /* Cycle the fill of a prefetched line completes */
+} Cache_Line;
+
+/* Model of a set associative cache */
+typedef struct APEX_Cache {
+  int sets;
+  int ways;
+  int stamp;                                    /* Next LRU stamp */
+  Cache_Line *lines;                            /* sets * ways lines, way-major within a set */
+
+  int hits;
+  int misses;
+  int evictions;
+  int writebacks;                               /* Evicted or downgraded lines in MODIFIED state */
+
+  int last_access;                              /* ACCESS_* outcome of the latest demand access */
+  int prefetch_hits;                            /* Demand accesses that were the first use of a prefetched line */
+  int prefetch_late;                            /* ... that came before the fill had completed */
+  int prefetch_unused;                          /* Prefetched lines evicted before any demand access */
+} APEX_Cache;
+
+bool cache_init(APEX_Cache *cache, APEX_Arena *arena, int sets, int ways);
+int cache_line_address(int address);
+Cache_Line *cache_find(APEX_Cache *cache, int line_address);
+Cache_Line *cache_victim(APEX_Cache *cache, int line_address);
+Cache_Line *cache_allocate(APEX_Cache *cache, int line_address);
+void cache_touch(APEX_Cache *cache, Cache_Line *line);
+void cache_hit(APEX_Cache *cache, Cache_Line *line, int clock);
+void cache_miss(APEX_Cache *cache);
+Cache_Line *cache_prefetch_fill(APEX_Cache *cache, int line_address, int state, int ready);
+void print_cache_stats(APEX_Cache *cache, const char *name);
+
+#endif
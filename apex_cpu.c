@@ -1,5 +1,200 @@
 #include "apex_cpu.h"
 #include "apex_macros.h"
+#include "apex_system.h"
+#include "apex_memory.h"
+#include "apex_isa.h"
+#include "apex_jit.h"
+#include "apex_replay.h"
+#include "apex_snapshot.h"
+#include "apex_prefetch.h"
+#include "apex_hierarchy.h"
+
+/*
+ * Data memory accesses, a core of a multi-core system reads and writes the shared data memory. Only the
+ * value is read or written here, M2 times the access and makes its bus transaction with
+ * start_data_access() and the functional model does not time it at all.
+ */
+int
+read_data_memory(APEX_CPU *cpu, int address) {
+  if (cpu->system) {
+    return APEX_system_load(cpu->system, address);
+  }
+  return memory_read(cpu->data_memory, address);
+}
+
+void
+write_data_memory(APEX_CPU *cpu, int address, int value) {
+  if (cpu->system) {
+    APEX_system_store(cpu->system, address, value);
+    return;
+  }
+  memory_write(cpu->data_memory, address, value);
+}
+
+/**
+ * Method to time the data access of the memory instruction in M2 through the cache hierarchy, or
+ * through the coherent L1 and the bus for a core of a multi-core system, and to train the data
+ * prefetcher with it.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param stage - M2 latch
+ * @return cycles the access keeps M2 busy, 1 for an L1 hit
+ */
+static int
+start_data_access(APEX_CPU *cpu, const CPU_Stage *stage) {
+  int address = stage->memory_address;
+  bool is_write = (stage->opcode == OPCODE_STORE || stage->opcode == OPCODE_STR);
+  int latency;
+
+  if (address < 0 || address >= DATA_MEMORY_SIZE) {
+    return 1;
+  }
+
+  if (cpu->system) {
+    latency = APEX_system_access(cpu->system, cpu->core_id, address, is_write, cpu->clock);
+  } else if (cpu->caches == CACHES_NONE) {
+    return 1;
+  } else {
+    latency = hierarchy_access(cpu->hierarchy, LEVEL_L1D, cache_line_address(address), is_write, cpu->clock);
+    hierarchy_record_latency(cpu->hierarchy, latency);
+  }
+  if (cpu->data_prefetcher) {
+    prefetch_train(cpu->data_prefetcher, stage->pc, address, cpu->l1d->last_access);
+  }
+  return latency;
+}
+
+/* Fill of the data prefetcher, over the bus for a core of a multi-core system */
+static bool
+prefetch_data_line(APEX_CPU *cpu, int line_address) {
+  if (cpu->system) {
+    return APEX_system_prefetch(cpu->system, cpu->core_id, line_address, cpu->clock);
+  }
+  return hierarchy_prefetch(cpu->hierarchy, LEVEL_L1D, line_address, cpu->clock) >= 0;
+}
+
+/* Fill of the instruction prefetcher, lines are numbered from the start of code memory */
+static bool
+prefetch_code_line(APEX_CPU *cpu, int line_address) {
+  return hierarchy_prefetch(cpu->hierarchy, LEVEL_L1I, CODE_LINE_BASE + line_address, cpu->clock) >= 0;
+}
+
+/**
+ * Method to find out if the line of the instruction in fetch has arrived in L1I. The line is accessed
+ * once when fetch moves on to it, lines hold CACHE_LINE_SIZE instructions.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param pc - of the instruction in fetch
+ * @return false while fetch waits for a miss
+ */
+static bool
+fetch_line_ready(APEX_CPU *cpu, int pc) {
+  int index = get_code_memory_index_from_pc(pc);
+  int line_address = cache_line_address(index);
+
+  if (pc < 4000 || index >= cpu->code_memory_size) {
+    return true;
+  }
+
+  if (line_address != cpu->fetch_line) {
+    int latency = hierarchy_access(cpu->hierarchy, LEVEL_L1I, CODE_LINE_BASE + line_address, false, cpu->clock);
+
+    cpu->fetch_line = line_address;
+    cpu->fetch_ready = cpu->clock + latency - 1;
+    if (cpu->inst_prefetcher) {
+      prefetch_train(cpu->inst_prefetcher, pc, index, cpu->l1i->last_access);
+    }
+  }
+  return cpu->clock >= cpu->fetch_ready;
+}
+
+/**
+ * Method to copy the micro-op at a pc into a stage latch, any pc outside of code memory reads as HALT
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param stage - latch to be filled in
+ * @param pc - of the instruction
+ */
+static void
+load_uop(APEX_CPU *cpu, CPU_Stage *stage, int pc) {
+  int index = get_code_memory_index_from_pc(pc);
+  const APEX_Uop *uop = (pc >= 4000 && index < cpu->code_memory_size) ? &cpu->uops[index] : &halt_uop;
+
+  stage->pc = pc;
+  stage->opcode = uop->opcode;
+  stage->opcode_str = opcode_info[uop->opcode].name;
+  stage->operands = uop->operands;
+  stage->function_unit = uop->function_unit;
+  stage->rd = uop->rd;
+  stage->rs1 = uop->rs1;
+  stage->rs2 = uop->rs2;
+  stage->rs3 = uop->rs3;
+  stage->imm = uop->imm;
+  stage->eliminated = ELIMINATED_NONE;
+  stage->fused = FUSE_NONE;
+  stage->fused_rd = -1;
+  stage->fused_rd_arch = -1;
+  stage->flag_rs = -1;
+  stage->flag_rd = -1;
+}
+
+/* Name a fused micro-op is shown with */
+static const char *
+fused_name(int opcode, int fused_opcode) {
+  bool bz = (fused_opcode == OPCODE_BZ);
+
+  switch (opcode) {
+    case OPCODE_CMP: return bz ? "CMP+BZ" : "CMP+BNZ";
+    case OPCODE_SUB: return bz ? "SUB+BZ" : "SUB+BNZ";
+    case OPCODE_SUBL: return bz ? "SUBL+BZ" : "SUBL+BNZ";
+    default: return "ADDL+LOAD";
+  }
+}
+
+/**
+ * Method to merge the instruction after the one in fetch into it, if the pair matches one of the fusion
+ * rules. Both have to be in the same line of code memory, so that a single access fetches them.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param stage - fetch, holding the first instruction of the pair
+ * @return true if the next instruction has been fused, fetch moves on past it
+ */
+static bool
+fuse_next_uop(APEX_CPU *cpu, CPU_Stage *stage) {
+  int index = get_code_memory_index_from_pc(stage->pc);
+  const APEX_Uop *next;
+
+  if (stage->pc < 4000 || index + 1 >= cpu->code_memory_size) {
+    return false;
+  }
+  if (cpu->caches != CACHES_NONE && cache_line_address(index) != cache_line_address(index + 1)) {
+    return false;
+  }
+  next = &cpu->uops[index + 1];
+
+  if ((cpu->fusion & FUSE_COMPARE_BRANCH) && alu_sets_zero_flag(stage->opcode)
+      && (next->opcode == OPCODE_BZ || next->opcode == OPCODE_BNZ)) {
+    stage->fused = FUSE_COMPARE_BRANCH;
+    stage->fused_opcode = next->opcode;
+    stage->fused_imm = next->imm;
+  } else if ((cpu->fusion & FUSE_ADDRESS_LOAD) && stage->opcode == OPCODE_ADDL
+             && next->opcode == OPCODE_LOAD && next->rs1 == stage->rd) {
+    /* Becomes the LOAD, with the source of the ADDL as base and the destinations of both */
+    stage->fused = FUSE_ADDRESS_LOAD;
+    stage->fused_opcode = OPCODE_ADDL;
+    stage->fused_imm = stage->imm;
+    stage->fused_rd = stage->rd;
+    stage->opcode = next->opcode;
+    stage->operands = next->operands;
+    stage->function_unit = next->function_unit;
+    stage->rd = next->rd;
+    stage->imm = next->imm;
+  } else {
+    return false;
+  }
+  stage->opcode_str = fused_name(stage->opcode, stage->fused_opcode);
+  return true;
+}
 
 /*
  * Fetch Stage of APEX Pipeline
@@ -8,29 +203,14 @@
  */
 static void
 APEX_fetch(APEX_CPU *cpu) {
-  APEX_Instruction *current_ins;
-
   if (cpu->fetch.has_insn) {
+    /* Store current PC in fetch latch along with the pre-decoded instruction */
+    load_uop(cpu, &cpu->fetch, cpu->pc);
+
     /* This fetches new branch target instruction from next cycle */
     if (cpu->fetch_from_next_cycle == TRUE) {
       cpu->fetch_from_next_cycle = FALSE;
 
-      /* Store current PC in fetch latch */
-      cpu->fetch.pc = cpu->pc;
-
-      /* Index into code memory using this pc and copy all instruction fields
-       * into fetch latch  */
-      current_ins = &cpu->code_memory[get_code_memory_index_from_pc(cpu->pc)];
-      // printf("opcode_str: %s\n", current_ins->opcode_str);
-      strcpy(cpu->fetch.opcode_str, current_ins->opcode_str);
-      cpu->fetch.opcode = current_ins->opcode;
-      cpu->fetch.rd = current_ins->rd;
-      cpu->fetch.rs1 = current_ins->rs1;
-      cpu->fetch.rs2 = current_ins->rs2;
-      cpu->fetch.rs3 = current_ins->rs3;
-      cpu->fetch.imm = current_ins->imm;
-
-      /* Update PC for next instruction */
       if (cpu->debug_messages) {
         print_stage_content("Fetch", &cpu->fetch);
       }
@@ -38,23 +218,13 @@ APEX_fetch(APEX_CPU *cpu) {
       return;
     }
 
-    /* Store current PC in fetch latch */
-    cpu->fetch.pc = cpu->pc;
-
-    /* Index into code memory using this pc and copy all instruction fields
-     * into fetch latch  */
-    current_ins = &cpu->code_memory[get_code_memory_index_from_pc(cpu->pc)];
-    // printf("opcode_str: %s\n", current_ins->opcode_str);
-    strcpy(cpu->fetch.opcode_str, current_ins->opcode_str);
-    cpu->fetch.opcode = current_ins->opcode;
-    cpu->fetch.rd = current_ins->rd;
-    cpu->fetch.rs1 = current_ins->rs1;
-    cpu->fetch.rs2 = current_ins->rs2;
-    cpu->fetch.rs3 = current_ins->rs3;
-    cpu->fetch.imm = current_ins->imm;
+    /* Instruction waits in fetch until its line is in L1I */
+    if (cpu->caches != CACHES_NONE && !fetch_line_ready(cpu, cpu->pc)) {
+      return;
+    }
 
-    /* Update PC for next instruction */
-    cpu->pc += 4;
+    /* Update PC for next instruction, past both instructions of a fused pair */
+    cpu->pc += (cpu->fusion && fuse_next_uop(cpu, &cpu->fetch)) ? 8 : 4;
 
     /* Copy data from fetch latch to decode latch*/
     cpu->decode = cpu->fetch;
@@ -70,188 +240,247 @@ APEX_fetch(APEX_CPU *cpu) {
   }
 }
 
-/*
- * Decode Stage of APEX Pipeline
+/**
+ * Method to map an architectural source register to its physical register. This is the only lookup of
+ * the scoreboard (status[]) for the source, the value is read right away if it has already been written.
  *
- * Note: You are free to edit this function according to your implementation
+ * @param cpu pointer to current instance of cpu
+ * @param rs - source register, replaced by the physical register
+ * @param rs_value - set to the value of the register if it is available
+ * @param operand - OPERAND_RS* bit of the source
+ * @return operand if the source is available, 0 otherwise
  */
-static void
-APEX_decode(APEX_CPU *cpu) {
-  if (cpu->decode.has_insn) {
-    if (find_free_register(cpu) == -1) {
-      cpu->fetch_from_next_cycle = TRUE;
-    } else {
-      /* Read operands from register file based on the instruction type */
-      switch (cpu->decode.opcode) {
-        case OPCODE_ADD:
-        case OPCODE_SUB:
-        case OPCODE_MUL:
-        case OPCODE_AND:
-        case OPCODE_OR:
-        case OPCODE_EXOR: {
-
-          cpu->decode.rs1 = cpu->rat[cpu->decode.rs1];
-          cpu->decode.rs2 = cpu->rat[cpu->decode.rs2];
-
-          int physical_register = find_free_register(cpu);
-          if (physical_register != -1) {
-            cpu->decode.rd_arch = cpu->decode.rd;
-            cpu->decode.rd = physical_register;
-            cpu->rat[cpu->decode.rd_arch] = physical_register;
-            cpu->rat_status[cpu->decode.rd_arch] = 1;
-            cpu->allocation_list[physical_register] = 1;
-          }
-
-          if (cpu->status[cpu->decode.rs1] == 1 && cpu->allocation_list[cpu->decode.rs1] == 1)
-            cpu->decode.rs1_value = cpu->regs[cpu->decode.rs1];
-
-          if (cpu->status[cpu->decode.rs2] == 1 && cpu->allocation_list[cpu->decode.rs2] == 1)
-            cpu->decode.rs2_value = cpu->regs[cpu->decode.rs2];
-
-          cpu->status[cpu->decode.rd] = 0;
-          break;
-        }
+static int
+rename_source(APEX_CPU *cpu, int *rs, int *rs_value, int operand) {
+  *rs = cpu->rat[*rs];
 
-        case OPCODE_CMP: {
-
-          cpu->decode.rs1 = cpu->rat[cpu->decode.rs1];
-          cpu->decode.rs2 = cpu->rat[cpu->decode.rs2];
-
-          if (cpu->status[cpu->decode.rs1] == 1 && cpu->allocation_list[cpu->decode.rs1] == 1)
-            cpu->decode.rs1_value = cpu->regs[cpu->decode.rs1];
-
-          if (cpu->status[cpu->decode.rs2] == 1 && cpu->allocation_list[cpu->decode.rs2] == 1)
-            cpu->decode.rs2_value = cpu->regs[cpu->decode.rs2];
-
-          break;
-        }
-
-        case OPCODE_ADDL:
-        case OPCODE_SUBL: {
-
-          cpu->decode.rs1 = cpu->rat[cpu->decode.rs1];
-
-          int physical_register = find_free_register(cpu);
-          if (physical_register != -1) {
-            cpu->decode.rd_arch = cpu->decode.rd;
-            cpu->decode.rd = physical_register;
-            cpu->rat[cpu->decode.rd_arch] = physical_register;
-            cpu->rat_status[cpu->decode.rd_arch] = 1;
-            cpu->allocation_list[physical_register] = 1;
-          }
-
-          if (cpu->status[cpu->decode.rs1] == 1 && cpu->allocation_list[cpu->decode.rs1] == 1)
-            cpu->decode.rs1_value = cpu->regs[cpu->decode.rs1];
-
-          cpu->status[cpu->decode.rd] = 0;
-          break;
-        }
+  if (!cpu->status[*rs]) {
+    return 0;
+  }
+  *rs_value = cpu->regs[*rs];
+  return operand;
+}
 
-        case OPCODE_LOAD: {
-          cpu->decode.rs1 = cpu->rat[cpu->decode.rs1];
+/**
+ * Method to find out if the result of an instruction is known before it executes, from its opcode and
+ * the constants in the register file. Instructions that set the zero flag always execute. Called
+ * before renaming, the sources are still architectural registers.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param stage - decode, result_buffer is set to the result
+ * @return ELIMINATED_* kind, ELIMINATED_NONE if the instruction has to execute
+ */
+static int
+eliminate_at_rename(APEX_CPU *cpu, CPU_Stage *stage) {
+  int opcode = stage->opcode;
+  int rs1, rs2, value1, value2;
+  bool constant1, constant2;
+  int move = -1;
+
+  switch (opcode) {
+    case OPCODE_MOVC:
+      stage->result_buffer = stage->imm;
+      return ELIMINATED_CONSTANT;
+    case OPCODE_ADD:
+    case OPCODE_ADDL:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_EXOR:
+    case OPCODE_MUL:
+      break;
+    default:
+      return ELIMINATED_NONE;
+  }
 
-          int physical_register = find_free_register(cpu);
-          if (physical_register != -1) {
-            cpu->decode.rd_arch = cpu->decode.rd;
-            cpu->decode.rd = physical_register;
-            cpu->rat[cpu->decode.rd_arch] = physical_register;
-            cpu->rat_status[cpu->decode.rd_arch] = 1;
-            cpu->allocation_list[physical_register] = 1;
-          }
+  /* ADDL has no second register, it reads as a constant */
+  rs1 = cpu->rat[stage->rs1];
+  rs2 = (stage->operands & OPERAND_RS2) ? cpu->rat[stage->rs2] : -1;
+  constant1 = cpu->constant[rs1];
+  constant2 = (rs2 == -1) || cpu->constant[rs2];
+  value1 = cpu->regs[rs1];
+  value2 = (rs2 == -1) ? 0 : cpu->regs[rs2];
+
+  stage->result_buffer = 0;
+  if (opcode == OPCODE_EXOR && rs1 == rs2) return ELIMINATED_ZERO_IDIOM;
+  if ((opcode == OPCODE_AND || opcode == OPCODE_MUL)
+      && ((constant1 && value1 == 0) || (rs2 != -1 && constant2 && value2 == 0))) {
+    return ELIMINATED_ZERO_IDIOM;
+  }
 
-          cpu->status[cpu->decode.rd] = 0;
-          break;
-        }
+  if (constant1 && constant2) {
+    stage->result_buffer = alu_result(opcode, value1, value2, stage->imm);
+    return ELIMINATED_FOLDED;
+  }
 
-        case OPCODE_LDR: {
-          cpu->decode.rs1 = cpu->rat[cpu->decode.rs1];
-          cpu->decode.rs2 = cpu->rat[cpu->decode.rs2];
-
-          int physical_register = find_free_register(cpu);
-          if (physical_register != -1) {
-            cpu->decode.rd_arch = cpu->decode.rd;
-            cpu->decode.rd = physical_register;
-            cpu->rat[cpu->decode.rd_arch] = physical_register;
-            cpu->rat_status[cpu->decode.rd_arch] = 1;
-            cpu->allocation_list[physical_register] = 1;
-          }
-
-          cpu->status[cpu->decode.rd] = 0;
-          break;
-        }
+  /* Moves, the value of the source is copied once it has been written */
+  if ((opcode == OPCODE_AND || opcode == OPCODE_OR) && rs1 == rs2) {
+    move = rs1;
+  } else if (opcode == OPCODE_ADDL) {
+    move = (stage->imm == 0) ? rs1 : -1;
+  } else if (opcode == OPCODE_MUL) {
+    move = (constant2 && value2 == 1) ? rs1 : (constant1 && value1 == 1) ? rs2 : -1;
+  } else if (opcode != OPCODE_AND) {
+    move = (constant2 && value2 == 0) ? rs1 : (constant1 && value1 == 0) ? rs2 : -1;
+  }
+  if (move != -1 && cpu->status[move]) {
+    stage->result_buffer = cpu->regs[move];
+    return ELIMINATED_MOVE;
+  }
+  return ELIMINATED_NONE;
+}
 
-        case OPCODE_STR: {
-          cpu->decode.rs1 = cpu->rat[cpu->decode.rs1];
-          cpu->decode.rs2 = cpu->rat[cpu->decode.rs2];
-          cpu->decode.rs3 = cpu->rat[cpu->decode.rs3];
+/*
+ * Checks that count physical registers are free
+ */
+static bool
+registers_available(APEX_CPU *cpu, int count) {
+  for (int i = 0; i < REG_FILE_SIZE && count > 0; i++) {
+    if (cpu->allocation_list[i] == 0) count--;
+  }
+  return count == 0;
+}
 
-          break;
-        }
+/**
+ * Method to map an architectural destination register to a free physical register
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param rd_arch - destination register
+ * @return physical register, not written yet
+ */
+static int
+rename_destination(APEX_CPU *cpu, int rd_arch) {
+  int physical_register = find_free_register(cpu);
+
+  cpu->rat[rd_arch] = physical_register;
+  cpu->rat_status[rd_arch] = 1;
+  cpu->allocation_list[physical_register] = 1;
+  cpu->status[physical_register] = 0;
+  cpu->constant[physical_register] = 0;
+  return physical_register;
+}
 
-        case OPCODE_STORE: {
-          cpu->decode.rs1 = cpu->rat[cpu->decode.rs1];
-          cpu->decode.rs2 = cpu->rat[cpu->decode.rs2];
+/* Free physical flag, -1 if every one is in use */
+static int
+find_free_flag(APEX_CPU *cpu) {
+  for (int i = 0; i < FLAG_FILE_SIZE; i++) {
+    if (!cpu->flag_allocation[i]) return i;
+  }
+  return -1;
+}
 
-          break;
-        }
+/**
+ * Method to rename the zero flag of the instruction in decode. BZ and BNZ read the flag of the youngest
+ * older producer, a producer gets a physical flag of its own, so compares in flight do not overwrite
+ * each other's result.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param stage - decode
+ */
+static void
+rename_flag(APEX_CPU *cpu, CPU_Stage *stage) {
+  if (stage->operands & OPERAND_FLAG_IN) {
+    stage->flag_rs = cpu->flag_rat;
+    if (cpu->flag_status[stage->flag_rs]) stage->ready |= OPERAND_FLAG_IN;
+  }
+  if (stage->operands & OPERAND_FLAG_OUT) {
+    stage->flag_rd = find_free_flag(cpu);
+    cpu->flag_allocation[stage->flag_rd] = 1;
+    cpu->flag_status[stage->flag_rd] = 0;
+    cpu->flag_rat = stage->flag_rd;
+  }
+}
 
-        case OPCODE_MOVC: {
-          /* MOVC doesn't have register operands */
+/* A compare fused with its branch takes a checkpoint like the branch would */
+static bool
+needs_branch_tag(const CPU_Stage *stage) {
+  return is_branch_instruction(stage->opcode) || stage->fused == FUSE_COMPARE_BRANCH;
+}
 
-          int physical_register = find_free_register(cpu);
-          if (physical_register != -1) {
-            cpu->decode.rd_arch = cpu->decode.rd;
-            cpu->decode.rd = physical_register;
-            cpu->rat[cpu->decode.rd_arch] = physical_register;
-            cpu->rat_status[cpu->decode.rd_arch] = 1;
-            cpu->allocation_list[physical_register] = 1;
-          }
+/* Decode has to wait for a free physical register, branch tag or physical flag before renaming */
+static bool
+rename_blocked(APEX_CPU *cpu, const CPU_Stage *stage) {
+  int destinations = ((stage->operands & OPERAND_RD) != 0) + (stage->fused == FUSE_ADDRESS_LOAD);
 
-          cpu->status[cpu->decode.rd] = 0;
-          break;
-        }
+  return !registers_available(cpu, destinations)
+         || (needs_branch_tag(stage) && find_free_branch_tag(cpu) == -1)
+         || ((stage->operands & OPERAND_FLAG_OUT) && find_free_flag(cpu) == -1);
+}
 
-        case OPCODE_JUMP: {
-          cpu->decode.rs1 = cpu->rat[cpu->decode.rs1];
+/*
+ * Decode Stage of APEX Pipeline
+ *
+ * Note: You are free to edit this function according to your implementation
+ */
+static void
+APEX_decode(APEX_CPU *cpu) {
+  bool dispatched = false;
 
-          if (cpu->status[cpu->decode.rs1] == 1 && cpu->allocation_list[cpu->decode.rs1] == 1)
-            cpu->decode.rs1_value = cpu->regs[cpu->decode.rs1];
-          break;
-        }
+  if (cpu->decode.has_insn) {
+    /* An instruction resolved at rename needs neither an IQ entry nor a function unit */
+    if (cpu->eliminate && cpu->decode.eliminated == ELIMINATED_NONE && (cpu->decode.operands & OPERAND_RD)) {
+      cpu->decode.eliminated = eliminate_at_rename(cpu, &cpu->decode);
+      if (cpu->decode.eliminated != ELIMINATED_NONE) cpu->decode.function_unit = FU_NONE;
+    }
 
-        case OPCODE_JAL: {
-          cpu->decode.rs1 = cpu->rat[cpu->decode.rs1];
+    /* Stall before renaming, so that the instruction is renamed exactly once */
+    if (rename_blocked(cpu, &cpu->decode) || !dispatch_possible(cpu)) {
+      /* Fetch holds on to the next instruction, unless it has already stopped after HALT */
+      if (cpu->fetch.has_insn) cpu->fetch_from_next_cycle = TRUE;
+    } else {
+      /* Rename sources before the destination, an instruction may read the register it writes */
+      cpu->decode.ready = 0;
+      if (cpu->decode.operands & OPERAND_RS1) {
+        cpu->decode.ready |= rename_source(cpu, &cpu->decode.rs1, &cpu->decode.rs1_value, OPERAND_RS1);
+      }
+      if (cpu->decode.operands & OPERAND_RS2) {
+        cpu->decode.ready |= rename_source(cpu, &cpu->decode.rs2, &cpu->decode.rs2_value, OPERAND_RS2);
+      }
+      if (cpu->decode.operands & OPERAND_RS3) {
+        cpu->decode.ready |= rename_source(cpu, &cpu->decode.rs3, &cpu->decode.rs3_value, OPERAND_RS3);
+      }
+      rename_flag(cpu, &cpu->decode);
 
-          int physical_register = find_free_register(cpu);
-          if (physical_register != -1) {
-            cpu->decode.rd_arch = cpu->decode.rd;
-            cpu->decode.rd = physical_register;
-            cpu->rat[cpu->decode.rd_arch] = physical_register;
-            cpu->rat_status[cpu->decode.rd_arch] = 1;
-            cpu->allocation_list[physical_register] = 1;
-          }
+      /* The ADDL of a fused load is older than the LOAD, so its destination is renamed first */
+      if (cpu->decode.fused == FUSE_ADDRESS_LOAD) {
+        cpu->decode.fused_rd_arch = cpu->decode.fused_rd;
+        cpu->decode.fused_rd = rename_destination(cpu, cpu->decode.fused_rd_arch);
+      }
 
-          if (cpu->status[cpu->decode.rs1] == 1 && cpu->allocation_list[cpu->decode.rs1] == 1)
-            cpu->decode.rs1_value = cpu->regs[cpu->decode.rs1];
+      if (cpu->decode.operands & OPERAND_RD) {
+        int physical_register;
 
-          cpu->status[cpu->decode.rd] = 0;
-          break;
-        }
+        cpu->decode.rd_arch = cpu->decode.rd;
+        physical_register = rename_destination(cpu, cpu->decode.rd_arch);
+        cpu->decode.rd = physical_register;
 
-        case OPCODE_NOP:
-        case OPCODE_DIV:
-        case OPCODE_BZ:
-        case OPCODE_BNZ: {
-          // Does Nothing
-          break;
+        if (cpu->decode.eliminated != ELIMINATED_NONE) {
+          cpu->regs[physical_register] = cpu->decode.result_buffer;
+          cpu->status[physical_register] = 1;
+          cpu->constant[physical_register] = (cpu->decode.eliminated != ELIMINATED_MOVE);
+          cpu->ops_eliminated[cpu->decode.eliminated]++;
         }
+      } else {
+        cpu->decode.rd_arch = -1;
       }
 
+      /* Instructions carry the tags of older unresolved branches, a branch also gets a tag of its own */
+      cpu->decode.branch_mask = cpu->branch_mask;
+      cpu->decode.branch_tag = needs_branch_tag(&cpu->decode) ? find_free_branch_tag(cpu) : -1;
+
       APEX_dispatch(cpu);
+      dispatched = true;
+
+      if (cpu->decode.fused == FUSE_COMPARE_BRANCH) cpu->compare_branches_fused++;
+      if (cpu->decode.fused == FUSE_ADDRESS_LOAD) cpu->address_loads_fused++;
     }
     if (cpu->debug_messages) {
       print_stage_content("Decode/RF", &cpu->decode);
     }
+
+    /* Dispatched instruction has left decode, fetch refills the latch later in this cycle */
+    if (dispatched) {
+      cpu->decode.has_insn = FALSE;
+    }
   }
 }
 
@@ -272,181 +501,179 @@ APEX_execute(APEX_CPU *cpu) {
   APEX_INTU(cpu);
 }
 
-void APEX_INTU(APEX_CPU *cpu) {
-  /* Execute logic based on instruction type */
-  switch (cpu->intu.opcode) {
-    case OPCODE_ADD: {
-      cpu->intu.rs1_value = cpu->regs[cpu->intu.rs1];
-      cpu->intu.rs2_value = cpu->regs[cpu->intu.rs2];
+/*
+ * Evaluates the run-until predicates checked at commit on an instruction that just retired, a
+ * predicate that hits is disarmed
+ */
+static bool
+commit_stop_hit(APEX_CPU *cpu, const ROB_Entry *entry) {
+  Stop_Condition *stop = &cpu->stop;
+  int hit = 0;
+
+  if ((stop->armed & STOP_AT_PC)
+      && (entry->pc_value == stop->pc || (entry->fused && entry->pc_value + 4 == stop->pc))) {
+    hit |= STOP_AT_PC;
+  }
+  if ((stop->armed & STOP_AT_INSTRET) && cpu->insn_completed >= stop->instret) hit |= STOP_AT_INSTRET;
+  if ((stop->armed & STOP_ON_HALT) && entry->opcode == OPCODE_HALT) hit |= STOP_ON_HALT;
+  if ((stop->armed & STOP_ON_REGISTER) && entry->rd_arch == stop->reg && cpu->regs[entry->rd_phy] == stop->value) {
+    hit |= STOP_ON_REGISTER;
+  }
+  if ((stop->armed & STOP_ON_REGISTER) && entry->fused_rd_arch == stop->reg && entry->fused_rd_arch != -1
+      && cpu->regs[entry->fused_rd_phy] == stop->value) {
+    hit |= STOP_ON_REGISTER;
+  }
 
-      cpu->intu.result_buffer = cpu->intu.rs1_value + cpu->intu.rs2_value;
+  stop->hit |= hit;
+  stop->armed &= ~hit;
+  return hit != 0;
+}
 
-      cpu->regs[cpu->intu.rd] = cpu->intu.result_buffer;
-      cpu->status[cpu->intu.rd] = 1;
+/*
+ * Makes a physical register the architectural copy of rd_arch, the previous copy is freed
+ */
+static void
+retire_destination(APEX_CPU *cpu, int rd_arch, int rd_phy) {
+  if (cpu->r_rat[rd_arch] != -1) {
+    cpu->allocation_list[cpu->r_rat[rd_arch]] = 0;
+  }
+  cpu->r_rat[rd_arch] = rd_phy;
+  cpu->r_rat_status[rd_arch] = 1;
+}
 
-      cpu->r_rat[cpu->intu.rd_arch] = cpu->intu.rd;
-      cpu->r_rat_status[cpu->intu.rd_arch] = 1;
+/*
+ * Commit Stage of APEX Pipeline
+ *
+ * Retires up to commit_width completed instructions from the ROB head in program order. A retiring
+ * instruction makes its destination the architectural copy of rd_arch and frees the physical register
+ * that held the previous copy, no in-flight instruction can still be reading it at this point.
+ */
+static void
+APEX_commit(APEX_CPU *cpu) {
+  for (int i = 0; i < cpu->commit_width && !rob_empty(cpu); i++) {
+    ROB_Entry *entry = &cpu->reorder_buffer.buffer[cpu->reorder_buffer.head];
 
+    if (!entry->status) {
       break;
     }
 
-    case OPCODE_ADDL: {
-      cpu->intu.rs1_value = cpu->regs[cpu->intu.rs1];
-
-      cpu->intu.result_buffer = cpu->intu.rs1_value + cpu->intu.imm;
-
-      cpu->regs[cpu->intu.rd] = cpu->intu.result_buffer;
-      cpu->status[cpu->intu.rd] = 1;
-
-      cpu->r_rat[cpu->intu.rd_arch] = cpu->intu.rd;
-      cpu->r_rat_status[cpu->intu.rd_arch] = 1;
-
-      break;
+    /* A fused entry retires both of its instructions, the ADDL of a fused load first */
+    if (entry->fused_rd_arch != -1) {
+      retire_destination(cpu, entry->fused_rd_arch, entry->fused_rd_phy);
     }
-
-    case OPCODE_SUB: {
-      cpu->intu.rs1_value = cpu->regs[cpu->intu.rs1];
-      cpu->intu.rs2_value = cpu->regs[cpu->intu.rs2];
-
-      cpu->intu.result_buffer = cpu->intu.rs1_value - cpu->intu.rs2_value;
-
-      cpu->regs[cpu->intu.rd] = cpu->intu.result_buffer;
-      cpu->status[cpu->intu.rd] = 1;
-
-      cpu->r_rat[cpu->intu.rd_arch] = cpu->intu.rd;
-      cpu->r_rat_status[cpu->intu.rd_arch] = 1;
-
-      if (cpu->intu.result_buffer == 0) {
-        cpu->zero_flag = TRUE;
-      } else {
-        cpu->zero_flag = FALSE;
-      }
-
-      break;
+    if (entry->rd_arch != -1) {
+      retire_destination(cpu, entry->rd_arch, entry->rd_phy);
     }
-
-    case OPCODE_SUBL: {
-      cpu->intu.rs1_value = cpu->regs[cpu->intu.rs1];
-
-      cpu->intu.result_buffer = cpu->intu.rs1_value - cpu->intu.imm;
-
-      cpu->regs[cpu->intu.rd] = cpu->intu.result_buffer;
-      cpu->status[cpu->intu.rd] = 1;
-
-      cpu->r_rat[cpu->intu.rd_arch] = cpu->intu.rd;
-      cpu->r_rat_status[cpu->intu.rd_arch] = 1;
-
-      if (cpu->intu.result_buffer == 0) {
-        cpu->zero_flag = TRUE;
-      } else {
-        cpu->zero_flag = FALSE;
-      }
-
-      break;
+    if (entry->flag_rd != -1) {
+      cpu->flag_allocation[cpu->flag_r_rat] = 0;
+      cpu->flag_r_rat = entry->flag_rd;
     }
 
-    case OPCODE_AND: {
-      cpu->intu.rs1_value = cpu->regs[cpu->intu.rs1];
-      cpu->intu.rs2_value = cpu->regs[cpu->intu.rs2];
-
-      cpu->intu.result_buffer = cpu->intu.rs1_value & cpu->intu.rs2_value;
-
-      cpu->regs[cpu->intu.rd] = cpu->intu.result_buffer;
-      cpu->status[cpu->intu.rd] = 1;
-
-      cpu->r_rat[cpu->intu.rd_arch] = cpu->intu.rd;
-      cpu->r_rat_status[cpu->intu.rd_arch] = 1;
-
-      break;
+    if (entry->opcode == OPCODE_HALT) {
+      cpu->halted = TRUE;
     }
 
-    case OPCODE_OR: {
-      cpu->intu.rs1_value = cpu->regs[cpu->intu.rs1];
-      cpu->intu.rs2_value = cpu->regs[cpu->intu.rs2];
-
-      cpu->intu.result_buffer = cpu->intu.rs1_value | cpu->intu.rs2_value;
-
-      cpu->regs[cpu->intu.rd] = cpu->intu.result_buffer;
-      cpu->status[cpu->intu.rd] = 1;
+    if (cpu->debug_messages) {
+      printf("%-15s: pc(%d) %s\n", "Commit", entry->pc_value, entry->opcode_str);
+    }
 
-      cpu->r_rat[cpu->intu.rd_arch] = cpu->intu.rd;
-      cpu->r_rat_status[cpu->intu.rd_arch] = 1;
+    cpu->insn_completed += entry->fused ? 2 : 1;
+    release_rob_entry(cpu, cpu->reorder_buffer.head);
+    increment_rob_head(cpu);
 
+    /* Nothing younger retires once a predicate hits, so the run stops right after this instruction */
+    if ((cpu->stop.armed & STOP_AT_COMMIT) && commit_stop_hit(cpu, entry)) {
       break;
     }
+  }
+}
 
-    case OPCODE_EXOR: {
-      cpu->intu.rs1_value = cpu->regs[cpu->intu.rs1];
-      cpu->intu.rs2_value = cpu->regs[cpu->intu.rs2];
-
-      cpu->intu.result_buffer = cpu->intu.rs1_value ^ cpu->intu.rs2_value;
-
-      cpu->regs[cpu->intu.rd] = cpu->intu.result_buffer;
-      cpu->status[cpu->intu.rd] = 1;
+/*
+ * Reads the source registers of the instruction in a function unit
+ */
+static void
+read_sources(APEX_CPU *cpu, CPU_Stage *stage) {
+  if (stage->operands & OPERAND_RS1) stage->rs1_value = cpu->regs[stage->rs1];
+  if (stage->operands & OPERAND_RS2) stage->rs2_value = cpu->regs[stage->rs2];
+  if (stage->operands & OPERAND_RS3) stage->rs3_value = cpu->regs[stage->rs3];
+}
 
-      cpu->r_rat[cpu->intu.rd_arch] = cpu->intu.rd;
-      cpu->r_rat_status[cpu->intu.rd_arch] = 1;
+/* Entry of the store set table for the load or store at a pc */
+static int
+store_set_index(int pc) {
+  return (pc / 4) % STORE_SET_TABLE_SIZE;
+}
 
-      break;
-    }
+static bool
+is_store_instruction(int opcode) {
+  return opcode == OPCODE_STORE || opcode == OPCODE_STR;
+}
 
-    case OPCODE_CMP: {
-      cpu->intu.rs1_value = cpu->regs[cpu->intu.rs1];
-      cpu->intu.rs2_value = cpu->regs[cpu->intu.rs2];
+/*
+ * Resolves a BZ or BNZ in INTU on the zero flag it read, fetch is sent to target if the branch is taken
+ */
+static void
+resolve_branch(APEX_CPU *cpu, CPU_Stage *stage, int opcode, int zero_flag, int target) {
+  if (branch_taken(opcode, zero_flag)) {
+    /* Fall through path was fetched, discard everything renamed after the branch */
+    squash_younger(cpu, stage->branch_tag);
 
-      if (cpu->intu.rs1_value == cpu->intu.rs2_value) {
-        cpu->zero_flag = TRUE;
-      } else {
-        cpu->zero_flag = FALSE;
-      }
-      break;
-    }
+    /* Calculate new PC, and send it to fetch unit */
+    cpu->pc = target;
 
-    case OPCODE_MOVC: {
-      cpu->intu.result_buffer = cpu->intu.imm + 0;
+    /* Since we are using reverse callbacks for pipeline stages,
+     * this will prevent the new instruction from being fetched in the current cycle*/
+    cpu->fetch_from_next_cycle = TRUE;
 
-      cpu->regs[cpu->intu.rd] = cpu->intu.result_buffer;
-      cpu->status[cpu->intu.rd] = 1;
+    /* Flush previous stages */
+    cpu->decode.has_insn = FALSE;
 
-      cpu->r_rat[cpu->intu.rd_arch] = cpu->intu.rd;
-      cpu->r_rat_status[cpu->intu.rd_arch] = 1;
+    /* Make sure fetch stage is enabled to start fetching from new PC */
+    cpu->fetch.has_insn = TRUE;
+  }
+  release_branch_tag(cpu, stage->branch_tag);
+}
 
-      break;
-    }
+void APEX_INTU(APEX_CPU *cpu) {
+  /* Execute logic based on instruction type */
+  switch (cpu->intu.opcode) {
+    case OPCODE_ADD:
+    case OPCODE_ADDL:
+    case OPCODE_SUB:
+    case OPCODE_SUBL:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_EXOR:
+    case OPCODE_MOVC:
+    case OPCODE_CMP: {
+      read_sources(cpu, &cpu->intu);
 
-    case OPCODE_BZ: {
-      if (cpu->zero_flag == TRUE) {
-        /* Calculate new PC, and send it to fetch unit */
-        cpu->pc = cpu->intu.pc + cpu->intu.imm;
+      cpu->intu.result_buffer = alu_result(cpu->intu.opcode, cpu->intu.rs1_value, cpu->intu.rs2_value,
+                                           cpu->intu.imm);
 
-        /* Since we are using reverse callbacks for pipeline stages,
-         * this will prevent the new instruction from being fetched in the current cycle*/
-        cpu->fetch_from_next_cycle = TRUE;
+      if (cpu->intu.operands & OPERAND_RD) {
+        cpu->regs[cpu->intu.rd] = cpu->intu.result_buffer;
+        cpu->status[cpu->intu.rd] = 1;
+      }
 
-        /* Flush previous stages */
-        cpu->decode.has_insn = FALSE;
+      if (cpu->intu.operands & OPERAND_FLAG_OUT) {
+        cpu->flags[cpu->intu.flag_rd] = (cpu->intu.result_buffer == 0) ? TRUE : FALSE;
+        cpu->flag_status[cpu->intu.flag_rd] = 1;
+        forward_flag_to_iq(cpu, cpu->intu.flag_rd);
+      }
 
-        /* Make sure fetch stage is enabled to start fetching from new PC */
-        cpu->fetch.has_insn = TRUE;
+      /* A fused branch is resolved on the flag its compare has just set */
+      if (cpu->intu.fused == FUSE_COMPARE_BRANCH) {
+        resolve_branch(cpu, &cpu->intu, cpu->intu.fused_opcode, cpu->flags[cpu->intu.flag_rd],
+                       cpu->intu.pc + 4 + cpu->intu.fused_imm);
       }
       break;
     }
 
+    case OPCODE_BZ:
     case OPCODE_BNZ: {
-      if (cpu->zero_flag == FALSE) {
-        /* Calculate new PC, and send it to fetch unit */
-        cpu->pc = cpu->intu.pc + cpu->intu.imm;
-
-        /* Since we are using reverse callbacks for pipeline stages,
-         * this will prevent the new instruction from being fetched in the current cycle*/
-        cpu->fetch_from_next_cycle = TRUE;
-
-        /* Flush previous stages */
-        cpu->decode.has_insn = FALSE;
-
-        /* Make sure fetch stage is enabled to start fetching from new PC */
-        cpu->fetch.has_insn = TRUE;
-      }
+      resolve_branch(cpu, &cpu->intu, cpu->intu.opcode, cpu->flags[cpu->intu.flag_rs],
+                     cpu->intu.pc + cpu->intu.imm);
       break;
     }
 
@@ -457,9 +684,8 @@ void APEX_INTU(APEX_CPU *cpu) {
     }
   }
 
-  forward_data_to_decode(cpu, &cpu->intu);
   forward_data_to_iq(cpu, &cpu->intu);
-  cpu->insn_completed++;
+  complete_rob_entry(cpu, &cpu->intu);
 
   if (cpu->debug_messages) {
     print_stage_content("INTU", &cpu->intu);
@@ -468,28 +694,19 @@ void APEX_INTU(APEX_CPU *cpu) {
 }
 
 void APEX_MULU(APEX_CPU *cpu) {
-  if (cpu->mulu.opcode == 2) {
+  if (cpu->mulu.opcode == OPCODE_MUL) {
     if (cpu->mulu_count == 2) {
-      cpu->mulu.rs1_value = cpu->regs[cpu->mulu.rs1];
-      cpu->mulu.rs2_value = cpu->regs[cpu->mulu.rs2];
+      read_sources(cpu, &cpu->mulu);
 
-      cpu->mulu.result_buffer = cpu->mulu.rs1_value * cpu->mulu.rs2_value;
+      cpu->mulu.result_buffer = alu_result(OPCODE_MUL, cpu->mulu.rs1_value, cpu->mulu.rs2_value, 0);
       cpu->mulu_count++;
       cpu->mulu_count %= 3;
-//
-//      if (cpu->r_rat[cpu->mulu.rd_arch] != -1) {
-//        cpu->allocation_list[cpu->r_rat[cpu->mulu.rd_arch]] = 0;
-//        cpu->status[cpu->r_rat[cpu->mulu.rd_arch]] = 0;
-//      }
 
       cpu->regs[cpu->mulu.rd] = cpu->mulu.result_buffer;
       cpu->status[cpu->mulu.rd] = 1;
 
-      cpu->r_rat[cpu->mulu.rd_arch] = cpu->mulu.rd;
-      cpu->r_rat_status[cpu->mulu.rd_arch] = 1;
-
-      forward_data_to_decode(cpu, &cpu->mulu);
       forward_data_to_iq(cpu, &cpu->mulu);
+      complete_rob_entry(cpu, &cpu->mulu);
 
     } else {
       cpu->mulu_count++;
@@ -500,40 +717,41 @@ void APEX_MULU(APEX_CPU *cpu) {
   }
 }
 
-void APEX_M1(APEX_CPU *cpu) {
-  switch (cpu->m1.opcode) {
+/*
+ * Executes the ADDL of a fused load in M1, its result is written back and is the base of the LOAD
+ */
+static void
+execute_fused_address(APEX_CPU *cpu, CPU_Stage *stage) {
+  CPU_Stage addl = *stage;
 
-    case OPCODE_LOAD: {
-      cpu->m1.rs1_value = cpu->regs[cpu->m1.rs1];
+  addl.opcode = OPCODE_ADDL;
+  addl.rd = stage->fused_rd;
+  addl.result_buffer = alu_result(OPCODE_ADDL, stage->rs1_value, 0, stage->fused_imm);
 
-      cpu->m1.memory_address = cpu->m1.rs1_value + cpu->m1.imm;
-      break;
-    }
+  cpu->regs[addl.rd] = addl.result_buffer;
+  cpu->status[addl.rd] = 1;
+  forward_data_to_iq(cpu, &addl);
 
-    case OPCODE_LDR: {
-      cpu->m1.rs1_value = cpu->regs[cpu->m1.rs1];
-      cpu->m1.rs2_value = cpu->regs[cpu->m1.rs2];
+  stage->rs1_value = addl.result_buffer;
+}
 
-      cpu->m1.memory_address = cpu->m1.rs1_value + cpu->m1.rs2_value;
-      break;
+void APEX_M1(APEX_CPU *cpu) {
+  /* M1 holds on to its instruction while M2 waits for memory */
+  if (is_memory_instruction(cpu->m2.opcode) && cpu->m2.ready_cycle > cpu->clock) {
+    if (cpu->debug_messages) {
+      print_stage_content("M1", &cpu->m1);
     }
+    return;
+  }
 
-    case OPCODE_STORE: {
-      cpu->m1.rs1_value = cpu->regs[cpu->m1.rs1];
-      cpu->m1.rs2_value = cpu->regs[cpu->m1.rs2];
-
-      cpu->m1.memory_address = cpu->m1.rs2_value + cpu->m1.imm;
-      break;
+  if (cpu->m1.function_unit == FU_MEM) {
+    read_sources(cpu, &cpu->m1);
+    if (cpu->m1.fused == FUSE_ADDRESS_LOAD) {
+      execute_fused_address(cpu, &cpu->m1);
     }
 
-    case OPCODE_STR: {
-      cpu->m1.rs1_value = cpu->regs[cpu->m1.rs1];
-      cpu->m1.rs2_value = cpu->regs[cpu->m1.rs2];
-      cpu->m1.rs3_value = cpu->regs[cpu->m1.rs3];
-
-      cpu->m1.memory_address = cpu->m1.rs2_value + cpu->m1.rs3_value;
-      break;
-    }
+    cpu->m1.memory_address = memory_address(cpu->m1.opcode, cpu->m1.rs1_value, cpu->m1.rs2_value,
+                                            cpu->m1.rs3_value, cpu->m1.imm);
   }
 
   cpu->m2 = cpu->m1;
@@ -541,22 +759,33 @@ void APEX_M1(APEX_CPU *cpu) {
   if (cpu->debug_messages) {
     print_stage_content("M1", &cpu->m1);
   }
+  get_nop_stage(&cpu->m1);
 }
 
 void APEX_M2(APEX_CPU *cpu) {
+  /* A memory instruction stays in M2 until its access completes */
+  if (is_memory_instruction(cpu->m2.opcode)) {
+    if (cpu->m2.ready_cycle == 0) {
+      cpu->m2.ready_cycle = cpu->clock + start_data_access(cpu, &cpu->m2) - 1;
+    }
+    if (cpu->clock < cpu->m2.ready_cycle) {
+      if (cpu->debug_messages) {
+        print_stage_content("M2", &cpu->m2);
+      }
+      return;
+    }
+  }
+
   switch (cpu->m2.opcode) {
 
     case OPCODE_LOAD:
     case OPCODE_LDR: {
-      cpu->m2.result_buffer = cpu->data_memory[cpu->m2.memory_address];
+      cpu->m2.result_buffer = read_data_memory(cpu, cpu->m2.memory_address);
 
       cpu->regs[cpu->m2.rd] = cpu->m2.result_buffer;
       cpu->status[cpu->m2.rd] = 1;
+      cpu->reorder_buffer.buffer[cpu->m2.rob_index].memory_address = cpu->m2.memory_address;
 
-      cpu->r_rat[cpu->m2.rd_arch] = cpu->m2.rd;
-      cpu->r_rat_status[cpu->m2.rd_arch] = 1;
-
-      forward_data_to_decode(cpu, &cpu->m2);
       forward_data_to_iq(cpu, &cpu->m2);
 
       break;
@@ -564,10 +793,19 @@ void APEX_M2(APEX_CPU *cpu) {
 
     case OPCODE_STORE:
     case OPCODE_STR: {
-      cpu->data_memory[cpu->m2.memory_address] = cpu->m2.rs1_value;
+      write_data_memory(cpu, cpu->m2.memory_address, cpu->m2.rs1_value);
+
+      if ((cpu->stop.armed & STOP_ON_WRITE) && cpu->m2.memory_address == cpu->stop.address) {
+        cpu->stop.hit |= STOP_ON_WRITE;
+        cpu->stop.armed &= ~STOP_ON_WRITE;
+      }
+      if (cpu->load_speculation != LOAD_SPECULATION_NONE) {
+        check_load_order(cpu, &cpu->m2);
+      }
       break;
     }
   }
+  complete_rob_entry(cpu, &cpu->m2);
 
   if (cpu->debug_messages) {
     print_stage_content("M2", &cpu->m2);
@@ -597,6 +835,9 @@ void APEX_JBU2(APEX_CPU *cpu) {
   switch (cpu->jbu2.opcode) {
 
     case OPCODE_JUMP: {
+      squash_younger(cpu, cpu->jbu2.branch_tag);
+      release_branch_tag(cpu, cpu->jbu2.branch_tag);
+
       cpu->pc = cpu->jbu2.rs1_value + cpu->jbu2.imm;
       cpu->decode.has_insn = FALSE;
       cpu->fetch.has_insn = TRUE;
@@ -605,6 +846,8 @@ void APEX_JBU2(APEX_CPU *cpu) {
     }
 
     case OPCODE_JAL: {
+      squash_younger(cpu, cpu->jbu2.branch_tag);
+      release_branch_tag(cpu, cpu->jbu2.branch_tag);
 
       cpu->pc = cpu->jbu2.rs1_value + cpu->jbu2.imm;
       cpu->decode.has_insn = FALSE;
@@ -613,318 +856,240 @@ void APEX_JBU2(APEX_CPU *cpu) {
       cpu->regs[cpu->jbu2.rd] = cpu->jbu2.pc + 4;
       cpu->status[cpu->jbu2.rd] = 1;
 
-      cpu->r_rat[cpu->jbu2.rd_arch] = cpu->jbu2.rd;
-      cpu->r_rat_status[cpu->jbu2.rd_arch] = 1;
-
-      forward_data_to_decode(cpu, &cpu->jbu2);
       forward_data_to_iq(cpu, &cpu->jbu2);
 
       break;
     }
   }
+  complete_rob_entry(cpu, &cpu->jbu2);
 
   if (cpu->debug_messages) {
     print_stage_content("JBU2", &cpu->jbu2);
   }
 }
 
+/**
+ * Method to check if ROB and, unless the instruction in decode is a memory instruction, HALT or NOP,
+ * the issue queue have room for it
+ *
+ * @param cpu pointer to current instance of cpu
+ * @return true if the instruction in decode can be dispatched in this cycle
+ */
+bool dispatch_possible(APEX_CPU *cpu) {
+  cpu->rob_full = cpu->reorder_buffer.count == ROB_SIZE;
+  cpu->iq_full = issue_queue_full(cpu);
+
+  if (cpu->rob_full) {
+    if (cpu->debug_messages) printf("\n[Dispatch]: ROB is full\n");
+    return false;
+  }
+
+  /* Memory instructions, HALT and NOP only need a ROB entry */
+  if (cpu->decode.function_unit == FU_MEM || cpu->decode.function_unit == FU_NONE) {
+    return true;
+  }
+
+  if (cpu->iq_full) {
+    if (cpu->debug_messages) printf("\n[Dispatch]: IQ is full\n");
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Every instruction gets a ROB entry, memory instructions wait there for M1 instead of in the issue
+ * queue, HALT and NOP have nothing to execute and are ready to retire right away
+ */
 void APEX_dispatch(APEX_CPU *cpu) {
-  if (cpu->rob_full || cpu->iq_full) {
-    cpu->fetch_from_next_cycle = TRUE;
+  int rob_index = insert_rob_entry(cpu);
 
-    if (cpu->rob_full)
-      printf("\n[Dispatch]: ROB is full\n");
-    else if (cpu->iq_full)
-      printf("\n[Dispatch]: IQ is full\n");
-  } else {
-    insert_iq_entry(cpu);
+  if (cpu->decode.branch_tag != -1) {
+    take_checkpoint(cpu, rob_index);
+  }
+
+  if (cpu->decode.function_unit != FU_MEM && cpu->decode.function_unit != FU_NONE) {
+    insert_iq_entry(cpu, rob_index);
   }
 }
 
 void APEX_issue(APEX_CPU *cpu) {
-  CPU_Stage nop;
+  int entry_index;
 
-  if (cpu->clock <= 2) {
-    cpu->m2 = get_nop_stage(&nop);
-    cpu->jbu2 = get_nop_stage(&nop);
-  }
-  cpu->intu = pick_entry(cpu, "intu");
+  cpu->intu = pick_entry(cpu, FU_INTU);
   cpu->intu.has_insn = true;
 
   if (cpu->mulu_count == 0) {
-    cpu->mulu = pick_entry(cpu, "mulu");
+    cpu->mulu = pick_entry(cpu, FU_MULU);
     cpu->mulu.has_insn = true;
   }
 
-  if (!rob_empty(cpu)) {
-    if (cpu->reorder_buffer.buffer[cpu->reorder_buffer.head].mready == 1) {
-      cpu->m1 = remove_rob_entry(cpu);
-      pick_entry(cpu, "mem");
-    } else {
-      cpu->m1 = get_nop_stage(&nop);
-      validate_rob_entries(cpu);
-    }
-  } else {
-    cpu->m1 = get_nop_stage(&nop);
+  /* Nothing is sent while M1 still holds an instruction behind a miss */
+  entry_index = is_memory_instruction(cpu->m1.opcode) ? -1 : next_memory_entry(cpu, true);
+  if (entry_index != -1) {
+    cpu->m1 = issue_rob_entry(cpu, entry_index);
   }
 
-  cpu->jbu1 = pick_entry(cpu, "jbu");
+  cpu->jbu1 = pick_entry(cpu, FU_JBU);
   cpu->jbu1.has_insn = true;
 }
 
-void insert_iq_entry(APEX_CPU *cpu) {
-  for (int i = 0; i <= IQ_SIZE; i++) {
-    if (i == IQ_SIZE) {
-      cpu->iq_full = true;
-      cpu->fetch_from_next_cycle = TRUE;
-    } else {
-      if (cpu->iq_entry_used[i] == 0) {
-        IQ_Entry *iq_entry = &cpu->issue_queue[i];
-
-        switch (cpu->decode.opcode) {
-          case OPCODE_ADD:
-          case OPCODE_SUB:
-          case OPCODE_MUL:
-          case OPCODE_AND:
-          case OPCODE_OR:
-          case OPCODE_EXOR: {
-            iq_entry->pc = cpu->decode.pc;
-            iq_entry->opcode = cpu->decode.opcode;
-            strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-            iq_entry->rs1 = cpu->decode.rs1;
-            iq_entry->rs2 = cpu->decode.rs2;
-            iq_entry->rd = cpu->decode.rd;
-            iq_entry->rd_arch = cpu->decode.rd_arch;
-            iq_entry->rs1_value = cpu->decode.rs1_value;
-            iq_entry->rs2_value = cpu->decode.rs2_value;
-            iq_entry->cycle_number = cpu->clock;
-            cpu->iq_entry_used[i] = 1;
-            break;
-          }
-
-          case OPCODE_ADDL:
-          case OPCODE_SUBL: {
-            iq_entry->pc = cpu->decode.pc;
-            iq_entry->opcode = cpu->decode.opcode;
-            strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-            iq_entry->rs1 = cpu->decode.rs1;
-            iq_entry->rd = cpu->decode.rd;
-            iq_entry->rd_arch = cpu->decode.rd_arch;
-            iq_entry->imm = cpu->decode.imm;
-            iq_entry->rs1_value = cpu->decode.rs1_value;
-            iq_entry->cycle_number = cpu->clock;
-            cpu->iq_entry_used[i] = 1;
-
-            break;
-          }
-
-          case OPCODE_CMP: {
-            iq_entry->pc = cpu->decode.pc;
-            iq_entry->opcode = cpu->decode.opcode;
-            strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-            iq_entry->rs1 = cpu->decode.rs1;
-            iq_entry->rs2 = cpu->decode.rs2;
-            iq_entry->rs1_value = cpu->decode.rs1_value;
-            iq_entry->rs2_value = cpu->decode.rs2_value;
-            iq_entry->cycle_number = cpu->clock;
-            cpu->iq_entry_used[i] = 1;
-            break;
-          }
-
-          case OPCODE_MOVC: {
-            iq_entry->pc = cpu->decode.pc;
-            iq_entry->opcode = cpu->decode.opcode;
-            strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-            iq_entry->rd = cpu->decode.rd;
-            iq_entry->rd_arch = cpu->decode.rd_arch;
-            iq_entry->imm = cpu->decode.imm;
-            iq_entry->cycle_number = cpu->clock;
-            cpu->iq_entry_used[i] = 1;
-
-            break;
-          }
-
-          case OPCODE_BZ:
-          case OPCODE_BNZ: {
-            iq_entry->pc = cpu->decode.pc;
-            iq_entry->opcode = cpu->decode.opcode;
-            strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-            iq_entry->imm = cpu->decode.imm;
-            iq_entry->cycle_number = cpu->clock;
-            cpu->iq_entry_used[i] = 1;
-
-            break;
-          }
-
-          case OPCODE_LOAD: {
-            if (cpu->status[cpu->decode.rs1] == 0) {
-              iq_entry->pc = cpu->decode.pc;
-              iq_entry->opcode = cpu->decode.opcode;
-              strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-              iq_entry->rd = cpu->decode.rd;
-              iq_entry->rd_arch = cpu->decode.rd_arch;
-              iq_entry->rs1 = cpu->decode.rs1;
-              iq_entry->imm = cpu->decode.imm;
-              iq_entry->cycle_number = cpu->clock;
-              cpu->iq_entry_used[i] = 1;
-              insert_rob_entry(cpu, 0);
-            } else {
-              insert_rob_entry(cpu, 1);
-            }
-
-            break;
-          }
-
-          case OPCODE_LDR: {
-            if (cpu->status[cpu->decode.rs1] == 0 || cpu->status[cpu->decode.rs2] == 0) {
-              iq_entry->pc = cpu->decode.pc;
-              iq_entry->opcode = cpu->decode.opcode;
-              strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-              iq_entry->rd = cpu->decode.rd;
-              iq_entry->rd_arch = cpu->decode.rd_arch;
-              iq_entry->rs1 = cpu->decode.rs1;
-              iq_entry->rs2 = cpu->decode.rs2;
-              iq_entry->cycle_number = cpu->clock;
-              cpu->iq_entry_used[i] = 1;
-              insert_rob_entry(cpu, 0);
-            } else {
-              insert_rob_entry(cpu, 1);
-            }
-
-            break;
-          }
-
-          case OPCODE_STORE: {
-            if (cpu->status[cpu->decode.rs1] == 0 || cpu->status[cpu->decode.rs2] == 0) {
-              iq_entry->pc = cpu->decode.pc;
-              iq_entry->opcode = cpu->decode.opcode;
-              strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-              iq_entry->rs1 = cpu->decode.rs1;
-              iq_entry->rs2 = cpu->decode.rs2;
-              iq_entry->imm = cpu->decode.imm;
-              iq_entry->cycle_number = cpu->clock;
-              cpu->iq_entry_used[i] = 1;
-              insert_rob_entry(cpu, 0);
-            } else {
-              insert_rob_entry(cpu, 1);
-            }
-
-            break;
-          }
-
-          case OPCODE_STR: {
-            if (cpu->status[cpu->decode.rs1] == 0 || cpu->status[cpu->decode.rs2] == 0
-                || cpu->status[cpu->decode.rs3] == 0) {
-              iq_entry->pc = cpu->decode.pc;
-              iq_entry->opcode = cpu->decode.opcode;
-              strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-              iq_entry->rs1 = cpu->decode.rs1;
-              iq_entry->rs2 = cpu->decode.rs2;
-              iq_entry->rs3 = cpu->decode.rs3;
-              iq_entry->cycle_number = cpu->clock;
-              cpu->iq_entry_used[i] = 1;
-              insert_rob_entry(cpu, 0);
-            } else {
-              insert_rob_entry(cpu, 1);
-            }
-
-            break;
-          }
-
-          case OPCODE_JUMP: {
-            iq_entry->pc = cpu->decode.pc;
-            iq_entry->opcode = cpu->decode.opcode;
-            strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-            iq_entry->rs1 = cpu->decode.rs1;
-            iq_entry->imm = cpu->decode.imm;
-            iq_entry->cycle_number = cpu->clock;
-            cpu->iq_entry_used[i] = 1;
-
-            break;
-          }
-
-          case OPCODE_JAL: {
-            iq_entry->pc = cpu->decode.pc;
-            iq_entry->opcode = cpu->decode.opcode;
-            strcpy(iq_entry->opcode_str, cpu->decode.opcode_str);
-            iq_entry->rd = cpu->decode.rd;
-            iq_entry->rd_arch = cpu->decode.rd_arch;
-            iq_entry->rs1 = cpu->decode.rs1;
-            iq_entry->imm = cpu->decode.imm;
-            iq_entry->cycle_number = cpu->clock;
-            cpu->iq_entry_used[i] = 1;
-
-            break;
-          }
-        }
-        validate_iq_entry(cpu, iq_entry);
-        break;
-      }
-    }
-  }
-}
-
-void insert_rob_entry(APEX_CPU *cpu, int is_ready) {
-  ROB_Entry rob_entry;
-
-  switch (cpu->decode.opcode) {
+/*
+ * Adds an IQ entry to the consumers of each of its sources that has not been written yet
+ */
+static void register_consumer(APEX_CPU *cpu, int entry_index) {
+  IQ_Entry *iq_entry = &cpu->issue_queue[entry_index];
+  int missing = iq_entry->operands & OPERAND_SOURCES & ~iq_entry->ready;
 
-    case OPCODE_LOAD: {
-      rob_entry.pc_value = cpu->decode.pc;
-      rob_entry.opcode = cpu->decode.opcode;
-      strcpy(rob_entry.instruction_type, "not_r2r");
-      rob_entry.rs1 = cpu->decode.rs1;
-      rob_entry.imm = cpu->decode.imm;
-      rob_entry.rd_phy = cpu->decode.rd;
-      rob_entry.rd_arch = cpu->decode.rd_arch;
-      strcpy(rob_entry.opcode_str, cpu->decode.opcode_str);
-      rob_entry.mready = is_ready;
+  if (missing & OPERAND_RS1) bitset_set(cpu->consumers[iq_entry->rs1], entry_index);
+  if (missing & OPERAND_RS2) bitset_set(cpu->consumers[iq_entry->rs2], entry_index);
+  if (missing & OPERAND_RS3) bitset_set(cpu->consumers[iq_entry->rs3], entry_index);
+  if (missing & OPERAND_FLAG_IN) bitset_set(cpu->flag_consumers[iq_entry->flag_rs], entry_index);
+}
 
-      break;
-    }
+/*
+ * Frees a set of IQ entries, their bits leave every set of the issue queue
+ */
+static void release_iq_entries(APEX_CPU *cpu, const Bitset_Word *set) {
+  Bitset_Word entries[IQ_WORDS];
+
+  /* A copy, the set may be one of the branch sets cleared below */
+  memcpy(entries, set, sizeof(entries));
+  bitset_remove(cpu->iq_valid, entries, IQ_WORDS);
+  bitset_remove(cpu->iq_ready, entries, IQ_WORDS);
+  for (int unit = 0; unit <= FU_JBU; unit++) {
+    bitset_remove(cpu->iq_unit[unit], entries, IQ_WORDS);
+  }
+  for (int tag = 0; tag < MAX_BRANCHES; tag++) {
+    bitset_remove(cpu->iq_branch[tag], entries, IQ_WORDS);
+  }
+}
 
-    case OPCODE_LDR: {
-      rob_entry.pc_value = cpu->decode.pc;
-      rob_entry.opcode = cpu->decode.opcode;
-      strcpy(rob_entry.instruction_type, "not_r2r");
-      rob_entry.rs1 = cpu->decode.rs1;
-      rob_entry.rs2 = cpu->decode.rs2;
-      rob_entry.rd_phy = cpu->decode.rd;
-      rob_entry.rd_arch = cpu->decode.rd_arch;
-      strcpy(rob_entry.opcode_str, cpu->decode.opcode_str);
-      rob_entry.mready = is_ready;
+/*
+ * Frees every IQ entry
+ */
+static void release_all_iq_entries(APEX_CPU *cpu) {
+  memset(cpu->iq_valid, 0, sizeof(cpu->iq_valid));
+  memset(cpu->iq_ready, 0, sizeof(cpu->iq_ready));
+  memset(cpu->iq_unit, 0, sizeof(cpu->iq_unit));
+  memset(cpu->iq_branch, 0, sizeof(cpu->iq_branch));
+}
 
-      break;
-    }
+void insert_iq_entry(APEX_CPU *cpu, int rob_index) {
+  int i = bitset_next_clear(cpu->iq_valid, 0, IQ_SIZE);
+  IQ_Entry *iq_entry;
+  int operands = cpu->decode.operands;
 
-    case OPCODE_STORE: {
-      rob_entry.pc_value = cpu->decode.pc;
-      rob_entry.opcode = cpu->decode.opcode;
-      strcpy(rob_entry.instruction_type, "not_r2r");
-      rob_entry.rs1 = cpu->decode.rs1;
-      rob_entry.rs2 = cpu->decode.rs2;
-      rob_entry.imm = cpu->decode.imm;
-      strcpy(rob_entry.opcode_str, cpu->decode.opcode_str);
-      rob_entry.mready = is_ready;
+  if (i < 0) {
+    return;
+  }
+  iq_entry = &cpu->issue_queue[i];
+
+  iq_entry->pc = cpu->decode.pc;
+  iq_entry->opcode = cpu->decode.opcode;
+  iq_entry->opcode_str = cpu->decode.opcode_str;
+  iq_entry->operands = operands;
+  iq_entry->function_unit = cpu->decode.function_unit;
+
+  /* Unused registers are -1, so that they never match a producer */
+  iq_entry->rd = (operands & OPERAND_RD) ? cpu->decode.rd : -1;
+  iq_entry->rd_arch = cpu->decode.rd_arch;
+  iq_entry->rs1 = (operands & OPERAND_RS1) ? cpu->decode.rs1 : -1;
+  iq_entry->rs2 = (operands & OPERAND_RS2) ? cpu->decode.rs2 : -1;
+  iq_entry->rs3 = (operands & OPERAND_RS3) ? cpu->decode.rs3 : -1;
+  iq_entry->rs1_value = cpu->decode.rs1_value;
+  iq_entry->rs2_value = cpu->decode.rs2_value;
+  iq_entry->rs3_value = cpu->decode.rs3_value;
+  iq_entry->imm = cpu->decode.imm;
+  iq_entry->cycle_number = cpu->clock;
+  iq_entry->branch_tag = cpu->decode.branch_tag;
+  iq_entry->fused = cpu->decode.fused;
+  iq_entry->fused_opcode = cpu->decode.fused_opcode;
+  iq_entry->fused_imm = cpu->decode.fused_imm;
+  iq_entry->flag_rs = cpu->decode.flag_rs;
+  iq_entry->flag_rd = cpu->decode.flag_rd;
+  iq_entry->ready = cpu->decode.ready & operands;
+  iq_entry->waiting = __builtin_popcount(operands & OPERAND_SOURCES & ~iq_entry->ready);
+
+  cpu->iq_rob_index[i] = rob_index;
+  bitset_set(cpu->iq_valid, i);
+  bitset_set(cpu->iq_unit[iq_entry->function_unit], i);
+  if (iq_entry->waiting == 0) bitset_set(cpu->iq_ready, i);
+  for (int tag = 0; tag < MAX_BRANCHES; tag++) {
+    if (cpu->decode.branch_mask & (1 << tag)) bitset_set(cpu->iq_branch[tag], i);
+  }
 
-      break;
-    }
+  register_consumer(cpu, i);
+}
 
-    case OPCODE_STR: {
-      rob_entry.pc_value = cpu->decode.pc;
-      rob_entry.opcode = cpu->decode.opcode;
-      strcpy(rob_entry.instruction_type, "not_r2r");
-      rob_entry.rs1 = cpu->decode.rs1;
-      rob_entry.rs2 = cpu->decode.rs2;
-      rob_entry.rs3 = cpu->decode.rs3;
-      strcpy(rob_entry.opcode_str, cpu->decode.opcode_str);
-      rob_entry.mready = is_ready;
+/**
+ * Method to allocate the ROB entry of the instruction in decode, in program order
+ *
+ * @param cpu pointer to current instance of cpu
+ * @return index of the new entry
+ */
+int insert_rob_entry(APEX_CPU *cpu) {
+  ROB_Entry rob_entry;
+  int rob_index = cpu->reorder_buffer.tail;
+
+  rob_entry.pc_value = cpu->decode.pc;
+  rob_entry.opcode = cpu->decode.opcode;
+  rob_entry.opcode_str = cpu->decode.opcode_str;
+  rob_entry.operands = cpu->decode.operands;
+  rob_entry.instruction_type = (cpu->decode.function_unit == FU_MEM) ? "not_r2r" : "r2r";
+  rob_entry.rs1 = cpu->decode.rs1;
+  rob_entry.rs2 = cpu->decode.rs2;
+  rob_entry.rs3 = cpu->decode.rs3;
+  rob_entry.imm = cpu->decode.imm;
+
+  if (cpu->decode.operands & OPERAND_RD) {
+    rob_entry.rd_phy = cpu->decode.rd;
+    rob_entry.rd_arch = cpu->decode.rd_arch;
+  } else {
+    rob_entry.rd_phy = -1;
+    rob_entry.rd_arch = -1;
+  }
 
-      break;
-    }
+  rob_entry.status = (cpu->decode.function_unit == FU_NONE);
+  rob_entry.mready = 0;
+  rob_entry.store_set = (cpu->decode.function_unit == FU_MEM && cpu->load_speculation == LOAD_SPECULATION_STORE_SETS)
+                        ? cpu->store_set_table[store_set_index(cpu->decode.pc)] : -1;
+  rob_entry.memory_address = -1;
+  rob_entry.held = 0;
+  rob_entry.dependence_seen = 0;
+  rob_entry.fused = cpu->decode.fused;
+  rob_entry.fused_opcode = cpu->decode.fused_opcode;
+  rob_entry.fused_imm = cpu->decode.fused_imm;
+  rob_entry.fused_rd_phy = (cpu->decode.fused == FUSE_ADDRESS_LOAD) ? cpu->decode.fused_rd : -1;
+  rob_entry.fused_rd_arch = (cpu->decode.fused == FUSE_ADDRESS_LOAD) ? cpu->decode.fused_rd_arch : -1;
+  rob_entry.flag_rd = cpu->decode.flag_rd;
+
+  if (!queue_insert(cpu, rob_entry)) {
+    return rob_index;
+  }
+  if (cpu->decode.function_unit == FU_MEM) {
+    bitset_set(cpu->reorder_buffer.memory_pending, rob_index);
   }
+  if (cpu->decode.opcode == OPCODE_LOAD || cpu->decode.opcode == OPCODE_LDR) {
+    bitset_set(cpu->reorder_buffer.loads, rob_index);
+  }
+  for (int tag = 0; tag < MAX_BRANCHES; tag++) {
+    if (cpu->decode.branch_mask & (1 << tag)) bitset_set(cpu->reorder_buffer.branch[tag], rob_index);
+  }
+  return rob_index;
+}
 
-  queue_insert(cpu, rob_entry);
+/**
+ * Method to clear the bits of a ROB entry that has retired or been squashed
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param rob_index - index of the entry
+ */
+void release_rob_entry(APEX_CPU *cpu, int rob_index) {
+  bitset_clear(cpu->reorder_buffer.memory_pending, rob_index);
+  bitset_clear(cpu->reorder_buffer.loads, rob_index);
+  for (int tag = 0; tag < MAX_BRANCHES; tag++) {
+    bitset_clear(cpu->reorder_buffer.branch[tag], rob_index);
+  }
 }
 
 int find_free_register(APEX_CPU *cpu) {
@@ -940,7 +1105,7 @@ int find_free_register(APEX_CPU *cpu) {
 
 void print_issue_queue(APEX_CPU *cpu) {
   for (int i = 0; i < IQ_SIZE; i++) {
-    if (cpu->iq_entry_used[i]) {
+    if (bitset_test(cpu->iq_valid, i)) {
       IQ_Entry *iq = &cpu->issue_queue[i];
       printf("\n-------------------------------------------------\n");
       printf("                 IQ Entry [%d]                   \n", i);
@@ -951,7 +1116,7 @@ void print_issue_queue(APEX_CPU *cpu) {
       printf("|   rs1 : R%-2d        rs1_value      : %-5d   |\n", iq->rs1, iq->rs1_value);
       printf("|   rs2 : R%-2d        rs2_value      : %-5d   |\n", iq->rs2, iq->rs2_value);
       printf("|   rs3 : R%-2d        rs3_value      : %-5d   |\n", iq->rs3, iq->rs3_value);
-      printf("|   imm : R%-2d        valid          : %-5d   |\n", iq->imm, iq->valid);
+      printf("|   imm : R%-2d        waiting        : %-5d   |\n", iq->imm, iq->waiting);
     }
   }
 }
@@ -960,15 +1125,17 @@ void print_reorder_buffer(APEX_CPU *cpu) {
   int count = 4;
   if (!rob_empty(cpu)) {
     for (int i = 0; i < count; i++) {
-      ROB_Entry entry = cpu->reorder_buffer.buffer[cpu->reorder_buffer.head + i];
-      if ((cpu->reorder_buffer.head + i) != cpu->reorder_buffer.tail) {
+      ROB_Entry entry = cpu->reorder_buffer.buffer[(cpu->reorder_buffer.head + i) % ROB_SIZE];
+      if (i < cpu->reorder_buffer.count) {
         printf("\n-------------------------------------------------\n");
         printf("                   ROB Entry                  \n");
         printf("-------------------------------------------------\n");
 
         printf("|   pc      : %4d       Opcode   : %-5s      |\n", entry.pc_value, entry.opcode_str);
+        printf("|   rd      : P%-2d        rd_arch  : R%-2d        |\n", entry.rd_phy, entry.rd_arch);
         printf("|   rs1     : R%-2d        rs2      : R%-2d        |\n", entry.rs1, entry.rs2);
         printf("|   rs3     : R%-2d        imm      : %-2d         |\n", entry.rs3, entry.imm);
+        printf("|   status  : %-8s                            |\n", entry.status ? "complete" : "pending");
       } else {
         printf("   Reached tail of ROB  \n");
         break;
@@ -1003,214 +1170,83 @@ void print_rat(APEX_CPU *cpu) {
 }
 
 bool issue_queue_empty(APEX_CPU *cpu) {
-  for (int i = 0; i < IQ_SIZE; i++) {
-    if (cpu->iq_entry_used[i]) return false;
-  }
-  return true;
+  return bitset_count(cpu->iq_valid, IQ_WORDS) == 0;
 }
 
 /**
- * Method to forward data from given stage to decode stage
+ * Method to forward the result of a stage to the IQ entries waiting for it. Entries register in
+ * consumers[] of every source that is not ready when they are dispatched, so a writeback only
+ * visits its own dependents instead of the whole issue queue. Each source it supplies is marked
+ * ready and takes one off the count of sources the entry waits for, it can issue once that is 0.
  *
  * @param cpu pointer to current instance of cpu
+ * @param stage - function unit writing back its result
  */
-void forward_data_to_decode(APEX_CPU *cpu, CPU_Stage *stage) {
-  if (!(stage->opcode == 0x8 || stage->opcode == 0x9 || stage->opcode == 0xf
-      || stage->opcode == 0x10 || stage->opcode == 0x11 || stage->opcode == 0x12 || stage->opcode == 0xa
-      || stage->opcode == 0xb || stage->opcode == 0xc)) {
-    switch (cpu->decode.opcode) {
-      case OPCODE_ADD:
-      case OPCODE_SUB:
-      case OPCODE_MUL:
-      case OPCODE_AND:
-      case OPCODE_OR:
-      case OPCODE_EXOR:
-      case OPCODE_LDR:
-      case OPCODE_CMP:
-      case OPCODE_MOVC: {
-        if (stage->rd == cpu->decode.rs1) {
-          cpu->decode.rs1_value = stage->result_buffer;
-          cpu->forwarded[cpu->decode.rs1] = 1;
-          cpu->status[cpu->decode.rs1] = 1;
-        }
-
-        if (stage->rd == cpu->decode.rs2) {
-          cpu->decode.rs2_value = stage->result_buffer;
-          cpu->forwarded[cpu->decode.rs2] = 1;
-          cpu->status[cpu->decode.rs2] = 1;
-        }
-        break;
-      }
+void forward_data_to_iq(APEX_CPU *cpu, CPU_Stage *stage) {
+  Bitset_Word waiting[IQ_WORDS];
 
-      case OPCODE_ADDL:
-      case OPCODE_SUBL:
-      case OPCODE_LOAD: {
-        if (stage->rd == cpu->decode.rs1) {
-          cpu->decode.rs1_value = stage->result_buffer;
-          cpu->forwarded[cpu->decode.rs1] = 1;
-          cpu->status[cpu->decode.rs1] = 1;
-        }
-        break;
-      }
+  if (!has_destination(stage->opcode)) return;
 
-      case OPCODE_STORE: {
-        if (stage->rd == cpu->decode.rs2) {
-          cpu->decode.rs2_value = stage->result_buffer;
-          cpu->forwarded[cpu->decode.rs2] = 1;
-          cpu->status[cpu->decode.rs2] = 1;
-        }
-        break;
-      }
+  memcpy(waiting, cpu->consumers[stage->rd], sizeof(waiting));
+  memset(cpu->consumers[stage->rd], 0, sizeof(waiting));
 
-      case OPCODE_STR: {
-        if (stage->rd == cpu->decode.rs3) {
-          cpu->decode.rs3_value = stage->result_buffer;
-          cpu->forwarded[cpu->decode.rs3] = 1;
-          cpu->status[cpu->decode.rs3] = 1;
-        }
+  for (int i = bitset_next(waiting, 0, IQ_SIZE); i >= 0; i = bitset_next(waiting, i + 1, IQ_SIZE)) {
+    IQ_Entry *iq_entry = &cpu->issue_queue[i];
 
-        if (stage->rd == cpu->decode.rs2) {
-          cpu->decode.rs2_value = stage->result_buffer;
-          cpu->forwarded[stage->rd] = 1;
-          cpu->status[cpu->decode.rs2] = 1;
-        }
+    /* Entries issued or squashed since they registered leave their bit behind */
+    if (!bitset_test(cpu->iq_valid, i)) continue;
 
-        if (stage->rd == cpu->decode.rs1) {
-          cpu->decode.rs1_value = stage->result_buffer;
-          cpu->forwarded[stage->rd] = 1;
-          cpu->status[cpu->decode.rs1] = 1;
-        }
-        break;
-      }
+    if (!(iq_entry->ready & OPERAND_RS1) && iq_entry->rs1 == stage->rd) {
+      iq_entry->rs1_value = stage->result_buffer;
+      iq_entry->ready |= OPERAND_RS1;
+      iq_entry->waiting--;
     }
+    if (!(iq_entry->ready & OPERAND_RS2) && iq_entry->rs2 == stage->rd) {
+      iq_entry->rs2_value = stage->result_buffer;
+      iq_entry->ready |= OPERAND_RS2;
+      iq_entry->waiting--;
+    }
+    if (!(iq_entry->ready & OPERAND_RS3) && iq_entry->rs3 == stage->rd) {
+      iq_entry->rs3_value = stage->result_buffer;
+      iq_entry->ready |= OPERAND_RS3;
+      iq_entry->waiting--;
+    }
+    if (iq_entry->waiting == 0) bitset_set(cpu->iq_ready, i);
   }
 }
 
 /**
- * Method to forward data from given stage to issue queue
+ * Method to wake up the BZ/BNZ entries waiting for a physical flag that has just been set
  *
  * @param cpu pointer to current instance of cpu
+ * @param flag - physical flag
  */
-void forward_data_to_iq(APEX_CPU *cpu, CPU_Stage *stage) {
+void forward_flag_to_iq(APEX_CPU *cpu, int flag) {
+  Bitset_Word waiting[IQ_WORDS];
 
-  for (int i = 0; i < IQ_SIZE; i++) {
+  memcpy(waiting, cpu->flag_consumers[flag], sizeof(waiting));
+  memset(cpu->flag_consumers[flag], 0, sizeof(waiting));
+  for (int i = bitset_next(waiting, 0, IQ_SIZE); i >= 0; i = bitset_next(waiting, i + 1, IQ_SIZE)) {
     IQ_Entry *iq_entry = &cpu->issue_queue[i];
-    if (cpu->iq_entry_used[i]) {
-      if (!(stage->opcode == 0x8 || stage->opcode == 0x9 || stage->opcode == 0xf
-          || stage->opcode == 0x10 || stage->opcode == 0x11 || stage->opcode == 0x12 || stage->opcode == 0xa
-          || stage->opcode == 0xb || stage->opcode == 0xc)) {
-        switch (iq_entry->opcode) {
-          case OPCODE_ADD:
-          case OPCODE_SUB:
-          case OPCODE_MUL:
-          case OPCODE_AND:
-          case OPCODE_OR:
-          case OPCODE_EXOR:
-          case OPCODE_LDR:
-          case OPCODE_CMP:
-          case OPCODE_MOVC: {
-            if (stage->rd == iq_entry->rs1) {
-              iq_entry->rs1_value = stage->result_buffer;
-              cpu->forwarded[stage->rd] = 1;
-              cpu->status[iq_entry->rs1] = 1;
-            }
-
-            if (stage->rd == iq_entry->rs2) {
-              iq_entry->rs2_value = stage->result_buffer;
-              cpu->forwarded[stage->rd] = 1;
-              cpu->status[iq_entry->rs2] = 1;
-            }
-            break;
-          }
-
-          case OPCODE_ADDL:
-          case OPCODE_SUBL:
-          case OPCODE_LOAD: {
-            if (stage->rd == iq_entry->rs1) {
-              iq_entry->rs1_value = stage->result_buffer;
-              cpu->forwarded[stage->rd] = 1;
-              cpu->status[iq_entry->rs1] = 1;
-            }
-            break;
-          }
-
-          case OPCODE_STORE: {
-            if (stage->rd == iq_entry->rs2) {
-              iq_entry->rs2_value = stage->result_buffer;
-              cpu->forwarded[stage->rd] = 1;
-              cpu->status[iq_entry->rs2] = 1;
-            }
-            break;
-          }
-
-          case OPCODE_STR: {
-            if (stage->rd == iq_entry->rs3) {
-              iq_entry->rs3_value = stage->result_buffer;
-              cpu->forwarded[stage->rd] = 1;
-              cpu->status[iq_entry->rs3] = 1;
-            }
-
-            if (stage->rd == iq_entry->rs2) {
-              iq_entry->rs2_value = stage->result_buffer;
-              cpu->forwarded[stage->rd] = 1;
-              cpu->status[iq_entry->rs2] = 1;
-            }
-
-            if (stage->rd == iq_entry->rs1) {
-              iq_entry->rs1_value = stage->result_buffer;
-              cpu->forwarded[stage->rd] = 1;
-              cpu->status[iq_entry->rs1] = 1;
-            }
-            break;
-          }
-        }
-        validate_iq_entry(cpu, iq_entry);
-      }
+
+    if (bitset_test(cpu->iq_valid, i) && !(iq_entry->ready & OPERAND_FLAG_IN) && iq_entry->flag_rs == flag) {
+      iq_entry->ready |= OPERAND_FLAG_IN;
+      if (--iq_entry->waiting == 0) bitset_set(cpu->iq_ready, i);
     }
   }
 }
 
-void validate_iq_entry(APEX_CPU *cpu, IQ_Entry *iq_entry) {
-  switch (iq_entry->opcode) {
-    case OPCODE_ADD:
-    case OPCODE_SUB:
-    case OPCODE_MUL:
-    case OPCODE_AND:
-    case OPCODE_OR:
-    case OPCODE_EXOR:
-    case OPCODE_LDR:
-    case OPCODE_CMP:
-    case OPCODE_STORE: {
-      if ((cpu->status[iq_entry->rs1] == 1) && (cpu->status[iq_entry->rs2] == 1))
-        iq_entry->valid = true;
-      else
-        iq_entry->valid = false;
-      break;
-    }
-
-    case OPCODE_LOAD:
-    case OPCODE_ADDL:
-    case OPCODE_SUBL: {
-      if (cpu->status[iq_entry->rs1] == 1)
-        iq_entry->valid = true;
-      else
-        iq_entry->valid = false;
-      break;
-    }
-
-    case OPCODE_STR: {
-      if ((cpu->status[iq_entry->rs1] == 1) && (cpu->status[iq_entry->rs2] == 1) && (cpu->status[iq_entry->rs3] == 1))
-        iq_entry->valid = true;
-      else
-        iq_entry->valid = false;
-      break;
-    }
-
-    case OPCODE_MOVC: {
-      iq_entry->valid = true;
-      break;
-    }
-  }
+/**
+ * Method to check if every source register read by an instruction has been written
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param operands - OPERAND_* bits of the instruction
+ * @return true if the instruction can be issued
+ */
+static bool sources_ready(APEX_CPU *cpu, int operands, int rs1, int rs2, int rs3) {
+  return (!(operands & OPERAND_RS1) || cpu->status[rs1] == 1)
+      && (!(operands & OPERAND_RS2) || cpu->status[rs2] == 1)
+      && (!(operands & OPERAND_RS3) || cpu->status[rs3] == 1);
 }
 
 /* Converts the PC(4000 series) into array index for code memory
@@ -1375,288 +1411,335 @@ static void print_stage_content(const char *name, const CPU_Stage *stage) {
   printf("\n");
 }
 
-CPU_Stage pick_entry(APEX_CPU *cpu, char *function_unit) {
-  IQ_Entry *iq_entry;
-  CPU_Stage nop;
-  int earliest_request = 999999999;
+/*
+ * Position of an instruction in program order, the ROB head is the oldest instruction in flight
+ */
+static int rob_position(APEX_CPU *cpu, int rob_index) {
+  return (rob_index - cpu->reorder_buffer.head + ROB_SIZE) % ROB_SIZE;
+}
 
-  for (int i = 0; i <= IQ_SIZE; i++) {
-    if (i == IQ_SIZE) {
-      if (earliest_request == 999999999) {
-        nop = get_nop_stage(&nop);
-        return nop;
-      } else {
-        return remove_iq_entry(cpu, earliest_request);
-      }
-    } else {
-      if (cpu->iq_entry_used[i] == 1) {
-        iq_entry = &cpu->issue_queue[i];
-        if (iq_entry->valid) {
-
-          if (strcmp(function_unit, "intu") == 0) {
-            if (!(iq_entry->opcode == 8 || iq_entry->opcode == 9 || iq_entry->opcode == 15 || iq_entry->opcode == 16
-                || iq_entry->opcode == 2 || iq_entry->opcode == 0xc || iq_entry->opcode == 0x12
-                || iq_entry->opcode == 0x13 || iq_entry->opcode == 0x14)) {
-              if (iq_entry->cycle_number < earliest_request) {
-                earliest_request = i;
-              }
-            }
-          } else if (strcmp(function_unit, "mulu") == 0) {
-            if (iq_entry->opcode == 2) {
-              if (iq_entry->cycle_number < earliest_request) {
-                earliest_request = i;
-              }
-            }
-          } else if (strcmp(function_unit, "mem") == 0) {
-            if (iq_entry->opcode == 0x8 || iq_entry->opcode == 0x9 || iq_entry->opcode == 0xf
-                || iq_entry->opcode == 0x10) {
-              if (iq_entry->pc == cpu->reorder_buffer.buffer[cpu->reorder_buffer.head].pc_value) {
-                earliest_request = i;
-              }
-            }
-          } else if (strcmp(function_unit, "jbu") == 0) {
-            if (iq_entry->opcode == 0x13 || iq_entry->opcode == 0x14) {
-              if (iq_entry->cycle_number < earliest_request) {
-                earliest_request = i;
-              }
-            }
-          }
-        }
-      }
-    }
+/*
+ * Oldest entry of a ROB bitset at or after a position in program order, -1 if there is none. The
+ * occupied part of the buffer wraps around at most once, so this is at most two word scans.
+ */
+static int
+rob_next_member(APEX_CPU *cpu, const Bitset_Word *set, int position) {
+  int from = (cpu->reorder_buffer.head + position) % ROB_SIZE;
+  int to = cpu->reorder_buffer.head + cpu->reorder_buffer.count;
+  int index;
+
+  if (position >= cpu->reorder_buffer.count) {
+    return -1;
+  }
+  if (from >= cpu->reorder_buffer.head) {
+    index = bitset_next(set, from, (to < ROB_SIZE) ? to : ROB_SIZE);
+    if (index != -1 || to <= ROB_SIZE) return index;
+    from = 0;
   }
-  return get_nop_stage(&nop);
+  return bitset_next(set, from, to - ROB_SIZE);
 }
 
-CPU_Stage remove_iq_entry(APEX_CPU *cpu, int entry_index) {
-  CPU_Stage stage;
-  IQ_Entry *iq_entry = &cpu->issue_queue[entry_index];
-
-  switch (iq_entry->opcode) {
-    case OPCODE_ADD:
-    case OPCODE_SUB:
-    case OPCODE_MUL:
-    case OPCODE_AND:
-    case OPCODE_OR:
-    case OPCODE_EXOR: {
-      stage.pc = iq_entry->pc;
-      stage.opcode = iq_entry->opcode;
-      strcpy(stage.opcode_str, iq_entry->opcode_str);
-      stage.rs1 = iq_entry->rs1;
-      stage.rs2 = iq_entry->rs2;
-      stage.rd = iq_entry->rd;
-      stage.rd_arch = iq_entry->rd_arch;
-      stage.rs1_value = iq_entry->rs1_value;
-      stage.rs2_value = iq_entry->rs2_value;
-
-      cpu->iq_entry_used[entry_index] = 0;
-      break;
-    }
-
-    case OPCODE_ADDL:
-    case OPCODE_SUBL: {
-      stage.pc = iq_entry->pc;
-      stage.opcode = iq_entry->opcode;
-      strcpy(stage.opcode_str, iq_entry->opcode_str);
-      stage.rs1 = iq_entry->rs1;
-      stage.rd = iq_entry->rd;
-      stage.rd_arch = iq_entry->rd_arch;
-      stage.imm = iq_entry->imm;
-      stage.rs1_value = iq_entry->rs1_value;
-
-      cpu->iq_entry_used[entry_index] = 0;
-      break;
-    }
+/**
+ * Method to count the IQ entries still waiting for the result of an entry
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param iq_entry - producer
+ * @return number of consumers of its destination register in the issue queue
+ */
+static int count_dependents(APEX_CPU *cpu, IQ_Entry *iq_entry) {
+  Bitset_Word waiting[IQ_WORDS];
+  int dependents = 0;
 
-    case OPCODE_STR:
-    case OPCODE_LOAD:
-    case OPCODE_LDR:
-    case OPCODE_STORE: {
-      cpu->iq_entry_used[entry_index] = 0;
-      stage = get_nop_stage(&stage);
-      break;
-    }
+  if (iq_entry->rd < 0) return 0;
 
-    case OPCODE_CMP: {
-      stage.pc = iq_entry->pc;
-      stage.opcode = iq_entry->opcode;
-      strcpy(stage.opcode_str, iq_entry->opcode_str);
-      stage.rs1 = iq_entry->rs1;
-      stage.rs2 = iq_entry->rs2;
-      stage.rs1_value = iq_entry->rs1_value;
-      stage.rs2_value = iq_entry->rs2_value;
-
-      cpu->iq_entry_used[entry_index] = 0;
-      break;
-    }
+  /* Every reader of a register that has not been written is one of its consumers */
+  for (int w = 0; w < IQ_WORDS; w++) {
+    waiting[w] = cpu->consumers[iq_entry->rd][w] & cpu->iq_valid[w] & ~cpu->iq_ready[w];
+  }
+  for (int i = bitset_next(waiting, 0, IQ_SIZE); i >= 0; i = bitset_next(waiting, i + 1, IQ_SIZE)) {
+    IQ_Entry *consumer = &cpu->issue_queue[i];
 
-    case OPCODE_MOVC: {
-      stage.pc = iq_entry->pc;
-      stage.opcode = iq_entry->opcode;
-      strcpy(stage.opcode_str, iq_entry->opcode_str);
-      stage.rd = iq_entry->rd;
-      stage.rd_arch = iq_entry->rd_arch;
-      stage.imm = iq_entry->imm;
-
-      cpu->iq_entry_used[entry_index] = 0;
-      break;
+    if (consumer->rs1 == iq_entry->rd || consumer->rs2 == iq_entry->rd || consumer->rs3 == iq_entry->rd) {
+      dependents++;
     }
+  }
+  return dependents;
+}
 
-    case OPCODE_BZ:
-    case OPCODE_BNZ: {
-      stage.pc = iq_entry->pc;
-      stage.opcode = iq_entry->opcode;
-      strcpy(stage.opcode_str, iq_entry->opcode_str);
-      stage.imm = iq_entry->imm;
+/*
+ * xorshift32, the same seed gives the same issue order on every host
+ */
+static unsigned int next_random(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
 
-      cpu->iq_entry_used[entry_index] = 0;
-      break;
-    }
+/**
+ * Method to select the IQ entry issued to a function unit in this cycle. Among the valid entries
+ * executed by the unit, ISSUE_OLDEST_FIRST picks the oldest in program order, ISSUE_CRITICAL_PATH
+ * picks the one with the most consumers waiting in the IQ (oldest first on a tie) and ISSUE_RANDOM
+ * picks any of them.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param function_unit - FU_INTU, FU_MULU or FU_JBU
+ * @return stage holding the selected instruction, NOP if no entry is ready
+ */
+CPU_Stage pick_entry(APEX_CPU *cpu, int function_unit) {
+  CPU_Stage nop;
+  Bitset_Word candidates[IQ_WORDS];
+  int count;
+  int selected = -1;
+  int selected_dependents = 0;
 
-    case OPCODE_JUMP: {
-      stage.pc = iq_entry->pc;
-      stage.opcode = iq_entry->opcode;
-      strcpy(stage.opcode_str, iq_entry->opcode_str);
-      stage.rs1 = iq_entry->rs1;
-      stage.imm = iq_entry->imm;
-      stage.rs1_value = iq_entry->rs1_value;
+  for (int w = 0; w < IQ_WORDS; w++) {
+    candidates[w] = cpu->iq_valid[w] & cpu->iq_ready[w] & cpu->iq_unit[function_unit][w];
+  }
+  count = bitset_count(candidates, IQ_WORDS);
+  if (count == 0) {
+    return get_nop_stage(&nop);
+  }
 
-      cpu->iq_entry_used[entry_index] = 0;
+  /* The n-th candidate in the order of the issue queue */
+  if (cpu->issue_policy == ISSUE_RANDOM) {
+    int i = bitset_next(candidates, 0, IQ_SIZE);
 
-      break;
+    for (int n = next_random(&cpu->issue_seed) % count; n > 0; n--) {
+      i = bitset_next(candidates, i + 1, IQ_SIZE);
     }
+    return remove_iq_entry(cpu, i);
+  }
 
-    case OPCODE_JAL: {
-      stage.pc = iq_entry->pc;
-      stage.opcode = iq_entry->opcode;
-      strcpy(stage.opcode_str, iq_entry->opcode_str);
-      stage.rs1 = iq_entry->rs1;
-      stage.rd = iq_entry->rd;
-      stage.rd_arch = iq_entry->rd_arch;
-      stage.imm = iq_entry->imm;
-      stage.rs1_value = iq_entry->rs1_value;
-
-      cpu->iq_entry_used[entry_index] = 0;
-      break;
+  for (int i = bitset_next(candidates, 0, IQ_SIZE); i >= 0; i = bitset_next(candidates, i + 1, IQ_SIZE)) {
+    int dependents = (cpu->issue_policy == ISSUE_CRITICAL_PATH) ? count_dependents(cpu, &cpu->issue_queue[i]) : 0;
+
+    if (selected == -1 || dependents > selected_dependents
+        || (dependents == selected_dependents
+            && rob_position(cpu, cpu->iq_rob_index[i]) < rob_position(cpu, cpu->iq_rob_index[selected]))) {
+      selected = i;
+      selected_dependents = dependents;
     }
   }
-  return stage;
+  return remove_iq_entry(cpu, selected);
 }
 
-CPU_Stage remove_rob_entry(APEX_CPU *cpu) {
+CPU_Stage remove_iq_entry(APEX_CPU *cpu, int entry_index) {
   CPU_Stage stage;
-  ROB_Entry rob_entry = cpu->reorder_buffer.buffer[cpu->reorder_buffer.head];
-
-  switch (rob_entry.opcode) {
-
-    case OPCODE_LOAD: {
-      stage.pc = rob_entry.pc_value;
-      stage.opcode = rob_entry.opcode;
-      strcpy(stage.opcode_str, rob_entry.opcode_str);
-      stage.rd = rob_entry.rd_phy;
-      stage.rd_arch = rob_entry.rd_arch;
-      stage.rs1 = rob_entry.rs1;
-      stage.imm = rob_entry.imm;
-
-      increment_rob_head(cpu);
-      break;
-    }
-
-    case OPCODE_LDR: {
-      stage.pc = rob_entry.pc_value;
-      stage.opcode = rob_entry.opcode;
-      strcpy(stage.opcode_str, rob_entry.opcode_str);
-      stage.rd = rob_entry.rd_phy;
-      stage.rd_arch = rob_entry.rd_arch;
-      stage.rs1 = rob_entry.rs1;
-      stage.rs2 = rob_entry.rs2;
-
-      increment_rob_head(cpu);
-      break;
-    }
-
-    case OPCODE_STORE: {
-      stage.pc = rob_entry.pc_value;
-      stage.opcode = rob_entry.opcode;
-      strcpy(stage.opcode_str, rob_entry.opcode_str);
-      stage.rs1 = rob_entry.rs1;
-      stage.rs2 = rob_entry.rs2;
-      stage.imm = rob_entry.imm;
-
-      increment_rob_head(cpu);
-      break;
-    }
+  IQ_Entry *iq_entry = &cpu->issue_queue[entry_index];
 
-    case OPCODE_STR: {
-      stage.pc = rob_entry.pc_value;
-      stage.opcode = rob_entry.opcode;
-      strcpy(stage.opcode_str, rob_entry.opcode_str);
-      stage.rs1 = rob_entry.rs1;
-      stage.rs2 = rob_entry.rs2;
-      stage.rs3 = rob_entry.rs3;
-
-      increment_rob_head(cpu);
-      break;
-    }
+  stage = get_nop_stage(&stage);
+  stage.has_insn = TRUE;
+  stage.pc = iq_entry->pc;
+  stage.opcode = iq_entry->opcode;
+  stage.opcode_str = iq_entry->opcode_str;
+  stage.operands = iq_entry->operands;
+  stage.function_unit = iq_entry->function_unit;
+  stage.rd = iq_entry->rd;
+  stage.rd_arch = iq_entry->rd_arch;
+  stage.rs1 = iq_entry->rs1;
+  stage.rs2 = iq_entry->rs2;
+  stage.rs3 = iq_entry->rs3;
+  stage.rs1_value = iq_entry->rs1_value;
+  stage.rs2_value = iq_entry->rs2_value;
+  stage.rs3_value = iq_entry->rs3_value;
+  stage.imm = iq_entry->imm;
+  stage.rob_index = cpu->iq_rob_index[entry_index];
+  stage.branch_tag = iq_entry->branch_tag;
+  for (int tag = 0; tag < MAX_BRANCHES; tag++) {
+    if (bitset_test(cpu->iq_branch[tag], entry_index)) stage.branch_mask |= 1 << tag;
   }
-  IQ_Entry *entry;
-  for (int i = 0; i < IQ_SIZE; i++) {
-    entry = &cpu->issue_queue[i];
-    if (entry->pc == stage.pc) {
-      cpu->iq_entry_used[i] = 0;
-      break;
-    }
+  stage.fused = iq_entry->fused;
+  stage.fused_opcode = iq_entry->fused_opcode;
+  stage.fused_imm = iq_entry->fused_imm;
+  stage.flag_rs = iq_entry->flag_rs;
+  stage.flag_rd = iq_entry->flag_rd;
+
+  bitset_clear(cpu->iq_valid, entry_index);
+  bitset_clear(cpu->iq_ready, entry_index);
+  bitset_clear(cpu->iq_unit[iq_entry->function_unit], entry_index);
+  for (int tag = 0; tag < MAX_BRANCHES; tag++) {
+    bitset_clear(cpu->iq_branch[tag], entry_index);
+  }
+  return stage;
+}
+
+/**
+ * Method to send a memory instruction waiting in the ROB to M1, the entry stays in the ROB until it retires
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param entry_index - index of the ROB entry
+ * @return M1 stage of the instruction
+ */
+CPU_Stage issue_rob_entry(APEX_CPU *cpu, int entry_index) {
+  CPU_Stage stage;
+  ROB_Entry *rob_entry = &cpu->reorder_buffer.buffer[entry_index];
+
+  stage = get_nop_stage(&stage);
+  stage.has_insn = TRUE;
+  stage.pc = rob_entry->pc_value;
+  stage.opcode = rob_entry->opcode;
+  stage.opcode_str = rob_entry->opcode_str;
+  stage.operands = rob_entry->operands;
+  stage.function_unit = FU_MEM;
+  stage.rd = rob_entry->rd_phy;
+  stage.rd_arch = rob_entry->rd_arch;
+  stage.rs1 = rob_entry->rs1;
+  stage.rs2 = rob_entry->rs2;
+  stage.rs3 = rob_entry->rs3;
+  stage.imm = rob_entry->imm;
+  stage.rob_index = entry_index;
+  for (int tag = 0; tag < MAX_BRANCHES; tag++) {
+    if (bitset_test(cpu->reorder_buffer.branch[tag], entry_index)) stage.branch_mask |= 1 << tag;
   }
+  stage.fused = rob_entry->fused;
+  stage.fused_opcode = rob_entry->fused_opcode;
+  stage.fused_imm = rob_entry->fused_imm;
+  stage.fused_rd = rob_entry->fused_rd_phy;
+  stage.fused_rd_arch = rob_entry->fused_rd_arch;
+  bitset_clear(cpu->reorder_buffer.memory_pending, entry_index);
 
   return stage;
 }
 
 /*
- * This function creates and initializes APEX cpu.
+ * This function creates and initializes APEX cpu around an already parsed code memory image.
+ * The image is only read, so any number of cpus (on any number of threads) may share it; the caller
+ * keeps ownership unless owns_code_memory is set afterwards.
  *
  * Note: You are free to edit this function according to your implementation
  */
 APEX_CPU *
-APEX_cpu_init(const char *filename) {
-  int i;
+APEX_cpu_init_from_image(const APEX_Instruction *code_memory, int code_memory_size) {
+  APEX_Arena *arena;
   APEX_CPU *cpu;
 
-  if (!filename) {
+  if (!code_memory) {
     return NULL;
   }
 
-  cpu = calloc(1, sizeof(APEX_CPU));
+  /* Everything the cpu allocates comes from its arena, a run within the reserve never calls malloc */
+  arena = arena_create(ARENA_RESERVE + (size_t) code_memory_size * ARENA_BYTES_PER_INSN);
+  if (!arena) {
+    return NULL;
+  }
 
+  /* The issue queue and ROB bitsets start on a host cache line of their own */
+  cpu = arena_alloc(arena, sizeof(APEX_CPU), HOST_CACHE_LINE);
   if (!cpu) {
+    arena_destroy(arena);
+    return NULL;
+  }
+  cpu->arena = arena;
+
+  cpu->uops = create_uop_cache(arena, code_memory, code_memory_size);
+  cpu->hierarchy = hierarchy_create(arena);
+  cpu->data_memory = memory_create(arena);
+  if (!cpu->uops || !cpu->hierarchy || !cpu->data_memory) {
+    arena_destroy(arena);
     return NULL;
   }
 
   /* Initialize PC, Registers and all pipeline stages */
   cpu->pc = 4000;
-  memset(cpu->data_memory, 0, sizeof(int) * DATA_MEMORY_SIZE);
-  memset(cpu->iq_entry_used, 0, sizeof(int) * DATA_MEMORY_SIZE);
+  release_all_iq_entries(cpu);
   memset(cpu->regs, 0, sizeof(int) * REG_FILE_SIZE);
   memset(cpu->status, 0, sizeof(int) * REG_FILE_SIZE);
-  memset(cpu->rat, -1, sizeof(int) * RENAME_TABLE_SIZE);
-  memset(cpu->r_rat, -1, sizeof(int) * RENAME_TABLE_SIZE);
   memset(cpu->rat_status, 0, sizeof(int) * RENAME_TABLE_SIZE);
   memset(cpu->r_rat_status, 0, sizeof(int) * RENAME_TABLE_SIZE);
   memset(cpu->allocation_list, 0, sizeof(int) * REG_FILE_SIZE);
 
+  /* Architectural registers start out mapped to the first physical registers, holding 0 */
+  for (int i = 0; i < RENAME_TABLE_SIZE; i++) {
+    cpu->rat[i] = i;
+    cpu->r_rat[i] = i;
+    cpu->allocation_list[i] = 1;
+    cpu->status[i] = 1;
+  }
+
   cpu->single_step = ENABLE_SINGLE_STEP;
   cpu->clock = 1;
   cpu->reorder_buffer = get_reorder_buffer();
   cpu->rob_full = false;
   cpu->iq_full = false;
   cpu->mulu_count = 0;
-  cpu->zero_flag = false;
+  cpu->flag_allocation[0] = 1;
+  cpu->flag_status[0] = 1;
+  cpu->flags[0] = FALSE;
+  cpu->flag_rat = 0;
+  cpu->flag_r_rat = 0;
+  cpu->event_driven = ENABLE_EVENT_DRIVEN;
+  cpu->cycles_skipped = 0;
+  cpu->commit_width = COMMIT_WIDTH;
+  cpu->issue_policy = ISSUE_OLDEST_FIRST;
+  cpu->issue_seed = 1;
+  cpu->load_speculation = LOAD_SPECULATION_STORE_SETS;
+  cpu->eliminate = TRUE;
+  cpu->fusion = FUSE_NONE;
+  memset(cpu->store_set_table, -1, sizeof(cpu->store_set_table));
+  cpu->next_store_set = 0;
+  cpu->use_jit = FALSE;
+  cpu->prefetch_degree = PREFETCH_DEGREE;
+  cpu->caches = CACHES_L2;
+  cpu->l1d = &cpu->hierarchy->level[LEVEL_L1D].cache;
+  cpu->l1i = &cpu->hierarchy->level[LEVEL_L1I].cache;
+  cpu->fetch_line = -1;
+  cpu->halted = FALSE;
+  cpu->branch_mask = 0;
+  cpu->branch_mispredictions = 0;
+  cpu->insn_squashed = 0;
+  cpu->loads_speculated = 0;
+  cpu->memory_violations = 0;
+  cpu->false_dependences = 0;
+
+  /* Function units start out holding bubbles */
+  get_nop_stage(&cpu->intu);
+  get_nop_stage(&cpu->mulu);
+  get_nop_stage(&cpu->m1);
+  get_nop_stage(&cpu->m2);
+  get_nop_stage(&cpu->jbu1);
+  get_nop_stage(&cpu->jbu2);
+
+  cpu->code_memory = code_memory;
+  cpu->code_memory_size = code_memory_size;
+  cpu->owns_code_memory = FALSE;
+  cpu->debug_messages = 0;
+
+  /* To start fetch stage */
+  cpu->fetch.has_insn = TRUE;
+  return cpu;
+}
+
+/*
+ * This function parses the input file and creates APEX cpu owning the resulting code memory.
+ *
+ * Note: You are free to edit this function according to your implementation
+ */
+APEX_CPU *
+APEX_cpu_init(const char *filename) {
+  int i;
+  int code_memory_size;
+  APEX_Instruction *code_memory;
+  APEX_CPU *cpu;
+
+  if (!filename) {
+    return NULL;
+  }
 
   /* Parse input file and create code memory */
-  cpu->code_memory = create_code_memory(filename, &cpu->code_memory_size);
-  if (!cpu->code_memory) {
-    free(cpu);
+  code_memory = create_code_memory(filename, &code_memory_size);
+  if (!code_memory) {
+    return NULL;
+  }
+
+  cpu = APEX_cpu_init_from_image(code_memory, code_memory_size);
+  if (!cpu) {
+    free(code_memory);
     return NULL;
   }
+  cpu->owns_code_memory = TRUE;
   cpu->debug_messages = 1;
 
   if (cpu->debug_messages) {
@@ -1676,72 +1759,320 @@ APEX_cpu_init(const char *filename) {
     printf("-----------------------------------------------------------\n");
 
   }
-  cpu->debug_messages = 0;
+  cpu->debug_messages = 0;
+
+  // print_reg_file(cpu);
+  return cpu;
+}
+
+/*
+ * Blocks the arenas of the cpu and of its data memory have taken from the heap. The data memory of a
+ * core of a multi-core system is shared, its growth is counted once by APEX_system_run().
+ */
+static int
+arena_heap_allocations(APEX_CPU *cpu) {
+  int blocks = cpu->arena->heap_allocations;
+
+  if (!cpu->system && cpu->data_memory->arena != cpu->arena) {
+    blocks += cpu->data_memory->arena->heap_allocations;
+  }
+  return blocks;
+}
+
+/*
+ * APEX CPU simulation loop, returns early at the end of the cycle in which an armed run-until
+ * predicate hits (cpu->stop)
+ *
+ * Note: You are free to edit this function according to your implementation
+ */
+void
+APEX_cpu_run(APEX_CPU *cpu, int count, bool print_contents) {
+  bool run = true;
+  int cycle = 0;
+  int idle_cycles;
+  int heap_allocations = arena_heap_allocations(cpu);
+  if (count > 0) cpu->single_step = 0;
+  cpu->stop.hit = 0;
+  if (print_contents) cpu->debug_messages = 1;
+  else cpu->debug_messages = 0;
+
+  while (run) {
+    if (count == 0) run = false;
+
+    if (cpu->debug_messages) {
+      printf("\n--------------------------------------------\n");
+      printf("Clock Cycle #: %d\n", cpu->clock);
+      printf("--------------------------------------------\n");
+    }
+
+    if (cpu->decode.opcode == 0xc) {
+//      cpu->fetch_from_next_cycle = true;
+//      if (issue_queue_empty(cpu) && rob_empty(cpu)) {
+//
+//        if (cpu->mulu_count == 0 && cpu->m1.opcode == 0x12 && cpu->m2.opcode == 0x12 && cpu->jbu1.opcode == 0x12
+//            && cpu->jbu2.opcode == 0x12 && cpu->intu.opcode == 0x12 && cpu->fetch.has_insn == true) {
+//          printf("\nAPEX_CPU: Simulation Complete, cycles = %d instructions retired = %d\n",
+//                 cpu->clock, cpu->insn_completed);
+//          break;
+//        }
+//      }
+    }
+
+    /* An idle cycle is simulated once so the latches settle, the rest of the idle stretch is skipped */
+    idle_cycles = (cpu->event_driven && count > 0) ? cycles_until_next_event(cpu) : 0;
+
+    APEX_commit(cpu);
+    APEX_execute(cpu);
+    APEX_decode(cpu);
+    APEX_fetch(cpu);
+
+    if (idle_cycles > 1) {
+      int skip = (idle_cycles - 1 < count - cycle - 1) ? idle_cycles - 1 : count - cycle - 1;
+      int horizon = INT_MAX;
+
+      /* Never skip past the cycle a run has to stop at, the next state hash of a replay log or the next snapshot */
+      if (cpu->stop.armed & STOP_AT_CYCLE) horizon = cpu->stop.cycle;
+      if (cpu->replay && cpu->replay->next_checkpoint < horizon) horizon = cpu->replay->next_checkpoint;
+      if (cpu->snapshots && cpu->snapshots->next_cycle < horizon) horizon = cpu->snapshots->next_cycle;
+      if (skip > horizon - cpu->clock - 1) {
+        skip = (horizon - cpu->clock - 1 > 0) ? horizon - cpu->clock - 1 : 0;
+      }
+      skip_idle_cycles(cpu, skip);
+      cycle += skip;
+    }
+
+    if (cycle == count - 1 && count != 0) {
+      run = false;
+      cpu->single_step = 1;
+    }
+
+    cpu->clock++;
+    cycle++;
+
+    if (cpu->replay && cpu->clock >= cpu->replay->next_checkpoint) {
+      replay_checkpoint(cpu);
+    }
+    if (cpu->snapshots && cpu->clock >= cpu->snapshots->next_cycle) {
+      snapshot_periodic(cpu);
+    }
+
+    if (cpu->stop.armed | cpu->stop.hit) {
+      if ((cpu->stop.armed & STOP_AT_CYCLE) && cpu->clock >= cpu->stop.cycle) {
+        cpu->stop.hit |= STOP_AT_CYCLE;
+        cpu->stop.armed &= ~STOP_AT_CYCLE;
+      }
+      if (cpu->stop.hit) {
+        run = false;
+        cpu->single_step = 1;
+      }
+    }
+  }
+
+  /* Hook for checking that a run in steady state never goes to the heap */
+  cpu->run_allocations += arena_heap_allocations(cpu) - heap_allocations;
+}
+
+/*
+ * Runs the cpu until the pipeline has drained after HALT or max_cycles have elapsed
+ *
+ * Returns true if the program ran to completion, i.e. HALT has retired
+ */
+bool
+APEX_cpu_run_to_halt(APEX_CPU *cpu, int max_cycles) {
+  while (cpu->clock <= max_cycles) {
+    int idle = cycles_until_next_event(cpu);
+
+    if (idle == INT_MAX) {
+      return cpu->halted;
+    }
+    /* An idle stretch is run as one chunk, so the event-driven mode can skip it */
+    if (!cpu->event_driven || idle < 1) idle = 1;
+    if (idle > max_cycles - cpu->clock + 1) idle = max_cycles - cpu->clock + 1;
+    APEX_cpu_run(cpu, idle, false);
+  }
+  return false;
+}
+
+/*
+ * This function deallocates APEX CPU. Only what lives outside of the arena is released one by one:
+ * the replay log, snapshots, mapped images, the code cache of the jit and owned code memory.
+ *
+ * Note: You are free to edit this function according to your implementation
+ */
+void
+APEX_cpu_stop(APEX_CPU *cpu) {
+  replay_close(cpu);
+  snapshots_destroy(cpu);
+
+  /* Shared data memory is owned by the system */
+  if (!cpu->system) memory_destroy(cpu->data_memory);
+  if (cpu->owns_code_memory) free((void *) cpu->code_memory);
+  jit_destroy(cpu->jit);
+  arena_destroy(cpu->arena);
+}
+
+/**
+ * Method to replace the data prefetcher, it fills the L1D of the hierarchy, or the coherent L1 of a
+ * core of a multi-core system. The old one stays in the arena until the cpu is stopped.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param kind - PREFETCH_* number of the new prefetcher
+ * @return false if the prefetcher cannot be allocated
+ */
+static bool
+set_data_prefetcher(APEX_CPU *cpu, int kind) {
+  cpu->data_prefetcher = NULL;
+  if (kind == PREFETCH_NONE) {
+    return true;
+  }
+
+  cpu->data_prefetcher = prefetcher_create(cpu->arena, kind, cpu->prefetch_degree, DATA_MEMORY_SIZE / CACHE_LINE_SIZE,
+                                           cpu->l1d, cpu, prefetch_data_line);
+  if (!cpu->data_prefetcher) {
+    fprintf(stderr, "APEX_Error: Unable to allocate the data prefetcher\n");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Method to replace the next-N-line instruction prefetcher of L1I, the old one stays in the arena
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param lines - N, 0 to turn instruction prefetching off
+ * @return false if the prefetcher cannot be allocated
+ */
+static bool
+set_inst_prefetcher(APEX_CPU *cpu, int lines) {
+  cpu->inst_prefetcher = NULL;
+  if (lines == 0) {
+    return true;
+  }
+
+  cpu->inst_prefetcher = prefetcher_create(cpu->arena, PREFETCH_NEXT_LINE, lines,
+                                           cache_line_address(cpu->code_memory_size + CACHE_LINE_SIZE - 1),
+                                           cpu->l1i, cpu, prefetch_code_line);
+  if (!cpu->inst_prefetcher) {
+    fprintf(stderr, "APEX_Error: Unable to allocate the instruction prefetcher\n");
+    return false;
+  }
+  return true;
+}
+
+/* Changes a tunable parameter, false if it is unknown or the value is out of range */
+static bool
+set_parameter(APEX_CPU *cpu, const char *name, int value) {
+  if (strcmp(name, "commit_width") == 0 && value >= 1 && value <= ROB_SIZE) {
+    cpu->commit_width = value;
+    return true;
+  }
+  if (strcmp(name, "issue_policy") == 0 && value >= ISSUE_OLDEST_FIRST && value <= ISSUE_CRITICAL_PATH) {
+    cpu->issue_policy = value;
+    return true;
+  }
+  if (strcmp(name, "load_speculation") == 0 && value >= LOAD_SPECULATION_NONE && value <= LOAD_SPECULATION_ALWAYS) {
+    cpu->load_speculation = value;
+    return true;
+  }
+  if (strcmp(name, "eliminate") == 0 && (value == FALSE || value == TRUE)) {
+    cpu->eliminate = value;
+    return true;
+  }
+  if (strcmp(name, "fusion") == 0 && value >= FUSE_NONE && value <= FUSE_ALL) {
+    cpu->fusion = value;
+    return true;
+  }
+  if (strcmp(name, "issue_seed") == 0 && value != 0) {
+    cpu->issue_seed = value;
+    return true;
+  }
+  if (strcmp(name, "jit") == 0 && (value == FALSE || value == TRUE)) {
+    cpu->use_jit = value;
+    return true;
+  }
+  if (strcmp(name, "prefetcher") == 0 && value >= PREFETCH_NONE && value <= PREFETCH_STREAM) {
+    return set_data_prefetcher(cpu, value);
+  }
+  if (strcmp(name, "prefetch_degree") == 0 && value >= 1 && value <= PREFETCH_MAX_DEGREE) {
+    cpu->prefetch_degree = value;
+    if (cpu->data_prefetcher) cpu->data_prefetcher->degree = value;
+    return true;
+  }
+  if (strcmp(name, "iprefetch") == 0 && value >= 0 && value <= PREFETCH_MAX_DEGREE) {
+    return set_inst_prefetcher(cpu, value);
+  }
+  if (strcmp(name, "caches") == 0 && value >= CACHES_NONE && value <= CACHES_L3) {
+    cpu->caches = value;
+    cpu->hierarchy->use_l3 = (value == CACHES_L3);
+    return true;
+  }
+  if (strcmp(name, "dram_banks") == 0 && value >= 1 && value <= DRAM_MAX_BANKS) {
+    cpu->hierarchy->dram.banks = value;
+    return true;
+  }
+  if (strcmp(name, "dram_queue") == 0 && value >= 1 && value <= DRAM_MAX_QUEUE) {
+    cpu->hierarchy->dram.queue_depth = value;
+    return true;
+  }
 
-  /* To start fetch stage */
-  cpu->fetch.has_insn = TRUE;
-  // print_reg_file(cpu);
-  return cpu;
+  fprintf(stderr, "APEX_Error: Invalid setting %s = %d\n", name, value);
+  return false;
 }
 
-/*
- * APEX CPU simulation loop
+/**
+ * Method to change a tunable parameter of the cpu. Time travel cannot go back across a change, so the
+ * snapshots start over from the current cycle.
  *
- * Note: You are free to edit this function according to your implementation
+ * @param cpu pointer to current instance of cpu
+ * @param name - of the parameter
+ * @param value - new value
+ * @return false if the parameter is unknown or the value is out of range
  */
-void
-APEX_cpu_run(APEX_CPU *cpu, int count, bool print_contents) {
-  bool run = true;
-  int cycle = 0;
-  if (count > 0) cpu->single_step = 0;
-  if (print_contents) cpu->debug_messages = 1;
-  else cpu->debug_messages = 0;
-
-  while (run) {
-    if (count == 0) run = false;
-
-    if (cpu->debug_messages) {
-      printf("\n--------------------------------------------\n");
-      printf("Clock Cycle #: %d\n", cpu->clock);
-      printf("--------------------------------------------\n");
-    }
-
-    if (cpu->decode.opcode == 0xc) {
-//      cpu->fetch_from_next_cycle = true;
-//      if (issue_queue_empty(cpu) && rob_empty(cpu)) {
-//
-//        if (cpu->mulu_count == 0 && cpu->m1.opcode == 0x12 && cpu->m2.opcode == 0x12 && cpu->jbu1.opcode == 0x12
-//            && cpu->jbu2.opcode == 0x12 && cpu->intu.opcode == 0x12 && cpu->fetch.has_insn == true) {
-//          printf("\nAPEX_CPU: Simulation Complete, cycles = %d instructions retired = %d\n",
-//                 cpu->clock, cpu->insn_completed);
-//          break;
-//        }
-//      }
-    }
-
-    APEX_execute(cpu);
-    APEX_decode(cpu);
-    APEX_fetch(cpu);
+bool APEX_cpu_set(APEX_CPU *cpu, const char *name, int value) {
+  bool valid;
 
-    if (cycle == count - 1 && count != 0) {
-      run = false;
-      cpu->single_step = 1;
-    }
+  /* Tick and event mode run the same cycles, switching is neither recorded nor a new history */
+  if (strcmp(name, "event") == 0 && (value == FALSE || value == TRUE)) {
+    cpu->event_driven = value;
+    return true;
+  }
+  if (cpu->replay) {
+    replay_input(cpu, "set %s %d", name, value);
+  }
+  if (strcmp(name, "snapshots") == 0 && value >= 0) {
+    return snapshots_enable(cpu, value);
+  }
 
-    cpu->clock++;
-    cycle++;
+  valid = set_parameter(cpu, name, value);
+  if (valid && cpu->snapshots) {
+    snapshots_reset(cpu);
   }
+  return valid;
 }
 
-/*
- * This function deallocates APEX CPU.
+/**
+ * Method to apply settings of the form <name>=<value>
  *
- * Note: You are free to edit this function according to your implementation
+ * @param cpu pointer to current instance of cpu
+ * @param num_settings - number of settings
+ * @param settings - settings to be applied in order
+ * @return false if any setting is malformed or rejected by APEX_cpu_set()
  */
-void
-APEX_cpu_stop(APEX_CPU *cpu) {
-  free(cpu->code_memory);
-  free(cpu);
+bool APEX_cpu_apply_settings(APEX_CPU *cpu, int num_settings, const char **settings) {
+  bool valid = true;
+
+  for (int i = 0; i < num_settings; i++) {
+    char name[64];
+    int value;
+
+    if (sscanf(settings[i], "%63[^=]=%d", name, &value) != 2) {
+      fprintf(stderr, "APEX_Error: Invalid setting %s, expected <name>=<value>\n", settings[i]);
+      valid = false;
+    } else if (!APEX_cpu_set(cpu, name, value)) {
+      valid = false;
+    }
+  }
+  return valid;
 }
 
 /**
@@ -1776,12 +2107,17 @@ void print_mem(APEX_CPU *cpu) {
   printf("|            State of Data Memory            |\n");
   printf("----------------------------------------------\n");
   int count = 0;
-  for (int i = 0; i < DATA_MEMORY_SIZE; i++) {
-    if (cpu->data_memory[i] != 0) {
-      printf("|   Memory [%4d]   |   Data Value: %-7d  |\n", i, cpu->data_memory[i]);
-      count++;
+  for (int page = 0; page < DATA_MEMORY_SIZE && count < 10; page += MEMORY_PAGE_SIZE) {
+    /* Pages that were never written hold no data */
+    if (!memory_page(cpu->data_memory, page, false)) continue;
+
+    for (int i = page; i < page + MEMORY_PAGE_SIZE; i++) {
+      if (memory_read(cpu->data_memory, i) != 0) {
+        printf("|   Memory [%4d]   |   Data Value: %-7d  |\n", i, memory_read(cpu->data_memory, i));
+        count++;
+      }
+      if (count == 10) break;
     }
-    if (count == 10) break;
   }
   if (count == 0) {
     printf("|       all memory location are empty        |\n");
@@ -1789,6 +2125,19 @@ void print_mem(APEX_CPU *cpu) {
   printf("----------------------------------------------\n");
 }
 
+static const char *issue_policy_name[] = {"oldest-first", "random", "critical-path"};
+static const char *load_speculation_name[] = {"in order", "store sets", "always speculate"};
+
+/* Store sets that some load or store belongs to */
+static int store_sets_in_use(APEX_CPU *cpu) {
+  unsigned int used = 0;
+
+  for (int i = 0; i < STORE_SET_TABLE_SIZE; i++) {
+    if (cpu->store_set_table[i] != -1) used |= 1U << cpu->store_set_table[i];
+  }
+  return __builtin_popcount(used);
+}
+
 /**
  * Method to display state of cpu, contents of each stage, contents of ARF and Data Memory
  *
@@ -1799,7 +2148,28 @@ void display(APEX_CPU *cpu) {
   printf("                    CPU Details                  \n");
   printf("-------------------------------------------------\n");
   printf("|   Instructions : %2d    Retired    : %-4d       |\n", cpu->code_memory_size, cpu->insn_completed);
-  printf("|   Cycles       : %2d    Zero flag  : %-5s      |\n", cpu->clock, (cpu->zero_flag) ? "True" : "False");
+  printf("|   Cycles       : %2d    Zero flag  : %-5s      |\n", cpu->clock,
+         (cpu->flags[cpu->flag_r_rat]) ? "True" : "False");
+  printf("|   Mode         : %-5s Skipped    : %-4d       |\n", (cpu->event_driven) ? "event" : "tick",
+         cpu->cycles_skipped);
+  printf("|   Arena KB     : %-5zu Run allocs : %-4d       |\n", cpu->arena->bytes_used / 1024,
+         cpu->run_allocations);
+  printf("|   IPC          : %-5.2f Commit     : %-4d       |\n",
+         (cpu->clock > 1) ? (double) cpu->insn_completed / (cpu->clock - 1) : 0.0, cpu->commit_width);
+  printf("|   Mispredicted : %-5d Squashed   : %-4d       |\n", cpu->branch_mispredictions,
+         cpu->insn_squashed);
+  printf("|   Issue        : %-29s|\n", issue_policy_name[cpu->issue_policy]);
+  printf("|   Loads        : %-29s|\n", load_speculation_name[cpu->load_speculation]);
+  printf("|   Speculated   : %-5d Violations : %-4d       |\n", cpu->loads_speculated, cpu->memory_violations);
+  printf("|   False deps   : %-5d Store sets : %-4d       |\n", cpu->false_dependences, store_sets_in_use(cpu));
+  printf("|   MOVC elim    : %-5d Zero idioms: %-4d       |\n", cpu->ops_eliminated[ELIMINATED_CONSTANT],
+         cpu->ops_eliminated[ELIMINATED_ZERO_IDIOM]);
+  printf("|   Folded       : %-5d Moves      : %-4d       |\n", cpu->ops_eliminated[ELIMINATED_FOLDED],
+         cpu->ops_eliminated[ELIMINATED_MOVE]);
+  printf("|   Fused branch : %-5d Fused loads: %-4d       |\n", cpu->compare_branches_fused,
+         cpu->address_loads_fused);
+  if (cpu->data_prefetcher) print_prefetch_stats(cpu->data_prefetcher, "L1D");
+  if (cpu->inst_prefetcher) print_prefetch_stats(cpu->inst_prefetcher, "L1I");
 
   print_stage_contents(&cpu->fetch, "Fetch");
   print_stage_contents(&cpu->decode, "Decode");
@@ -1822,7 +2192,8 @@ void print_stage_contents(CPU_Stage *stage, char *name) {
   printf("                 Stage: %-6s                   \n", name);
   printf("-------------------------------------------------\n");
 
-  printf("|   pc  : %4d       Opcode         : %-5s     |\n", stage->pc, stage->opcode_str);
+  /* Latches that have never held an instruction have no opcode */
+  printf("|   pc  : %4d       Opcode         : %-5s     |\n", stage->pc, stage->opcode_str ? stage->opcode_str : "");
   printf("|   rd  : R%-2d        result_buffer  : %-5d     |\n", stage->rd, stage->result_buffer);
   printf("|   rs1 : R%-2d        rs1_value      : %-5d     |\n", stage->rs1, stage->rs1_value);
   printf("|   rs2 : R%-2d        rs2_value      : %-5d     |\n", stage->rs2, stage->rs2_value);
@@ -1841,7 +2212,7 @@ void show_mem(APEX_CPU *cpu, int address) {
   printf("\n-----------------------------------\n");
   printf("|     Address     |     Content   |\n");
   printf("-----------------------------------\n");
-  printf("|     %d          |     %7d    |\n", address, cpu->data_memory[address]);
+  printf("|     %d          |     %7d    |\n", address, memory_read(cpu->data_memory, address));
   printf("-----------------------------------\n");
 }
 
@@ -1854,7 +2225,9 @@ void show_mem(APEX_CPU *cpu, int address) {
 CPU_Stage get_nop_stage(CPU_Stage *nop) {
   nop->pc = 0;
   nop->has_insn = FALSE;
-  nop->opcode = 0x12;
+  nop->opcode = OPCODE_NOP;
+  nop->operands = 0;
+  nop->function_unit = FU_NONE;
   nop->rs1 = -1;
   nop->rs2 = -1;
   nop->rs3 = -1;
@@ -1862,100 +2235,495 @@ CPU_Stage get_nop_stage(CPU_Stage *nop) {
   nop->rs2_value = 0;
   nop->rs3_value = 0;
   nop->rd = -1;
+  nop->rd_arch = -1;
+  nop->rob_index = -1;
+  nop->branch_mask = 0;
+  nop->branch_tag = -1;
   nop->imm = 0;
   nop->result_buffer = 0;
   nop->memory_address = 0;
-  strcpy(nop->opcode_str, "NOP");
+  nop->ready_cycle = 0;
+  nop->eliminated = ELIMINATED_NONE;
+  nop->fused = FUSE_NONE;
+  nop->fused_rd = -1;
+  nop->fused_rd_arch = -1;
+  nop->flag_rs = -1;
+  nop->flag_rd = -1;
+  nop->opcode_str = opcode_info[OPCODE_NOP].name;
   return *nop;
 }
 
 ROB_Queue get_reorder_buffer() {
   ROB_Queue queue;
-  queue.head = -1;
+  memset(&queue, 0, sizeof(ROB_Queue));
+  queue.head = 0;
   queue.tail = 0;
+  queue.count = 0;
   return queue;
 }
 
 bool queue_insert(APEX_CPU *cpu, ROB_Entry rob_entry) {
-  if (cpu->reorder_buffer.tail == 64) cpu->reorder_buffer.tail %= 64;
-  else if (cpu->reorder_buffer.head == 64) cpu->reorder_buffer.head %= 64;
-
-  if (cpu->reorder_buffer.head == -1) {
-    cpu->reorder_buffer.head = 0;
-    cpu->reorder_buffer.tail = 0;
+  if (cpu->reorder_buffer.count == ROB_SIZE) {
+    cpu->rob_full = true;
+    return false;
   }
 
   cpu->reorder_buffer.buffer[cpu->reorder_buffer.tail] = rob_entry;
   increment_rob_tail(cpu);
-
-  if (cpu->reorder_buffer.tail == cpu->reorder_buffer.head) {
-    cpu->rob_full = true;
-    return false;
-  }
   return true;
 }
 
 bool increment_rob_head(APEX_CPU *cpu) {
   cpu->reorder_buffer.head++;
   if (cpu->reorder_buffer.head >= ROB_SIZE) cpu->reorder_buffer.head %= ROB_SIZE;
+  cpu->reorder_buffer.count--;
+  cpu->rob_full = false;
   return true;
 }
 
 bool increment_rob_tail(APEX_CPU *cpu) {
   cpu->reorder_buffer.tail++;
   if (cpu->reorder_buffer.tail >= ROB_SIZE) cpu->reorder_buffer.tail %= ROB_SIZE;
+  cpu->reorder_buffer.count++;
+  cpu->rob_full = cpu->reorder_buffer.count == ROB_SIZE;
   return true;
 }
 
 bool rob_empty(APEX_CPU *cpu) {
-  if ((cpu->reorder_buffer.head == -1 && cpu->reorder_buffer.tail == 0)
-      || (cpu->reorder_buffer.tail == cpu->reorder_buffer.head))
-    return true;
-  else
-    return false;
+  return cpu->reorder_buffer.count == 0;
 }
 
-void validate_rob_entries(APEX_CPU *cpu) {
-  if (!rob_empty(cpu)) {
-    int entry_index = cpu->reorder_buffer.head;
+bool issue_queue_full(APEX_CPU *cpu) {
+  return bitset_count(cpu->iq_valid, IQ_WORDS) == IQ_SIZE;
+}
+
+bool is_memory_instruction(int opcode) {
+  return opcode_info[opcode].function_unit == FU_MEM;
+}
+
+/**
+ * Method to check if an instruction writes a register
+ *
+ * @param opcode - of the instruction
+ * @return true if the instruction is allocated a physical register at rename
+ */
+bool has_destination(int opcode) {
+  return opcode_info[opcode].operands & OPERAND_RD;
+}
+
+/**
+ * Method to mark the ROB entry of an instruction leaving its function unit as ready to retire
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param stage - function unit holding the instruction, bubbles are ignored
+ */
+void complete_rob_entry(APEX_CPU *cpu, CPU_Stage *stage) {
+  if (stage->rob_index != -1) {
+    cpu->reorder_buffer.buffer[stage->rob_index].status = 1;
+  }
+}
+
+/* Address a memory instruction in the ROB accesses, its sources must be ready */
+static int
+rob_entry_address(APEX_CPU *cpu, const ROB_Entry *entry) {
+  int rs1_value = (entry->operands & OPERAND_RS1) ? cpu->regs[entry->rs1] : 0;
+  int rs2_value = (entry->operands & OPERAND_RS2) ? cpu->regs[entry->rs2] : 0;
+  int rs3_value = (entry->operands & OPERAND_RS3) ? cpu->regs[entry->rs3] : 0;
+
+  /* Base of a fused load is the result of its ADDL */
+  if (entry->fused == FUSE_ADDRESS_LOAD) rs1_value += entry->fused_imm;
+  return memory_address(entry->opcode, rs1_value, rs2_value, rs3_value, entry->imm);
+}
+
+/*
+ * Store of a store set leaving for M1, the loads of its set held for it had a true dependence if they
+ * read the address it writes
+ */
+static void
+release_held_loads(APEX_CPU *cpu, int store_index) {
+  const ROB_Entry *store = &cpu->reorder_buffer.buffer[store_index];
+  const Bitset_Word *pending = cpu->reorder_buffer.memory_pending;
+  int address = rob_entry_address(cpu, store);
+
+  for (int entry_index = rob_next_member(cpu, pending, rob_position(cpu, store_index) + 1); entry_index != -1;
+       entry_index = rob_next_member(cpu, pending, rob_position(cpu, entry_index) + 1)) {
     ROB_Entry *entry = &cpu->reorder_buffer.buffer[entry_index];
 
-    while (entry != &cpu->reorder_buffer.buffer[cpu->reorder_buffer.tail]) {
-      switch (entry->opcode) {
-        case OPCODE_LOAD: {
-          if (cpu->status[entry->rs1] == 1) {
-            entry->mready = 1;
-          }
-          break;
-        }
+    if (entry->held && entry->store_set == store->store_set && rob_entry_address(cpu, entry) == address) {
+      entry->dependence_seen = 1;
+    }
+  }
+}
 
-        case OPCODE_LDR:
-        case OPCODE_STORE: {
-          if (cpu->status[entry->rs1] == 1 && cpu->status[entry->rs2] == 1) {
-            entry->mready = 1;
-          }
-          break;
-        }
+/**
+ * Method to find the memory instruction that goes to M1 next. A store waits until it is the oldest
+ * instruction in the ROB, so that data memory is only written by instructions that will retire.
+ * Without load speculation a load waits for every older memory instruction; otherwise the oldest ready
+ * load goes ahead of older stores that have not been sent yet, unless one of them is in its store set.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param issuing - the entry is sent to M1, count it and mark the loads held by their store set
+ * @return index of the ROB entry, -1 if no memory instruction can go in this cycle
+ */
+int next_memory_entry(APEX_CPU *cpu, bool issuing) {
+  const Bitset_Word *pending = cpu->reorder_buffer.memory_pending;
+  unsigned int pending_sets = 0;
+  bool store_pending = false;
 
-        case OPCODE_STR: {
-          if (cpu->status[entry->rs1] == 1 && cpu->status[entry->rs2] == 1
-              && cpu->status[entry->rs3] == 1) {
-            entry->mready = 1;
-          }
-          break;
-        }
+  for (int entry_index = rob_next_member(cpu, pending, 0); entry_index != -1;
+       entry_index = rob_next_member(cpu, pending, rob_position(cpu, entry_index) + 1)) {
+    ROB_Entry *entry = &cpu->reorder_buffer.buffer[entry_index];
+    bool ready = rob_entry_ready(cpu, entry);
+
+    if (issuing) entry->mready = ready;
+
+    if (is_store_instruction(entry->opcode)) {
+      if (ready && entry_index == cpu->reorder_buffer.head) {
+        if (issuing && entry->store_set != -1) release_held_loads(cpu, entry_index);
+        return entry_index;
+      }
+      if (cpu->load_speculation == LOAD_SPECULATION_NONE) return -1;
+
+      store_pending = true;
+      if (entry->store_set != -1) pending_sets |= 1U << entry->store_set;
+      continue;
+    }
+
+    if (ready && (entry->store_set == -1 || !(pending_sets & (1U << entry->store_set)))) {
+      if (issuing && store_pending) cpu->loads_speculated++;
+      if (issuing && entry->held && !entry->dependence_seen) cpu->false_dependences++;
+      return entry_index;
+    }
+    if (ready && issuing) entry->held = 1;
+    if (cpu->load_speculation == LOAD_SPECULATION_NONE) return -1;
+  }
+  return -1;
+}
+
+/*
+ * Puts a load and a store that conflicted into one store set: a new set if neither has one, the set of
+ * the other if only one has, the smaller id if both have
+ */
+static void
+train_store_sets(APEX_CPU *cpu, int load_pc, int store_pc) {
+  int *load_set = &cpu->store_set_table[store_set_index(load_pc)];
+  int *store_set = &cpu->store_set_table[store_set_index(store_pc)];
+
+  if (*load_set == -1 && *store_set == -1) {
+    *load_set = *store_set = cpu->next_store_set;
+    cpu->next_store_set = (cpu->next_store_set + 1) % STORE_SET_COUNT;
+  } else if (*load_set == -1) {
+    *load_set = *store_set;
+  } else if (*store_set == -1 || *load_set < *store_set) {
+    *store_set = *load_set;
+  } else {
+    *load_set = *store_set;
+  }
+}
+
+/**
+ * Method to check the younger loads once a store has written data memory. A load that has already read
+ * the same address got a stale value: the load and the store are put into one store set and everything
+ * after the store is squashed.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param store - M2, holding the store at the ROB head
+ */
+void check_load_order(APEX_CPU *cpu, CPU_Stage *store) {
+  const Bitset_Word *loads = cpu->reorder_buffer.loads;
+
+  for (int entry_index = rob_next_member(cpu, loads, rob_position(cpu, store->rob_index) + 1); entry_index != -1;
+       entry_index = rob_next_member(cpu, loads, rob_position(cpu, entry_index) + 1)) {
+    ROB_Entry *entry = &cpu->reorder_buffer.buffer[entry_index];
+
+    if (entry->status && entry->memory_address == store->memory_address) {
+      if (cpu->load_speculation == LOAD_SPECULATION_STORE_SETS) {
+        train_store_sets(cpu, entry->pc_value, store->pc);
       }
-      entry_index++;
-      entry = &cpu->reorder_buffer.buffer[entry_index];
+      cpu->memory_violations++;
+      squash_after_head(cpu);
+      return;
+    }
+  }
+}
+
+bool is_branch_instruction(int opcode) {
+  return opcode == OPCODE_BZ || opcode == OPCODE_BNZ || opcode == OPCODE_JUMP || opcode == OPCODE_JAL;
+}
+
+int find_free_branch_tag(APEX_CPU *cpu) {
+  for (int i = 0; i < MAX_BRANCHES; i++) {
+    if (!(cpu->branch_mask & (1 << i))) return i;
+  }
+  return -1;
+}
+
+/**
+ * Method to save the rename table of the branch in decode, after its own destination has been renamed
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param rob_index - ROB entry of the branch
+ */
+void take_checkpoint(APEX_CPU *cpu, int rob_index) {
+  RAT_Checkpoint *checkpoint = &cpu->checkpoints[cpu->decode.branch_tag];
+
+  memcpy(checkpoint->rat, cpu->rat, sizeof(int) * RENAME_TABLE_SIZE);
+  checkpoint->flag_rat = cpu->flag_rat;
+  checkpoint->rob_index = rob_index;
+  checkpoint->branch_mask = cpu->decode.branch_mask;
+  cpu->branch_mask |= 1 << cpu->decode.branch_tag;
+}
+
+/*
+ * Drops a function unit latch holding an instruction younger than a mispredicted branch
+ */
+static void squash_stage(CPU_Stage *stage, int bit) {
+  if (stage->branch_mask & bit) {
+    get_nop_stage(stage);
+  }
+}
+
+/**
+ * Method to discard every instruction renamed after a mispredicted branch.
+ * Younger instructions are exactly those whose branch mask holds the tag of the branch, so the issue
+ * queue and function units are cleared with one test per entry. The ROB is cut back to the branch,
+ * the physical registers of the discarded entries are freed and the rename table is restored from
+ * the checkpoint of the branch.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param branch_tag - tag of the mispredicted branch
+ */
+void squash_younger(APEX_CPU *cpu, int branch_tag) {
+  RAT_Checkpoint *checkpoint = &cpu->checkpoints[branch_tag];
+  int bit = 1 << branch_tag;
+
+  release_iq_entries(cpu, cpu->iq_branch[branch_tag]);
+
+  if (cpu->mulu.branch_mask & bit) {
+    cpu->mulu_count = 0;
+  }
+  squash_stage(&cpu->intu, bit);
+  squash_stage(&cpu->mulu, bit);
+  squash_stage(&cpu->m1, bit);
+  squash_stage(&cpu->m2, bit);
+  squash_stage(&cpu->jbu1, bit);
+  squash_stage(&cpu->jbu2, bit);
+
+  while (cpu->reorder_buffer.tail != (checkpoint->rob_index + 1) % ROB_SIZE) {
+    cpu->reorder_buffer.tail = (cpu->reorder_buffer.tail + ROB_SIZE - 1) % ROB_SIZE;
+    cpu->reorder_buffer.count--;
+
+    ROB_Entry *entry = &cpu->reorder_buffer.buffer[cpu->reorder_buffer.tail];
+    release_rob_entry(cpu, cpu->reorder_buffer.tail);
+    if (entry->rd_phy != -1) {
+      cpu->allocation_list[entry->rd_phy] = 0;
+    }
+    if (entry->fused_rd_phy != -1) {
+      cpu->allocation_list[entry->fused_rd_phy] = 0;
+    }
+    if (entry->flag_rd != -1) {
+      cpu->flag_allocation[entry->flag_rd] = 0;
+    }
+    cpu->insn_squashed += entry->fused ? 2 : 1;
+  }
+  cpu->rob_full = false;
+
+  memcpy(cpu->rat, checkpoint->rat, sizeof(int) * RENAME_TABLE_SIZE);
+  cpu->flag_rat = checkpoint->flag_rat;
+
+  /* Branches that were themselves squashed give their tags back */
+  for (int i = 0; i < MAX_BRANCHES; i++) {
+    if ((cpu->branch_mask & (1 << i)) && (cpu->checkpoints[i].branch_mask & bit)) {
+      cpu->branch_mask &= ~(1 << i);
     }
+  }
+  cpu->branch_mispredictions++;
+}
+
+/**
+ * Method to discard every instruction after the ROB head, which has no destination left to write.
+ * Everything older has retired, so the rename table is the retirement one and no branch is left
+ * unresolved. Fetch restarts right after the head.
+ *
+ * @param cpu pointer to current instance of cpu
+ */
+void squash_after_head(APEX_CPU *cpu) {
+  release_all_iq_entries(cpu);
+
+  cpu->mulu_count = 0;
+  get_nop_stage(&cpu->intu);
+  get_nop_stage(&cpu->mulu);
+  get_nop_stage(&cpu->m1);
+  get_nop_stage(&cpu->jbu1);
+  get_nop_stage(&cpu->jbu2);
+
+  while (cpu->reorder_buffer.count > 1) {
+    cpu->reorder_buffer.tail = (cpu->reorder_buffer.tail + ROB_SIZE - 1) % ROB_SIZE;
+    cpu->reorder_buffer.count--;
 
-    if (cpu->reorder_buffer.buffer[cpu->reorder_buffer.head].mready == 1) {
-      cpu->m1 = pick_entry(cpu, "mem");
+    ROB_Entry *entry = &cpu->reorder_buffer.buffer[cpu->reorder_buffer.tail];
+    release_rob_entry(cpu, cpu->reorder_buffer.tail);
+    if (entry->rd_phy != -1) {
+      cpu->allocation_list[entry->rd_phy] = 0;
     }
+    if (entry->fused_rd_phy != -1) {
+      cpu->allocation_list[entry->fused_rd_phy] = 0;
+    }
+    if (entry->flag_rd != -1) {
+      cpu->flag_allocation[entry->flag_rd] = 0;
+    }
+    cpu->insn_squashed += entry->fused ? 2 : 1;
+  }
+  cpu->rob_full = false;
+
+  memcpy(cpu->rat, cpu->r_rat, sizeof(int) * RENAME_TABLE_SIZE);
+  cpu->flag_rat = cpu->flag_r_rat;
+  cpu->branch_mask = 0;
+
+  cpu->pc = cpu->reorder_buffer.buffer[cpu->reorder_buffer.head].pc_value + 4;
+  cpu->fetch_from_next_cycle = TRUE;
+  cpu->decode.has_insn = FALSE;
+  cpu->fetch.has_insn = TRUE;
+}
+
+/**
+ * Method to free the tag of a resolved branch, instructions no longer depend on it
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param branch_tag - tag of the resolved branch
+ */
+void release_branch_tag(APEX_CPU *cpu, int branch_tag) {
+  int bit = 1 << branch_tag;
+
+  memset(cpu->iq_branch[branch_tag], 0, sizeof(cpu->iq_branch[branch_tag]));
+  memset(cpu->reorder_buffer.branch[branch_tag], 0, sizeof(cpu->reorder_buffer.branch[branch_tag]));
+  for (int i = 0; i < MAX_BRANCHES; i++) {
+    cpu->checkpoints[i].branch_mask &= ~bit;
+  }
+
+  cpu->intu.branch_mask &= ~bit;
+  cpu->mulu.branch_mask &= ~bit;
+  cpu->m1.branch_mask &= ~bit;
+  cpu->m2.branch_mask &= ~bit;
+  cpu->jbu1.branch_mask &= ~bit;
+  cpu->jbu2.branch_mask &= ~bit;
+  cpu->branch_mask &= ~bit;
+}
+
+/**
+ * Method to check if all source operands of a memory instruction in ROB are available
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param entry - ROB entry to be checked
+ * @return true if the entry can be sent to M1
+ */
+bool rob_entry_ready(APEX_CPU *cpu, ROB_Entry *entry) {
+  return sources_ready(cpu, entry->operands, entry->rs1, entry->rs2, entry->rs3);
+}
+
+/*
+ * Checks, without side effects, that decode will stall in the current cycle on a resource only the
+ * back end can free: a physical register, branch tag or flag, a ROB entry or an IQ entry
+ */
+static bool
+decode_waits(APEX_CPU *cpu) {
+  CPU_Stage stage = cpu->decode;
+
+  /* Decode first tries to resolve the instruction at rename, it then needs a ROB entry only */
+  if (cpu->eliminate && stage.eliminated == ELIMINATED_NONE && (stage.operands & OPERAND_RD)
+      && eliminate_at_rename(cpu, &stage) != ELIMINATED_NONE) {
+    stage.function_unit = FU_NONE;
+  }
+
+  if (rename_blocked(cpu, &stage) || cpu->reorder_buffer.count == ROB_SIZE) {
+    return true;
+  }
+  return stage.function_unit != FU_MEM && stage.function_unit != FU_NONE && issue_queue_full(cpu);
+}
+
+/*
+ * Cycles fetch, with decode empty, still waits for the L1I line of its instruction, 0 if it moves on
+ * in the current cycle or has yet to access the line
+ */
+static int
+fetch_wait(APEX_CPU *cpu) {
+  int index = get_code_memory_index_from_pc(cpu->pc);
+
+  if (cpu->caches == CACHES_NONE || cpu->pc < 4000 || index >= cpu->code_memory_size
+      || cache_line_address(index) != cpu->fetch_line || cpu->fetch_ready <= cpu->clock) {
+    return 0;
+  }
+  return cpu->fetch_ready - cpu->clock;
+}
+
+/**
+ * Method to find how many cycles, starting with the current one, no function unit can make progress.
+ * During such cycles the only state that changes is the clock and the countdown of an in-flight multiply,
+ * a data access M2 is waiting for and an L1I miss fetch is waiting for complete at a cycle fixed when
+ * they started. The front end is idle once it has stopped after HALT, while decode stalls on a full
+ * IQ, ROB or free list, and while fetch waits for a miss.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @return 0 if the current cycle has work to do, INT_MAX if the pipeline has drained,
+ *         otherwise the number of idle cycles before the next scheduled completion
+ */
+int cycles_until_next_event(APEX_CPU *cpu) {
+  int idle = INT_MAX;
+  bool front_end_waits = false;
+
+  if (cpu->decode.has_insn) {
+    if (!decode_waits(cpu)) return 0;
+    front_end_waits = true;
+  } else if (cpu->fetch.has_insn) {
+    idle = fetch_wait(cpu);
+    if (idle == 0) return 0;
   }
+
+  /* Nothing in flight between M1/M2 and JBU1/JBU2, except for a data access M2 is waiting for */
+  if (cpu->jbu2.opcode != OPCODE_NOP) return 0;
+  if (cpu->m2.opcode != OPCODE_NOP) {
+    if (!is_memory_instruction(cpu->m2.opcode) || cpu->m2.ready_cycle <= cpu->clock) return 0;
+    if (cpu->m2.ready_cycle - cpu->clock < idle) idle = cpu->m2.ready_cycle - cpu->clock;
+  }
+
+  /* Nothing that INTU, MULU or JBU could pick from the issue queue */
+  if (bitset_intersects(cpu->iq_valid, cpu->iq_ready, IQ_WORDS)) return 0;
+
+  /* Nothing to retire and no memory instruction that could be sent to M1 */
+  if (!rob_empty(cpu)) {
+    if (cpu->reorder_buffer.buffer[cpu->reorder_buffer.head].status) return 0;
+    if (!is_memory_instruction(cpu->m1.opcode) && next_memory_entry(cpu, false) != -1) return 0;
+  }
+
+  /* MULU writes back when mulu_count reaches 2 */
+  if (cpu->mulu_count != 0 && 2 - cpu->mulu_count < idle) idle = 2 - cpu->mulu_count;
+
+  /* A stalled decode with nothing scheduled to unblock it is left to the cycle by cycle loop */
+  if (front_end_waits && idle == INT_MAX) return 0;
+  return idle;
 }
 
+/**
+ * Method to advance the cpu over idle cycles without ticking the stages.
+ * Must only be called right after an idle cycle has been simulated, so that every latch already
+ * holds the value it would hold at the end of each skipped cycle.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param cycles - number of idle cycles to skip
+ */
+void skip_idle_cycles(APEX_CPU *cpu, int cycles) {
+  if (cycles <= 0) return;
 
+  if (cpu->debug_messages) {
+    printf("\n--------------------------------------------\n");
+    printf("Clock Cycle #: %d - %d (idle, skipped)\n", cpu->clock + 1, cpu->clock + cycles);
+    printf("--------------------------------------------\n");
+  }
+
+  cpu->clock += cycles;
+  if (cpu->mulu_count != 0) cpu->mulu_count += cycles;
+  cpu->cycles_skipped += cycles;
+}
 
 /* Debug function which prints the register file
  *
@@ -2,11 +2,15 @@
 #define _APEX_CPU_H_
 
 #include "apex_macros.h"
+#include "apex_uop.h"
+#include "apex_bitset.h"
+#include "apex_arena.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
 
 /* Format of an APEX instruction  */
@@ -23,8 +27,10 @@ typedef struct APEX_Instruction {
 /* Model of CPU stage latch */
 typedef struct CPU_Stage {
   int pc;
-  char opcode_str[128];
+  const char *opcode_str;
   int opcode;
+  int operands;                                 /* OPERAND_* bits of the opcode */
+  int function_unit;                            /* FU_* the instruction is dispatched to */
   int rs1;
   int rs2;
   int rs3;
@@ -34,15 +40,30 @@ typedef struct CPU_Stage {
   int rs1_value;
   int rs2_value;
   int rs3_value;
+  int ready;                                    /* OPERAND_RS* bits of the sources available at rename */
+  int eliminated;                               /* ELIMINATED_* kind, result_buffer holds the result */
+  int fused;                                    /* FUSE_* rule that merged the next instruction into this one */
+  int fused_opcode;                             /* BZ/BNZ after a compare, ADDL before a LOAD */
+  int fused_imm;                                /* Offset of the branch, literal of the ADDL */
+  int fused_rd;                                 /* Destination of the ADDL, physical once renamed */
+  int fused_rd_arch;
+  int flag_rs;                                  /* Physical flag read by BZ/BNZ, -1 for none */
+  int flag_rd;                                  /* Physical flag set by SUB/SUBL/CMP, -1 for none */
   int result_buffer;
   int memory_address;
+  int ready_cycle;                              /* Cycle the data access of M2 completes, 0 until it starts */
   int has_insn;
+  int rob_index;                                /* ROB entry of the instruction, -1 for a bubble */
+  int branch_mask;                              /* Tags of the unresolved branches older than the instruction */
+  int branch_tag;                               /* Checkpoint of a branch, -1 for other instructions */
 } CPU_Stage;
 
 typedef struct IQ_Entry {
   int pc;
-  char opcode_str[128];
+  const char *opcode_str;
   int opcode;
+  int operands;
+  int function_unit;
   int rs1;
   int rs2;
   int rs3;
@@ -53,15 +74,30 @@ typedef struct IQ_Entry {
   int rs2_value;
   int rs3_value;
   int cycle_number;
-  bool valid;
+  int branch_tag;
+  int ready;                                    /* OPERAND_RS* bits of the sources available */
+  int waiting;                                  /* Sources not available yet, the entry can issue at 0 */
+  int fused;                                    /* FUSE_COMPARE_BRANCH for a compare carrying its branch */
+  int fused_opcode;
+  int fused_imm;
+  int flag_rs;
+  int flag_rd;
 } IQ_Entry;
 
+/* Words of a set of IQ entries, bit i stands for issue_queue[i] */
+#define IQ_WORDS BITSET_WORDS(IQ_SIZE)
+
+#if ROB_SIZE > 256
+#error "iq_rob_index holds ROB indices below 256"
+#endif
+
 /* Format of ROB entry */
 typedef struct ROB_Entry {
-  bool status;
-  char instruction_type[50];
-  char opcode_str[128];
+  bool status;                                  /* Result is available, entry can be retired */
+  const char *instruction_type;
+  const char *opcode_str;
   int opcode;
+  int operands;
   int pc_value;
   int rd_phy;
   int rd_arch;
@@ -69,40 +105,139 @@ typedef struct ROB_Entry {
   int rs2;
   int rs3;
   int imm;
-  int mready;
+  int mready;                                   /* Source operands of a memory instruction are available */
+  int store_set;                                /* Store set predicted at dispatch, -1 for none */
+  int memory_address;                           /* Address a load has read, once it has left M2 */
+  int held;                                     /* Ready load kept from M1 by a store of its set */
+  int dependence_seen;                          /* A store it was held for wrote the same address */
+  int fused;                                    /* FUSE_* rule, the entry retires two instructions */
+  int fused_opcode;
+  int fused_imm;
+  int fused_rd_phy;                             /* Destination of the ADDL of a fused load, -1 for none */
+  int fused_rd_arch;
+  int flag_rd;                                  /* Physical flag set by the instruction, -1 for none */
 } ROB_Entry;
 
+#define ROB_WORDS BITSET_WORDS(ROB_SIZE)
+
+/*
+ * Reorder buffer, a circular queue of entries. The state that is scanned every cycle is kept apart from
+ * the entries as one bit per entry, scans walk these sets and only read the entries they select.
+ */
 typedef struct ROB_Queue {
   int head, tail;
-  ROB_Entry buffer[ROB_SIZE];
+  int count;
+  _Alignas(HOST_CACHE_LINE) Bitset_Word memory_pending[ROB_WORDS]; /* Memory instructions not sent to M1 */
+  Bitset_Word loads[ROB_WORDS];                 /* LOAD and LDR entries */
+  Bitset_Word branch[MAX_BRANCHES][ROB_WORDS];  /* Entries younger than each unresolved branch, by tag */
+  _Alignas(HOST_CACHE_LINE) ROB_Entry buffer[ROB_SIZE];
 } ROB_Queue;
 
+/* Rename table as it was right after a branch was renamed */
+typedef struct RAT_Checkpoint {
+  int rat[RENAME_TABLE_SIZE];
+  int flag_rat;                                 /* Physical flag the branch and younger instructions read */
+  int rob_index;                                /* ROB entry of the branch */
+  int branch_mask;                              /* Tags of the branches older than this one */
+} RAT_Checkpoint;
+
+/* Predicates ending APEX_cpu_run() early, each is checked by the stage that can make it true */
+typedef struct Stop_Condition {
+  int armed;                                    /* STOP_* bits, nothing is checked while 0 */
+  int hit;                                      /* STOP_* bits that fired during the last run */
+  int pc;
+  int instret;
+  int cycle;
+  int address;
+  int reg;                                      /* Architectural register and value of STOP_ON_REGISTER */
+  int value;
+} Stop_Condition;
+
+struct APEX_System;
+struct APEX_Memory;
+struct APEX_Cache;
+struct APEX_Prefetcher;
+struct APEX_Hierarchy;
+
 /* Model of APEX CPU */
 typedef struct APEX_CPU {
+  APEX_Arena *arena;                            /* Holds the cpu and everything it allocates */
+  int run_allocations;                          /* Arena blocks taken from the heap inside APEX_cpu_run() */
   int pc;                                       /* Current program counter */
   int clock;                                    /* Clock cycles elapsed */
   int insn_completed;                           /* Instructions retired */
+  int commit_width;                             /* Max instructions retired per cycle */
+  int issue_policy;                             /* {ISSUE_OLDEST_FIRST, ISSUE_RANDOM, ISSUE_CRITICAL_PATH} */
+  int load_speculation;                         /* {LOAD_SPECULATION_NONE, _STORE_SETS, _ALWAYS} */
+  int eliminate;                                /* Resolve constants, zero idioms and moves at rename */
+  int ops_eliminated[ELIMINATED_MOVE + 1];      /* Instructions resolved at rename, by ELIMINATED_* kind */
+  int fusion;                                   /* FUSE_* rules applied by fetch */
+  int compare_branches_fused;                   /* Compares dispatched together with their BZ/BNZ */
+  int address_loads_fused;                      /* ADDLs dispatched together with their LOAD */
+  int store_set_table[STORE_SET_TABLE_SIZE];    /* Store set of the load or store at a pc, -1 for none */
+  int next_store_set;                           /* Store set id handed out next */
+  unsigned int issue_seed;                      /* State of the generator used by ISSUE_RANDOM */
+  int halted;                                   /* HALT has been retired */
   int regs[REG_FILE_SIZE];                      /* Unified Integer register file */
   int status[REG_FILE_SIZE];                    /* status bits for each register in register file */
-  int forwarded[REG_FILE_SIZE];                 /* status bits to indicate if result has been forwarded */
+  int constant[REG_FILE_SIZE];                  /* Value was produced at rename by MOVC or a folded op */
   int rat[RENAME_TABLE_SIZE];
   int r_rat[RENAME_TABLE_SIZE];
   int rat_status[RENAME_TABLE_SIZE];
   int r_rat_status[RENAME_TABLE_SIZE];
+  int flags[FLAG_FILE_SIZE];                    /* Renamed zero flag, {TRUE, FALSE} */
+  int flag_status[FLAG_FILE_SIZE];              /* Flag has been set */
+  int flag_allocation[FLAG_FILE_SIZE];
+  Bitset_Word flag_consumers[FLAG_FILE_SIZE][IQ_WORDS]; /* BZ/BNZ entries waiting for each physical flag */
+  int flag_rat;                                 /* Physical flag of the youngest flag producer renamed */
+  int flag_r_rat;                               /* Physical flag of the youngest flag producer retired */
   int allocation_list[REG_FILE_SIZE];
-  int iq_entry_used[IQ_SIZE];                   /* status bits to indicate empty issue queue entries */
-  IQ_Entry issue_queue[IQ_SIZE];                /* issue queue */
+  _Alignas(HOST_CACHE_LINE) Bitset_Word iq_valid[IQ_WORDS]; /* Issue queue entries in use */
+  Bitset_Word iq_ready[IQ_WORDS];               /* Entries with every source available */
+  Bitset_Word iq_unit[FU_JBU + 1][IQ_WORDS];    /* Entries of each function unit */
+  Bitset_Word iq_branch[MAX_BRANCHES][IQ_WORDS]; /* Entries younger than each unresolved branch, by tag */
+  unsigned char iq_rob_index[IQ_SIZE];          /* ROB entry of each entry, gives its age */
+  _Alignas(HOST_CACHE_LINE) IQ_Entry issue_queue[IQ_SIZE]; /* Payload, read when an entry issues or wakes */
+  Bitset_Word consumers[REG_FILE_SIZE][IQ_WORDS]; /* IQ entries waiting for each physical register */
   ROB_Queue reorder_buffer;                     /* reorder buffer */
-  APEX_Instruction *code_memory;                /* Code Memory */
+  RAT_Checkpoint checkpoints[MAX_BRANCHES];     /* indexed by branch tag */
+  int branch_mask;                              /* Tags of all unresolved branches */
+  int branch_mispredictions;                    /* Branches that redirected fetch */
+  int insn_squashed;                            /* Instructions discarded by mispredictions */
+  int loads_speculated;                         /* Loads sent to M1 ahead of an older store */
+  int memory_violations;                        /* Loads that read an address before an older store wrote it */
+  int false_dependences;                        /* Loads held for stores of their set that wrote elsewhere */
+  const APEX_Instruction *code_memory;          /* Code Memory, read only and possibly shared between cpus */
   int code_memory_size;                         /* Number of instruction in the input file */
-  int data_memory[DATA_MEMORY_SIZE];            /* Data Memory */
+  APEX_Uop *uops;                               /* Code memory decoded into micro-ops, read by fetch */
+  struct Func_Insn *threaded_code;              /* Code memory of the functional model, built on first use */
+  long insn_fast_forwarded;                     /* Instructions executed by the functional model */
+  int use_jit;                                  /* Fast forward through translated code */
+  Stop_Condition stop;                          /* Run-until predicates, APEX_cpu_run() returns once one hits */
+  struct APEX_Replay *replay;                   /* Log being recorded or replayed, NULL for none */
+  struct APEX_Snapshots *snapshots;             /* Time travel history, NULL while snapshots are off */
+  struct APEX_Jit *jit;                         /* Translated code, created on first use */
+  int owns_code_memory;                         /* Free code memory in APEX_cpu_stop() */
+  struct APEX_Memory *data_memory;              /* Data Memory, private or shared with the other cores */
+  struct APEX_System *system;                   /* System this core belongs to, NULL for a single cpu */
+  int core_id;                                  /* Index of this core in its system */
+  int caches;                                   /* {CACHES_NONE, CACHES_L2, CACHES_L3} */
+  struct APEX_Hierarchy *hierarchy;             /* Caches and DRAM timing fetch and M2, data side unused in a system */
+  int fetch_line;                               /* Line of code memory fetch has last accessed */
+  int fetch_ready;                              /* Cycle that line arrives in L1I */
+  struct APEX_Cache *l1d;                       /* L1D of the hierarchy, or the coherent L1 of the system */
+  struct APEX_Cache *l1i;                       /* L1I of the hierarchy */
+  struct APEX_Prefetcher *data_prefetcher;      /* Trained by M2, NULL for none */
+  struct APEX_Prefetcher *inst_prefetcher;      /* Next-N-line over code memory, trained by fetch */
+  int prefetch_degree;                          /* Lines requested per trigger by the data prefetcher */
   int single_step;                              /* Wait for user input after every cycle */
-  int zero_flag;                                /* {TRUE, FALSE} Used by BZ and BNZ to branch */
   int fetch_from_next_cycle;                    /* flag to enable disable debug messages */
   int debug_messages;
   bool rob_full;
   bool iq_full;
   int mulu_count;
+  int event_driven;                             /* Skip cycles in which no unit can make progress */
+  int cycles_skipped;                           /* Idle cycles advanced in bulk by the event-driven mode */
 
   /* Pipeline stages */
   CPU_Stage fetch;
@@ -119,8 +254,14 @@ typedef struct APEX_CPU {
 } APEX_CPU;
 
 APEX_Instruction *create_code_memory(const char *filename, int *size);
+APEX_Instruction *create_code_memory_from_stream(FILE *fp, int *size);
+APEX_Uop *create_uop_cache(APEX_Arena *arena, const APEX_Instruction *code_memory, int code_memory_size);
+int read_data_memory(APEX_CPU *cpu, int address);
+void write_data_memory(APEX_CPU *cpu, int address, int value);
 APEX_CPU *APEX_cpu_init(const char *filename);
+APEX_CPU *APEX_cpu_init_from_image(const APEX_Instruction *code_memory, int code_memory_size);
 void APEX_cpu_run(APEX_CPU *cpu, int count, bool print_contents);
+bool APEX_cpu_run_to_halt(APEX_CPU *cpu, int max_cycles);
 void APEX_cpu_stop(APEX_CPU *cpu);
 void print_arf(APEX_CPU *cpu);
 void print_mem(APEX_CPU *cpu);
@@ -128,8 +269,8 @@ void display(APEX_CPU *cpu);
 void print_stage_contents(CPU_Stage *stage, char *name);
 void show_mem(APEX_CPU *cpu, int address);
 CPU_Stage get_nop_stage(CPU_Stage *nop);
-void forward_data_to_decode(APEX_CPU *cpu, CPU_Stage *stage);
 void forward_data_to_iq(APEX_CPU *cpu, CPU_Stage *stage);
+void forward_flag_to_iq(APEX_CPU *cpu, int flag);
 void APEX_INTU(APEX_CPU *cpu);
 void APEX_MULU(APEX_CPU *cpu);
 void APEX_M1(APEX_CPU *cpu);
@@ -138,20 +279,37 @@ void APEX_JBU1(APEX_CPU *cpu);
 void APEX_JBU2(APEX_CPU *cpu);
 
 void APEX_issue(APEX_CPU *cpu);
+bool dispatch_possible(APEX_CPU *cpu);
 void APEX_dispatch(APEX_CPU *cpu);
 ROB_Queue get_reorder_buffer();
 bool queue_insert(APEX_CPU *cpu, ROB_Entry rob_entry);
-void insert_rob_entry(APEX_CPU *cpu, int is_ready);
+int insert_rob_entry(APEX_CPU *cpu);
+void release_rob_entry(APEX_CPU *cpu, int rob_index);
 bool increment_rob_head(APEX_CPU *cpu);
 bool increment_rob_tail(APEX_CPU *cpu);
-void insert_iq_entry(APEX_CPU *cpu);
-void validate_iq_entry(APEX_CPU *cpu, IQ_Entry *entry);
-void validate_rob_entries(APEX_CPU *cpu);
-CPU_Stage pick_entry(APEX_CPU *cpu, char *function_unit);
+void insert_iq_entry(APEX_CPU *cpu, int rob_index);
+CPU_Stage pick_entry(APEX_CPU *cpu, int function_unit);
 CPU_Stage remove_iq_entry(APEX_CPU *cpu, int entry_index);
-CPU_Stage remove_rob_entry(APEX_CPU *cpu);
+CPU_Stage issue_rob_entry(APEX_CPU *cpu, int entry_index);
+void complete_rob_entry(APEX_CPU *cpu, CPU_Stage *stage);
+int next_memory_entry(APEX_CPU *cpu, bool issuing);
+void check_load_order(APEX_CPU *cpu, CPU_Stage *store);
+bool is_branch_instruction(int opcode);
+int find_free_branch_tag(APEX_CPU *cpu);
+void take_checkpoint(APEX_CPU *cpu, int rob_index);
+void squash_younger(APEX_CPU *cpu, int branch_tag);
+void squash_after_head(APEX_CPU *cpu);
+void release_branch_tag(APEX_CPU *cpu, int branch_tag);
 bool rob_empty(APEX_CPU *cpu);
 bool issue_queue_empty(APEX_CPU *cpu);
+bool issue_queue_full(APEX_CPU *cpu);
+bool rob_entry_ready(APEX_CPU *cpu, ROB_Entry *entry);
+bool is_memory_instruction(int opcode);
+bool has_destination(int opcode);
+bool APEX_cpu_set(APEX_CPU *cpu, const char *name, int value);
+bool APEX_cpu_apply_settings(APEX_CPU *cpu, int num_settings, const char **settings);
+int cycles_until_next_event(APEX_CPU *cpu);
+void skip_idle_cycles(APEX_CPU *cpu, int cycles);
 
 void print_issue_queue(APEX_CPU *cpu);
 void print_reorder_buffer(APEX_CPU *cpu);
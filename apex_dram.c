@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <string.h>
+#include "apex_dram.h"
+
+/**
+ * Method to reset the DRAM, all banks start precharged and the queue empty
+ *
+ * @param dram pointer to the DRAM
+ * @param banks - number of banks, at most DRAM_MAX_BANKS
+ * @param queue_depth - requests the controller holds at once, at most DRAM_MAX_QUEUE
+ */
+void dram_init(APEX_DRAM *dram, int banks, int queue_depth) {
+  memset(dram, 0, sizeof(APEX_DRAM));
+  dram->banks = banks;
+  dram->queue_depth = queue_depth;
+  for (int i = 0; i < DRAM_MAX_BANKS; i++) {
+    dram->bank[i].open_row = -1;
+  }
+}
+
+/**
+ * Method to time the transfer of a line between the DRAM and the last cache level
+ *
+ * @param dram pointer to the DRAM
+ * @param line_address - line being read or written
+ * @param is_write - writeback of a dirty line
+ * @param clock - cycle the request reaches the controller
+ * @return cycles until the last word of the line has been transferred
+ */
+int dram_access(APEX_DRAM *dram, int line_address, bool is_write, int clock) {
+  DRAM_Bank *bank = &dram->bank[line_address % dram->banks];
+  int row = line_address / (dram->banks * DRAM_ROW_LINES);
+  int slot = 0;
+  int start, done, latency;
+
+  /* A full queue makes the request wait for the earliest completion */
+  for (int i = 1; i < dram->queue_depth; i++) {
+    if (dram->queue[i] < dram->queue[slot]) slot = i;
+  }
+  start = (dram->queue[slot] > clock) ? dram->queue[slot] : clock;
+  dram->queue_cycles += start - clock;
+  if (bank->ready > start) start = bank->ready;
+
+  if (bank->open_row == row) {
+    dram->row_hits++;
+    start += DRAM_T_CAS;
+  } else if (bank->open_row == -1) {
+    dram->row_misses++;
+    start += DRAM_T_RCD + DRAM_T_CAS;
+  } else {
+    dram->row_conflicts++;
+    start += DRAM_T_RP + DRAM_T_RCD + DRAM_T_CAS;
+  }
+  bank->open_row = row;
+
+  if (dram->bus_ready > start) start = dram->bus_ready;
+  done = start + DRAM_T_BURST;
+  dram->bus_ready = done;
+  bank->ready = done;
+  dram->queue[slot] = done;
+
+  latency = done - clock;
+  if (is_write) {
+    dram->writes++;
+  } else {
+    dram->reads++;
+    dram->latency_total += latency;
+    if (latency > dram->latency_max) dram->latency_max = latency;
+  }
+  return latency;
+}
+
+void print_dram_stats(APEX_DRAM *dram, int cycles) {
+  int accesses = dram->reads + dram->writes;
+
+  printf("|   DRAM   reads: %-8d writes: %-8d banks: %-5d|\n", dram->reads, dram->writes, dram->banks);
+  printf("|          rows hit/miss/conflict: %-6d %-6d %-7d|\n", dram->row_hits, dram->row_misses,
+         dram->row_conflicts);
+  printf("|          latency avg: %-6.1f max: %-5d queued: %-6ld|\n",
+         dram->reads ? (double) dram->latency_total / dram->reads : 0.0, dram->latency_max, dram->queue_cycles);
+  printf("|          bandwidth: %-6.2f B/cyc  queue depth: %-7d|\n",
+         cycles ? (double) accesses * CACHE_LINE_SIZE * 4 / cycles : 0.0, dram->queue_depth);
+}
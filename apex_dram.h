@@ -0,0 +1,39 @@
+#ifndef _APEX_DRAM_H_
+#define _APEX_DRAM_H_
+
+#include "apex_macros.h"
+#include <stdbool.h>
+
+/* Bank of the DRAM, rows stay open until a different row of the bank is accessed */
+typedef struct DRAM_Bank {
+  int open_row;                                 /* -1 while precharged */
+  int ready;                                    /* Cycle the bank can take the next command */
+} DRAM_Bank;
+
+/*
+ * Timing model of the DRAM behind the last cache level. Lines are interleaved over the banks, an access
+ * waits for a free slot of the controller queue, for its bank and for the data bus, and then costs a
+ * row buffer hit, an access to a precharged bank or a row conflict.
+ */
+typedef struct APEX_DRAM {
+  int banks;
+  int queue_depth;                              /* Requests the controller holds at once */
+  int queue[DRAM_MAX_QUEUE];                    /* Completion cycle of each request in the queue */
+  DRAM_Bank bank[DRAM_MAX_BANKS];
+  int bus_ready;                                /* Cycle the data bus is free */
+
+  int reads;
+  int writes;                                   /* Writebacks of the last cache level */
+  int row_hits;
+  int row_misses;                               /* Bank was precharged */
+  int row_conflicts;                            /* Another row was open */
+  long queue_cycles;                            /* Cycles requests waited for a queue slot */
+  long latency_total;                           /* Cycles from request to last word of all reads */
+  int latency_max;
+} APEX_DRAM;
+
+void dram_init(APEX_DRAM *dram, int banks, int queue_depth);
+int dram_access(APEX_DRAM *dram, int line_address, bool is_write, int clock);
+void print_dram_stats(APEX_DRAM *dram, int cycles);
+
+#endif
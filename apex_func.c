@@ -0,0 +1,275 @@
+#include "apex_func.h"
+#include "apex_isa.h"
+#include "apex_jit.h"
+#include "apex_replay.h"
+#include "apex_snapshot.h"
+
+/*
+ * Index of the instruction at pc in threaded code, any pc outside of code memory maps to the HALT
+ * appended after the last instruction, like fetch does
+ */
+int
+func_code_index(APEX_CPU *cpu, int pc) {
+  int index = (pc - 4000) / 4;
+
+  return (pc >= 4000 && index < cpu->code_memory_size) ? index : cpu->code_memory_size;
+}
+
+/**
+ * Method to translate the micro-ops of a cpu into threaded code
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param handlers - label executing each opcode
+ * @return one instruction per micro-op followed by a HALT, NULL if it could not be allocated
+ */
+static Func_Insn *
+build_threaded_code(APEX_CPU *cpu, const void *const *handlers) {
+  Func_Insn *code = arena_calloc(cpu->arena, cpu->code_memory_size + 1, sizeof(Func_Insn));
+
+  if (!code) {
+    return NULL;
+  }
+
+  for (int i = 0; i <= cpu->code_memory_size; i++) {
+    const APEX_Uop *uop = (i < cpu->code_memory_size) ? &cpu->uops[i] : &halt_uop;
+
+    code[i].handler = handlers[uop->opcode];
+    code[i].rd = uop->rd;
+    code[i].rs1 = uop->rs1;
+    code[i].rs2 = uop->rs2;
+    code[i].rs3 = uop->rs3;
+    code[i].imm = uop->imm;
+
+    /* Branch targets are known at translation time */
+    if (uop->opcode == OPCODE_BZ || uop->opcode == OPCODE_BNZ) {
+      code[i].imm = func_code_index(cpu, 4000 + 4 * i + uop->imm);
+    }
+  }
+  return code;
+}
+
+/*
+ * This function executes instructions from state->index until the budget runs out or HALT has been
+ * executed.
+ *
+ * Dispatch is direct threaded: each handler jumps to the handler of the next instruction through a
+ * computed goto, there is no central switch.
+ */
+void
+func_interpret(APEX_CPU *cpu, Func_State *state) {
+  static const void *const handlers[NUM_OPCODES] = {
+      [OPCODE_ADD] = &&op_add,
+      [OPCODE_SUB] = &&op_sub,
+      [OPCODE_MUL] = &&op_mul,
+      [OPCODE_DIV] = &&op_nop,
+      [OPCODE_AND] = &&op_and,
+      [OPCODE_OR] = &&op_or,
+      [OPCODE_EXOR] = &&op_exor,
+      [OPCODE_MOVC] = &&op_movc,
+      [OPCODE_LOAD] = &&op_load,
+      [OPCODE_STORE] = &&op_store,
+      [OPCODE_BZ] = &&op_bz,
+      [OPCODE_BNZ] = &&op_bnz,
+      [OPCODE_HALT] = &&op_halt,
+      [OPCODE_ADDL] = &&op_addl,
+      [OPCODE_SUBL] = &&op_subl,
+      [OPCODE_LDR] = &&op_ldr,
+      [OPCODE_STR] = &&op_str,
+      [OPCODE_CMP] = &&op_cmp,
+      [OPCODE_NOP] = &&op_nop,
+      [OPCODE_JUMP] = &&op_jump,
+      [OPCODE_JAL] = &&op_jal,
+  };
+  const Func_Insn *code;
+  const Func_Insn *insn;
+  int *regs = state->regs;
+  int zero_flag = state->zero_flag;
+  long budget = state->budget;
+  int index = state->index;
+  int target;
+
+  if (!cpu->threaded_code) {
+    cpu->threaded_code = build_threaded_code(cpu, handlers);
+    if (!cpu->threaded_code) {
+      fprintf(stderr, "APEX_Error: Unable to allocate threaded code\n");
+      return;
+    }
+  }
+  code = cpu->threaded_code;
+
+#define DISPATCH()                                                                                    \
+  do {                                                                                                \
+    if (budget == 0) goto stop;                                                                       \
+    insn = &code[index];                                                                              \
+    budget--;                                                                                         \
+    goto *insn->handler;                                                                              \
+  } while (0)
+
+  DISPATCH();
+op_add:
+  regs[insn->rd] = alu_result(OPCODE_ADD, regs[insn->rs1], regs[insn->rs2], 0);
+  index++;
+  DISPATCH();
+
+op_sub:
+  regs[insn->rd] = alu_result(OPCODE_SUB, regs[insn->rs1], regs[insn->rs2], 0);
+  zero_flag = (regs[insn->rd] == 0);
+  index++;
+  DISPATCH();
+
+op_mul:
+  regs[insn->rd] = alu_result(OPCODE_MUL, regs[insn->rs1], regs[insn->rs2], 0);
+  index++;
+  DISPATCH();
+
+op_and:
+  regs[insn->rd] = alu_result(OPCODE_AND, regs[insn->rs1], regs[insn->rs2], 0);
+  index++;
+  DISPATCH();
+
+op_or:
+  regs[insn->rd] = alu_result(OPCODE_OR, regs[insn->rs1], regs[insn->rs2], 0);
+  index++;
+  DISPATCH();
+
+op_exor:
+  regs[insn->rd] = alu_result(OPCODE_EXOR, regs[insn->rs1], regs[insn->rs2], 0);
+  index++;
+  DISPATCH();
+
+op_addl:
+  regs[insn->rd] = alu_result(OPCODE_ADDL, regs[insn->rs1], 0, insn->imm);
+  index++;
+  DISPATCH();
+
+op_subl:
+  regs[insn->rd] = alu_result(OPCODE_SUBL, regs[insn->rs1], 0, insn->imm);
+  zero_flag = (regs[insn->rd] == 0);
+  index++;
+  DISPATCH();
+
+op_movc:
+  regs[insn->rd] = alu_result(OPCODE_MOVC, 0, 0, insn->imm);
+  index++;
+  DISPATCH();
+
+op_cmp:
+  zero_flag = (alu_result(OPCODE_CMP, regs[insn->rs1], regs[insn->rs2], 0) == 0);
+  index++;
+  DISPATCH();
+
+op_load:
+  regs[insn->rd] = read_data_memory(cpu, memory_address(OPCODE_LOAD, regs[insn->rs1], 0, 0, insn->imm));
+  index++;
+  DISPATCH();
+
+op_ldr:
+  regs[insn->rd] = read_data_memory(cpu, memory_address(OPCODE_LDR, regs[insn->rs1], regs[insn->rs2], 0, 0));
+  index++;
+  DISPATCH();
+
+op_store:
+  write_data_memory(cpu, memory_address(OPCODE_STORE, regs[insn->rs1], regs[insn->rs2], 0, insn->imm),
+                    regs[insn->rs1]);
+  index++;
+  DISPATCH();
+
+op_str:
+  write_data_memory(cpu, memory_address(OPCODE_STR, regs[insn->rs1], regs[insn->rs2], regs[insn->rs3], 0),
+                    regs[insn->rs1]);
+  index++;
+  DISPATCH();
+
+op_bz:
+  index = branch_taken(OPCODE_BZ, zero_flag) ? insn->imm : index + 1;
+  DISPATCH();
+
+op_bnz:
+  index = branch_taken(OPCODE_BNZ, zero_flag) ? insn->imm : index + 1;
+  DISPATCH();
+
+op_jump:
+  index = func_code_index(cpu, regs[insn->rs1] + insn->imm);
+  DISPATCH();
+
+op_jal:
+  /* Target is computed before the link register is written, rd may be rs1 */
+  target = regs[insn->rs1] + insn->imm;
+  regs[insn->rd] = 4000 + 4 * index + 4;
+  index = func_code_index(cpu, target);
+  DISPATCH();
+
+op_nop:
+  index++;
+  DISPATCH();
+
+op_halt:
+  state->halted = TRUE;
+  index++;
+
+#undef DISPATCH
+
+stop:
+  state->zero_flag = zero_flag;
+  state->budget = budget;
+  state->index = index;
+}
+
+/*
+ * This function executes up to count instructions on a cpu with an empty pipeline, stopping after HALT.
+ * Architectural registers are read from and written back to the physical registers they are mapped
+ * to, data memory is accessed like M2 does it. No cycles elapse. Translated code runs instead of the
+ * interpreter when the jit setting is on.
+ */
+long
+APEX_cpu_fast_forward(APEX_CPU *cpu, long count) {
+  Func_State state;
+
+  if (!rob_empty(cpu) || cpu->decode.has_insn) {
+    fprintf(stderr, "APEX_Error: Fast forward needs an empty pipeline\n");
+    return 0;
+  }
+
+  if (cpu->halted || count <= 0) {
+    return 0;
+  }
+
+  if (cpu->replay) {
+    replay_input(cpu, "ff %ld", count);
+  }
+
+  /* With an empty pipeline the rename table maps every register to its committed value */
+  for (int i = 0; i < RENAME_TABLE_SIZE; i++) {
+    state.regs[i] = cpu->regs[cpu->rat[i]];
+  }
+  state.zero_flag = cpu->flags[cpu->flag_r_rat];
+  state.index = func_code_index(cpu, cpu->pc);
+  state.next_pc = 0;
+  state.halted = FALSE;
+  state.budget = count;
+  state.cpu = cpu;
+  state.exit_stub = NULL;
+
+  if (!cpu->use_jit || !jit_run(cpu, &state)) {
+    func_interpret(cpu, &state);
+  }
+
+  for (int i = 0; i < RENAME_TABLE_SIZE; i++) {
+    cpu->regs[cpu->rat[i]] = state.regs[i];
+  }
+  cpu->flags[cpu->flag_r_rat] = state.zero_flag;
+  cpu->pc = 4000 + 4 * state.index;
+  cpu->insn_fast_forwarded += count - state.budget;
+
+  /* Front end stops as if HALT had been fetched and retired */
+  if (state.halted) {
+    cpu->halted = TRUE;
+    cpu->fetch.has_insn = FALSE;
+  }
+
+  /* The pipeline never ran through the skipped instructions, so there is nothing to go back to */
+  if (cpu->snapshots) {
+    snapshots_reset(cpu);
+  }
+  return count - state.budget;
+}
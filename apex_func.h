@@ -0,0 +1,37 @@
+#ifndef _APEX_FUNC_H_
+#define _APEX_FUNC_H_
+
+#include "apex_cpu.h"
+
+/*
+ * Functional model: executes code memory at the ISA level without any timing, straight into the
+ * architectural state of a cpu. Used to fast-forward a cpu and as a golden model.
+ */
+
+/* Instruction of threaded code, the handler is the address of the label executing it */
+typedef struct Func_Insn {
+  const void *handler;
+  int rd;
+  int rs1;
+  int rs2;
+  int rs3;
+  int imm;                                      /* Index of the target instruction for BZ and BNZ */
+} Func_Insn;
+
+/* Architectural state of a cpu while the functional model runs */
+typedef struct Func_State {
+  int regs[RENAME_TABLE_SIZE];
+  int zero_flag;
+  int index;                                    /* Next instruction in code memory */
+  int next_pc;                                  /* Target of an indirect jump leaving translated code */
+  int halted;
+  long budget;                                  /* Instructions that may still be executed */
+  APEX_CPU *cpu;
+  unsigned char *exit_stub;                     /* Exit of translated code that can be chained, or NULL */
+} Func_State;
+
+long APEX_cpu_fast_forward(APEX_CPU *cpu, long count);
+int func_code_index(APEX_CPU *cpu, int pc);
+void func_interpret(APEX_CPU *cpu, Func_State *state);
+
+#endif
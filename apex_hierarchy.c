@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include "apex_hierarchy.h"
+
+/* Geometry and hit latency of each level */
+static const struct {
+  const char *name;
+  int sets;
+  int ways;
+  int latency;
+} level_config[LEVEL_COUNT] = {
+    {"L1I", L1I_SETS, L1I_WAYS, L1_LATENCY},
+    {"L1D", L1_SETS, L1_WAYS, L1_LATENCY},
+    {"L2", L2_SETS, L2_WAYS, L2_LATENCY},
+    {"L3", L3_SETS, L3_WAYS, L3_LATENCY},
+};
+
+/**
+ * Method to allocate a hierarchy, every cache starts empty, the L3 unused and the DRAM precharged
+ *
+ * @param arena - arena of the cpu, the hierarchy goes away with it
+ * @return NULL if allocation fails
+ */
+APEX_Hierarchy *
+hierarchy_create(APEX_Arena *arena) {
+  APEX_Hierarchy *hierarchy = arena_calloc(arena, 1, sizeof(APEX_Hierarchy));
+
+  if (!hierarchy) {
+    return NULL;
+  }
+
+  for (int i = 0; i < LEVEL_COUNT; i++) {
+    Cache_Level *level = &hierarchy->level[i];
+
+    if (!cache_init(&level->cache, arena, level_config[i].sets, level_config[i].ways)) {
+      return NULL;
+    }
+    level->name = level_config[i].name;
+    level->latency = level_config[i].latency;
+  }
+  dram_init(&hierarchy->dram, DRAM_BANKS, DRAM_QUEUE_DEPTH);
+  return hierarchy;
+}
+
+/* Level that the misses of a level go to, LEVEL_COUNT for the DRAM */
+static int
+level_below(APEX_Hierarchy *hierarchy, int level) {
+  if (level == LEVEL_L1I || level == LEVEL_L1D) return LEVEL_L2;
+  if (level == LEVEL_L2 && hierarchy->use_l3) return LEVEL_L3;
+  return LEVEL_COUNT;
+}
+
+static void write_back(APEX_Hierarchy *hierarchy, int level, int line_address, int clock);
+
+/*
+ * Picks the line of a level that a new tag goes to, a dirty victim is written back to the level below
+ */
+static Cache_Line *
+replace_line(APEX_Hierarchy *hierarchy, int level, int line_address, int clock) {
+  APEX_Cache *cache = &hierarchy->level[level].cache;
+  Cache_Line *victim = cache_victim(cache, line_address);
+
+  if (victim->state == LINE_MODIFIED) {
+    write_back(hierarchy, level_below(hierarchy, level), victim->tag, clock);
+  }
+  return cache_allocate(cache, line_address);
+}
+
+/*
+ * Dirty line evicted by the level above, it is buffered and does not hold up the access that evicted it
+ */
+static void
+write_back(APEX_Hierarchy *hierarchy, int level, int line_address, int clock) {
+  Cache_Level *cache_level;
+  Cache_Line *line;
+
+  if (level == LEVEL_COUNT) {
+    dram_access(&hierarchy->dram, line_address, true, clock);
+    return;
+  }
+
+  cache_level = &hierarchy->level[level];
+  cache_level->writebacks_in++;
+  line = cache_find(&cache_level->cache, line_address);
+  if (line) {
+    cache_touch(&cache_level->cache, line);
+  } else {
+    line = replace_line(hierarchy, level, line_address, clock);
+  }
+  line->state = LINE_MODIFIED;
+}
+
+/**
+ * Method to time a demand access, misses are filled into every level on the way back
+ *
+ * @param hierarchy pointer to the hierarchy
+ * @param level - LEVEL_L1I or LEVEL_L1D, or a lower level for an access that missed above it
+ * @param line_address - line being accessed
+ * @param is_write - store, the line becomes dirty
+ * @param clock - cycle the access reaches the level
+ * @return cycles until the data is available, the latency of a hit included
+ */
+int
+hierarchy_access(APEX_Hierarchy *hierarchy, int level, int line_address, bool is_write, int clock) {
+  Cache_Level *cache_level;
+  Cache_Line *line;
+  int latency;
+
+  if (level == LEVEL_COUNT) {
+    return dram_access(&hierarchy->dram, line_address, false, clock);
+  }
+
+  cache_level = &hierarchy->level[level];
+  latency = cache_level->latency;
+  line = cache_find(&cache_level->cache, line_address);
+
+  if (line) {
+    cache_hit(&cache_level->cache, line, clock);
+
+    /* The fill of a prefetch may still be on its way */
+    if (line->ready > clock + latency) latency = line->ready - clock;
+  } else {
+    cache_miss(&cache_level->cache);
+    latency += hierarchy_access(hierarchy, level_below(hierarchy, level), line_address, false,
+                                clock + cache_level->latency);
+    line = replace_line(hierarchy, level, line_address, clock);
+    line->state = LINE_EXCLUSIVE;
+    line->ready = clock + latency;
+    cache_level->fills++;
+  }
+  if (is_write) line->state = LINE_MODIFIED;
+
+  cache_level->latency_total += latency;
+  if (latency > cache_level->latency_max) cache_level->latency_max = latency;
+  return latency;
+}
+
+/**
+ * Method to bring a line into a level ahead of a demand access, the levels below are accessed as for a miss
+ *
+ * @param hierarchy pointer to the hierarchy
+ * @param level - level filled by the prefetcher
+ * @param line_address - line to be prefetched
+ * @param clock - cycle of the request
+ * @return -1 if the line is already present, otherwise cycles until the fill completes
+ */
+int
+hierarchy_prefetch(APEX_Hierarchy *hierarchy, int level, int line_address, int clock) {
+  Cache_Level *cache_level = &hierarchy->level[level];
+  Cache_Line *line;
+  int latency;
+
+  if (cache_find(&cache_level->cache, line_address)) {
+    return -1;
+  }
+
+  latency = hierarchy_access(hierarchy, level_below(hierarchy, level), line_address, false, clock);
+  line = replace_line(hierarchy, level, line_address, clock);
+  line->state = LINE_EXCLUSIVE;
+  line->prefetched = TRUE;
+  line->ready = clock + latency;
+  cache_level->fills++;
+  return latency;
+}
+
+/* Latency of a data access of M2, for the distribution printed with the statistics */
+void
+hierarchy_record_latency(APEX_Hierarchy *hierarchy, int latency) {
+  hierarchy->latency_histogram[(latency < LATENCY_HISTOGRAM_SIZE) ? latency : LATENCY_HISTOGRAM_SIZE - 1]++;
+  hierarchy->accesses++;
+}
+
+/* Smallest latency that at least the given share of data accesses did not exceed */
+static int
+latency_percentile(APEX_Hierarchy *hierarchy, double share) {
+  long needed = (long) (share * hierarchy->accesses + 0.999999);
+  long seen = 0;
+
+  for (int i = 0; i < LATENCY_HISTOGRAM_SIZE; i++) {
+    seen += hierarchy->latency_histogram[i];
+    if (seen >= needed && seen > 0) return i;
+  }
+  return 0;
+}
+
+/**
+ * Method to print the accesses, hit rate, latency and bandwidth of each level, the DRAM and the
+ * latency distribution of data accesses
+ *
+ * @param hierarchy pointer to the hierarchy
+ * @param cycles - cycles simulated, for bandwidth
+ */
+void
+print_hierarchy_stats(APEX_Hierarchy *hierarchy, int cycles) {
+  printf("\n---------------------------------------------------------\n");
+  printf("|                   Memory Hierarchy                    |\n");
+  printf("---------------------------------------------------------\n");
+  printf("|   Level  accesses  hit rate  avg lat  max lat  B/cyc  |\n");
+
+  for (int i = 0; i < LEVEL_COUNT; i++) {
+    Cache_Level *level = &hierarchy->level[i];
+    int accesses = level->cache.hits + level->cache.misses;
+    int lines = level->fills + level->cache.writebacks;
+
+    if (i == LEVEL_L3 && !hierarchy->use_l3) continue;
+    printf("|   %-5s  %-8d  %7.1f%%  %7.1f  %7d  %5.2f  |\n", level->name, accesses,
+           accesses ? 100.0 * level->cache.hits / accesses : 0.0,
+           accesses ? (double) level->latency_total / accesses : 0.0, level->latency_max,
+           cycles ? (double) lines * CACHE_LINE_SIZE * 4 / cycles : 0.0);
+  }
+  printf("---------------------------------------------------------\n");
+  print_dram_stats(&hierarchy->dram, cycles);
+  printf("---------------------------------------------------------\n");
+  printf("|   Data access latency  p50: %-4d p90: %-4d p99: %-4d  |\n", latency_percentile(hierarchy, 0.5),
+         latency_percentile(hierarchy, 0.9), latency_percentile(hierarchy, 0.99));
+  printf("|                        p99.9: %-4d max: %-4d%s         |\n", latency_percentile(hierarchy, 0.999),
+         latency_percentile(hierarchy, 1.0), (hierarchy->latency_histogram[LATENCY_HISTOGRAM_SIZE - 1]) ? "+" : " ");
+  printf("---------------------------------------------------------\n");
+}
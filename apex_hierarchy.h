@@ -0,0 +1,47 @@
+#ifndef _APEX_HIERARCHY_H_
+#define _APEX_HIERARCHY_H_
+
+#include "apex_cache.h"
+#include "apex_dram.h"
+
+/* Levels of the hierarchy, L1I and L1D both miss into L2 */
+#define LEVEL_L1I 0x0
+#define LEVEL_L1D 0x1
+#define LEVEL_L2 0x2
+#define LEVEL_L3 0x3
+#define LEVEL_COUNT 4
+
+/* Instructions follow data memory in the line addresses of the hierarchy, so that L2 and DRAM hold both */
+#define CODE_LINE_BASE (DATA_MEMORY_SIZE / CACHE_LINE_SIZE)
+
+/* Cache level of the hierarchy, write-back and write-allocate */
+typedef struct Cache_Level {
+  APEX_Cache cache;
+  const char *name;
+  int latency;                                  /* Cycles of a hit, paid by every access reaching the level */
+  int fills;                                    /* Lines brought in from the level below */
+  int writebacks_in;                            /* Dirty lines written back by the level above */
+  long latency_total;                           /* Cycles until the data of each access was back */
+  int latency_max;
+} Cache_Level;
+
+/*
+ * Timing model of the memory below the pipeline: private L1I and L1D, a unified L2, an optional L3 and
+ * the DRAM. Caches only hold tags, data always lives in data memory, so the hierarchy decides how long
+ * an access takes and never what it returns.
+ */
+typedef struct APEX_Hierarchy {
+  Cache_Level level[LEVEL_COUNT];
+  int use_l3;
+  APEX_DRAM dram;
+  int latency_histogram[LATENCY_HISTOGRAM_SIZE];  /* Data accesses of M2 by latency, the last bucket is open */
+  int accesses;                                 /* Data accesses of M2 */
+} APEX_Hierarchy;
+
+APEX_Hierarchy *hierarchy_create(APEX_Arena *arena);
+int hierarchy_access(APEX_Hierarchy *hierarchy, int level, int line_address, bool is_write, int clock);
+int hierarchy_prefetch(APEX_Hierarchy *hierarchy, int level, int line_address, int clock);
+void hierarchy_record_latency(APEX_Hierarchy *hierarchy, int latency);
+void print_hierarchy_stats(APEX_Hierarchy *hierarchy, int cycles);
+
+#endif
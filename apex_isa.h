@@ -0,0 +1,51 @@
+#ifndef _APEX_ISA_H_
+#define _APEX_ISA_H_
+
+#include "apex_macros.h"
+#include <stdbool.h>
+
+/*
+ * Semantics of APEX instructions, shared by the function units of the pipeline and by the
+ * functional model so that both compute the same results. Called with a constant opcode the
+ * switches fold away.
+ */
+
+/* Result written by an INTU or MUL instruction */
+static inline int alu_result(int opcode, int rs1_value, int rs2_value, int imm) {
+  switch (opcode) {
+    case OPCODE_ADD: return rs1_value + rs2_value;
+    case OPCODE_ADDL: return rs1_value + imm;
+    case OPCODE_SUB:
+    case OPCODE_CMP: return rs1_value - rs2_value;
+    case OPCODE_SUBL: return rs1_value - imm;
+    case OPCODE_MUL: return rs1_value * rs2_value;
+    case OPCODE_AND: return rs1_value & rs2_value;
+    case OPCODE_OR: return rs1_value | rs2_value;
+    case OPCODE_EXOR: return rs1_value ^ rs2_value;
+    case OPCODE_MOVC: return imm;
+  }
+  return 0;
+}
+
+/* Instructions that set the zero flag from their result */
+static inline bool alu_sets_zero_flag(int opcode) {
+  return opcode == OPCODE_SUB || opcode == OPCODE_SUBL || opcode == OPCODE_CMP;
+}
+
+/* Data memory address of a LOAD, LDR, STORE or STR */
+static inline int memory_address(int opcode, int rs1_value, int rs2_value, int rs3_value, int imm) {
+  switch (opcode) {
+    case OPCODE_LOAD: return rs1_value + imm;
+    case OPCODE_LDR: return rs1_value + rs2_value;
+    case OPCODE_STORE: return rs2_value + imm;
+    case OPCODE_STR: return rs2_value + rs3_value;
+  }
+  return 0;
+}
+
+/* BZ and BNZ are taken depending on the zero flag */
+static inline bool branch_taken(int opcode, int zero_flag) {
+  return (opcode == OPCODE_BZ) ? zero_flag : !zero_flag;
+}
+
+#endif
@@ -0,0 +1,477 @@
+#include "apex_jit.h"
+#include "apex_isa.h"
+#include <stddef.h>
+
+#if defined(__x86_64__) && defined(__unix__)
+
+#include <sys/mman.h>
+
+/* Reasons for leaving translated code, returned in eax */
+#define EXIT_NEXT 0x0                           /* state->index is the next block */
+#define EXIT_INDIRECT 0x1                       /* state->next_pc is the target of a JUMP or JAL */
+#define EXIT_HALT 0x2
+
+/* Machine registers used by translated code */
+#define RAX 0x0
+#define RCX 0x1
+#define RDX 0x2
+#define RSI 0x6
+#define RDI 0x7
+
+/* Bytes of an exit stub, see emit_exit_stub() */
+#define EXIT_STUB_SIZE 27
+
+/* Bytes of the budget check at the start of a block, see translate_block() */
+#define BLOCK_HEADER_SIZE 46
+
+/* Bytes of the largest instruction (JAL) not counting exit stubs */
+#define MAX_INSN_BYTES 40
+
+/*
+ * Upper bound of the native code of a block, checked before it is translated. Only the last
+ * instruction emits exit stubs, two for BZ / BNZ or one when the block is cut.
+ */
+#define MAX_BLOCK_BYTES(length) (BLOCK_HEADER_SIZE + (length) * MAX_INSN_BYTES + 2 * EXIT_STUB_SIZE)
+
+#define STATE_OFFSET(field) ((int) offsetof(Func_State, field))
+#define REG_OFFSET(reg) (STATE_OFFSET(regs) + 4 * (reg))
+
+typedef int (*Jit_Entry)(Func_State *state, unsigned char *code);
+
+/* Basic block starting at an instruction of code memory */
+typedef struct Jit_Block {
+  unsigned char *code;                          /* Translated code, NULL until the block is hot */
+  int length;                                   /* Instructions in the block, 0 until first entered */
+  int executions;                               /* Entries before translation */
+} Jit_Block;
+
+typedef struct APEX_Jit {
+  unsigned char *cache;                         /* JIT_CODE_SIZE bytes, readable, writable and executable */
+  unsigned char *free;                          /* Next byte to be emitted */
+  unsigned char *exit;                          /* Common exit of translated code */
+  Jit_Entry enter;
+  Jit_Block *blocks;                            /* One per instruction of code memory and the HALT after it */
+
+  long blocks_translated;
+  long blocks_chained;
+  long flushes;
+} APEX_Jit;
+
+/* Emission of machine code, p is the next byte */
+static void emit8(unsigned char **p, int byte) {
+  *(*p)++ = (unsigned char) byte;
+}
+
+static void emit32(unsigned char **p, int value) {
+  memcpy(*p, &value, 4);
+  *p += 4;
+}
+
+static void emit64(unsigned char **p, const void *value) {
+  memcpy(*p, &value, 8);
+  *p += 8;
+}
+
+/* Instruction with a [rbx + disp32] memory operand */
+static void emit_mem(unsigned char **p, int opcode, int reg, int offset) {
+  emit8(p, opcode);
+  emit8(p, 0x83 | (reg << 3));
+  emit32(p, offset);
+}
+
+/* mov reg, dword [rbx + offset] */
+static void emit_load(unsigned char **p, int reg, int offset) {
+  emit_mem(p, 0x8b, reg, offset);
+}
+
+/* mov dword [rbx + offset], reg */
+static void emit_store(unsigned char **p, int reg, int offset) {
+  emit_mem(p, 0x89, reg, offset);
+}
+
+/* mov dword [rbx + offset], value */
+static void emit_store_imm(unsigned char **p, int offset, int value) {
+  emit_mem(p, 0xc7, 0, offset);
+  emit32(p, value);
+}
+
+/* add reg, value */
+static void emit_add_imm(unsigned char **p, int reg, int value) {
+  emit8(p, 0x81);
+  emit8(p, 0xc0 | reg);
+  emit32(p, value);
+}
+
+/* jmp target */
+static void emit_jump(unsigned char **p, const unsigned char *target) {
+  emit8(p, 0xe9);
+  emit32(p, (int) (target - (*p + 4)));
+}
+
+/* Sets the zero flag of the state from ZF of the last arithmetic instruction */
+static void emit_zero_flag(unsigned char **p) {
+  emit8(p, 0x0f);                               /* sete cl */
+  emit8(p, 0x94);
+  emit8(p, 0xc1);
+  emit8(p, 0x0f);                               /* movzx ecx, cl */
+  emit8(p, 0xb6);
+  emit8(p, 0xc9);
+  emit_store(p, RCX, STATE_OFFSET(zero_flag));
+}
+
+/* Calls a C function with rdi holding the cpu, other arguments must already be in place */
+static void emit_call(unsigned char **p, const void *function) {
+  emit8(p, 0x48);                               /* mov rdi, [rbx + cpu] */
+  emit_load(p, RDI, STATE_OFFSET(cpu));
+  emit8(p, 0x48);                               /* mov rax, function */
+  emit8(p, 0xb8);
+  emit64(p, function);
+  emit8(p, 0xff);                               /* call rax */
+  emit8(p, 0xd0);
+}
+
+/* Leaves translated code with eax = reason, rdx = NULL */
+static void emit_exit(APEX_Jit *jit, unsigned char **p, int reason) {
+  emit8(p, 0xb8);                               /* mov eax, reason */
+  emit32(p, reason);
+  emit8(p, 0x31);                               /* xor edx, edx */
+  emit8(p, 0xd2);
+  emit_jump(p, jit->exit);
+}
+
+/*
+ * Continues at the instruction at index. The first 5 bytes are replaced by a jump to the
+ * translated block once there is one, until then the stub passes its own address in rdx.
+ */
+static void emit_exit_stub(APEX_Jit *jit, unsigned char **p, int index) {
+  unsigned char *stub = *p;
+
+  emit_store_imm(p, STATE_OFFSET(index), index);
+  emit8(p, 0x48);                               /* mov rdx, stub */
+  emit8(p, 0xba);
+  emit64(p, stub);
+  emit8(p, 0x31);                               /* xor eax, eax */
+  emit8(p, 0xc0);
+  emit_jump(p, jit->exit);
+}
+
+/*
+ * Entry and exit of translated code. The entry keeps the state in rbx, which also aligns the stack
+ * for calls, and jumps to the block. The exit records the stub it was reached from.
+ */
+static void emit_trampolines(APEX_Jit *jit) {
+  unsigned char *p = jit->cache;
+
+  jit->enter = (Jit_Entry) (void *) p;
+  emit8(&p, 0x53);                              /* push rbx */
+  emit8(&p, 0x48);                              /* mov rbx, rdi */
+  emit8(&p, 0x89);
+  emit8(&p, 0xfb);
+  emit8(&p, 0xff);                              /* jmp rsi */
+  emit8(&p, 0xe6);
+
+  jit->exit = p;
+  emit8(&p, 0x48);                              /* mov [rbx + exit_stub], rdx */
+  emit_store(&p, RDX, STATE_OFFSET(exit_stub));
+  emit8(&p, 0x5b);                              /* pop rbx */
+  emit8(&p, 0xc3);                              /* ret */
+
+  jit->free = p;
+}
+
+/* Instructions from index up to and including the next one that leaves straight-line code */
+static int block_length(APEX_CPU *cpu, int index) {
+  int length = 0;
+
+  while (length < JIT_MAX_BLOCK_LENGTH) {
+    const APEX_Uop *uop = (index + length < cpu->code_memory_size) ? &cpu->uops[index + length] : &halt_uop;
+
+    length++;
+    if (uop->opcode == OPCODE_BZ || uop->opcode == OPCODE_BNZ || uop->opcode == OPCODE_JUMP ||
+        uop->opcode == OPCODE_JAL || uop->opcode == OPCODE_HALT) {
+      break;
+    }
+  }
+  return length;
+}
+
+/* Emits one instruction, the last instruction of a block also emits the exits of the block */
+static void translate_insn(APEX_Jit *jit, APEX_CPU *cpu, unsigned char **p, int index) {
+  const APEX_Uop *uop = (index < cpu->code_memory_size) ? &cpu->uops[index] : &halt_uop;
+  static const unsigned char alu_opcode[NUM_OPCODES] = {
+      [OPCODE_ADD] = 0x03, [OPCODE_SUB] = 0x2b, [OPCODE_AND] = 0x23,
+      [OPCODE_OR] = 0x0b,  [OPCODE_EXOR] = 0x33, [OPCODE_CMP] = 0x3b,
+  };
+
+  switch (uop->opcode) {
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_EXOR:
+      emit_load(p, RAX, REG_OFFSET(uop->rs1));
+      emit_mem(p, alu_opcode[uop->opcode], RAX, REG_OFFSET(uop->rs2));
+      emit_store(p, RAX, REG_OFFSET(uop->rd));
+      if (alu_sets_zero_flag(uop->opcode)) emit_zero_flag(p);
+      break;
+
+    case OPCODE_CMP:
+      emit_load(p, RAX, REG_OFFSET(uop->rs1));
+      emit_mem(p, alu_opcode[uop->opcode], RAX, REG_OFFSET(uop->rs2));
+      emit_zero_flag(p);
+      break;
+
+    case OPCODE_MUL:
+      emit_load(p, RAX, REG_OFFSET(uop->rs1));
+      emit8(p, 0x0f);                           /* imul eax, [rbx + rs2] */
+      emit_mem(p, 0xaf, RAX, REG_OFFSET(uop->rs2));
+      emit_store(p, RAX, REG_OFFSET(uop->rd));
+      break;
+
+    case OPCODE_ADDL:
+    case OPCODE_SUBL:
+      emit_load(p, RAX, REG_OFFSET(uop->rs1));
+      emit8(p, 0x81);                           /* add / sub eax, imm */
+      emit8(p, (uop->opcode == OPCODE_ADDL) ? 0xc0 : 0xe8);
+      emit32(p, uop->imm);
+      emit_store(p, RAX, REG_OFFSET(uop->rd));
+      if (alu_sets_zero_flag(uop->opcode)) emit_zero_flag(p);
+      break;
+
+    case OPCODE_MOVC:
+      emit_store_imm(p, REG_OFFSET(uop->rd), uop->imm);
+      break;
+
+    case OPCODE_LOAD:
+    case OPCODE_LDR:
+      emit_load(p, RSI, REG_OFFSET(uop->rs1));
+      if (uop->opcode == OPCODE_LOAD) {
+        emit_add_imm(p, RSI, uop->imm);
+      } else {
+        emit_mem(p, 0x03, RSI, REG_OFFSET(uop->rs2));
+      }
+      emit_call(p, (const void *) read_data_memory);
+      emit_store(p, RAX, REG_OFFSET(uop->rd));
+      break;
+
+    case OPCODE_STORE:
+    case OPCODE_STR:
+      emit_load(p, RSI, REG_OFFSET(uop->rs2));
+      if (uop->opcode == OPCODE_STORE) {
+        emit_add_imm(p, RSI, uop->imm);
+      } else {
+        emit_mem(p, 0x03, RSI, REG_OFFSET(uop->rs3));
+      }
+      emit_load(p, RDX, REG_OFFSET(uop->rs1));
+      emit_call(p, (const void *) write_data_memory);
+      break;
+
+    case OPCODE_BZ:
+    case OPCODE_BNZ:
+      emit_load(p, RAX, STATE_OFFSET(zero_flag));
+      emit8(p, 0x85);                           /* test eax, eax */
+      emit8(p, 0xc0);
+      emit8(p, 0x0f);                           /* jnz / jz over the fall through stub */
+      emit8(p, (uop->opcode == OPCODE_BZ) ? 0x85 : 0x84);
+      emit32(p, EXIT_STUB_SIZE);
+      emit_exit_stub(jit, p, index + 1);
+      emit_exit_stub(jit, p, func_code_index(cpu, 4000 + 4 * index + uop->imm));
+      break;
+
+    case OPCODE_JUMP:
+    case OPCODE_JAL:
+      /* Target is computed before the link register is written, rd may be rs1 */
+      emit_load(p, RCX, REG_OFFSET(uop->rs1));
+      emit_add_imm(p, RCX, uop->imm);
+      if (uop->opcode == OPCODE_JAL) emit_store_imm(p, REG_OFFSET(uop->rd), 4000 + 4 * index + 4);
+      emit_store(p, RCX, STATE_OFFSET(next_pc));
+      emit_exit(jit, p, EXIT_INDIRECT);
+      break;
+
+    case OPCODE_HALT:
+      emit_store_imm(p, STATE_OFFSET(index), index + 1);
+      emit_exit(jit, p, EXIT_HALT);
+      break;
+
+    default:
+      /* DIV and NOP do not change any state */
+      break;
+  }
+}
+
+/*
+ * This function translates the block starting at index. On entry the block takes its length from
+ * the budget and bails out to the interpreter if that leaves it negative.
+ */
+static unsigned char *
+translate_block(APEX_Jit *jit, APEX_CPU *cpu, int index, int length) {
+  unsigned char *code = jit->free;
+  unsigned char *p = code;
+  unsigned char *bail;
+  const APEX_Uop *last = (index + length - 1 < cpu->code_memory_size) ? &cpu->uops[index + length - 1] : &halt_uop;
+
+  emit8(&p, 0x48);                              /* sub qword [rbx + budget], length */
+  emit_mem(&p, 0x81, 5, STATE_OFFSET(budget));
+  emit32(&p, length);
+  emit8(&p, 0x7d);                              /* jge over the bail out */
+  emit8(&p, 0);
+  bail = p;
+  emit8(&p, 0x48);                              /* add qword [rbx + budget], length */
+  emit_mem(&p, 0x81, 0, STATE_OFFSET(budget));
+  emit32(&p, length);
+  emit_store_imm(&p, STATE_OFFSET(index), index);
+  emit_exit(jit, &p, EXIT_NEXT);
+  bail[-1] = (unsigned char) (p - bail);
+
+  for (int i = 0; i < length; i++) {
+    translate_insn(jit, cpu, &p, index + i);
+  }
+
+  /* Block cut at JIT_MAX_BLOCK_LENGTH falls through into the next one */
+  if (last->opcode != OPCODE_BZ && last->opcode != OPCODE_BNZ && last->opcode != OPCODE_JUMP &&
+      last->opcode != OPCODE_JAL && last->opcode != OPCODE_HALT) {
+    emit_exit_stub(jit, &p, index + length);
+  }
+
+  jit->free = p;
+  jit->blocks_translated++;
+  return code;
+}
+
+/* Drops every translated block, stubs only ever jump within the cache so none is left dangling */
+static void flush_code_cache(APEX_Jit *jit, APEX_CPU *cpu) {
+  for (int i = 0; i <= cpu->code_memory_size; i++) {
+    jit->blocks[i].code = NULL;
+    jit->blocks[i].executions = 0;
+  }
+  emit_trampolines(jit);
+  jit->flushes++;
+}
+
+/**
+ * Method to allocate the code cache of a cpu, the jit and its block table come from the arena of the cpu
+ *
+ * @param cpu pointer to current instance of cpu
+ * @return NULL if executable memory is not available
+ */
+static APEX_Jit *
+jit_create(APEX_CPU *cpu) {
+  APEX_Jit *jit = arena_calloc(cpu->arena, 1, sizeof(APEX_Jit));
+
+  if (!jit) {
+    return NULL;
+  }
+
+  jit->blocks = arena_calloc(cpu->arena, cpu->code_memory_size + 1, sizeof(Jit_Block));
+  jit->cache = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (!jit->blocks || jit->cache == MAP_FAILED) {
+    return NULL;
+  }
+
+  emit_trampolines(jit);
+  return jit;
+}
+
+void
+jit_destroy(APEX_Jit *jit) {
+  if (!jit) {
+    return;
+  }
+  munmap(jit->cache, JIT_CODE_SIZE);
+}
+
+/*
+ * This function runs the functional model block by block until the budget runs out or HALT has
+ * been executed. Hot blocks run natively and stay there for as long as they are chained, the
+ * others and the last instructions of the budget run in the interpreter.
+ */
+bool
+jit_run(APEX_CPU *cpu, Func_State *state) {
+  APEX_Jit *jit = cpu->jit;
+
+  if (!jit) {
+    jit = cpu->jit = jit_create(cpu);
+    if (!jit) {
+      fprintf(stderr, "APEX_Error: Unable to allocate JIT code cache, interpreting instead\n");
+      cpu->use_jit = FALSE;
+      return false;
+    }
+  }
+
+  while (!state->halted && state->budget > 0) {
+    Jit_Block *block = &jit->blocks[state->index];
+
+    if (!block->length) {
+      block->length = block_length(cpu, state->index);
+    }
+
+    if (!block->code && ++block->executions >= JIT_HOT_THRESHOLD) {
+      if (jit->free + MAX_BLOCK_BYTES(block->length) > jit->cache + JIT_CODE_SIZE) {
+        flush_code_cache(jit, cpu);
+      }
+      block->code = translate_block(jit, cpu, state->index, block->length);
+    }
+
+    if (!block->code || state->budget < block->length) {
+      long budget = state->budget;
+      long slice = (budget < block->length) ? budget : block->length;
+
+      state->budget = slice;
+      func_interpret(cpu, state);
+      state->budget = budget - (slice - state->budget);
+      continue;
+    }
+
+    state->exit_stub = NULL;
+    switch (jit->enter(state, block->code)) {
+      case EXIT_INDIRECT:
+        state->index = func_code_index(cpu, state->next_pc);
+        break;
+      case EXIT_HALT:
+        state->halted = TRUE;
+        break;
+    }
+
+    /* Left through a stub towards a block that has been translated since, jump there directly */
+    if (state->exit_stub && jit->blocks[state->index].code) {
+      unsigned char *p = state->exit_stub;
+
+      emit_jump(&p, jit->blocks[state->index].code);
+      jit->blocks_chained++;
+    }
+  }
+  return true;
+}
+
+void
+print_jit_stats(const APEX_CPU *cpu) {
+  const APEX_Jit *jit = cpu->jit;
+
+  if (!jit) {
+    return;
+  }
+  printf("APEX_Jit: %ld blocks translated, %ld chained, %ld flushes, %ld bytes of code\n",
+         jit->blocks_translated, jit->blocks_chained, jit->flushes, (long) (jit->free - jit->cache));
+}
+
+#else
+
+/* No translator for this host, the functional model always interprets */
+bool
+jit_run(APEX_CPU *cpu, Func_State *state) {
+  (void) state;
+  cpu->use_jit = FALSE;
+  return false;
+}
+
+void
+jit_destroy(struct APEX_Jit *jit) {
+  (void) jit;
+}
+
+void
+print_jit_stats(const APEX_CPU *cpu) {
+  (void) cpu;
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef _APEX_JIT_H_
+#define _APEX_JIT_H_
+
+#include "apex_func.h"
+
+/*
+ * Translator of basic blocks of code memory into native x86-64 code for the functional model.
+ * Blocks end at BZ, BNZ, JUMP, JAL or HALT and are translated once they have been entered
+ * JIT_HOT_THRESHOLD times, colder blocks run in the interpreter. A translated block jumps
+ * straight into the translated block it branches to once both exist (chaining).
+ */
+
+struct APEX_Jit;
+
+bool jit_run(APEX_CPU *cpu, Func_State *state);
+void jit_destroy(struct APEX_Jit *jit);
+void print_jit_stats(const APEX_CPU *cpu);
+
+#endif
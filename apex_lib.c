@@ -0,0 +1,364 @@
+#include "apex_lib.h"
+#include "apex_cpu.h"
+#include "apex_memory.h"
+#include "apex_func.h"
+#include "apex_replay.h"
+#include "apex_snapshot.h"
+
+/* Handle of an embedded simulation, a single cpu owning its code and data memory */
+struct APEX_Sim {
+  APEX_CPU *cpu;
+  int stop_conditions;                          /* APEX_UNTIL_* bits that ended the last run */
+};
+
+/*
+ * Wraps a freshly parsed code memory, the cpu takes ownership of it
+ */
+static APEX_Sim *
+create_sim(APEX_Instruction *code_memory, int code_memory_size) {
+  APEX_Sim *sim;
+
+  if (!code_memory) {
+    fprintf(stderr, "APEX_Error: Unable to parse program\n");
+    return NULL;
+  }
+
+  sim = calloc(1, sizeof(APEX_Sim));
+  if (sim) {
+    sim->cpu = APEX_cpu_init_from_image(code_memory, code_memory_size);
+  }
+  if (!sim || !sim->cpu) {
+    fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
+    free(code_memory);
+    free(sim);
+    return NULL;
+  }
+
+  sim->cpu->owns_code_memory = TRUE;
+  sim->cpu->single_step = FALSE;
+  return sim;
+}
+
+/**
+ * Method to create a simulation of the program in an input file
+ *
+ * @param filename - APEX assembly, one instruction per line
+ * @return NULL if the file cannot be read or the cpu cannot be allocated
+ */
+APEX_Sim *
+APEX_sim_create(const char *filename) {
+  int code_memory_size = 0;
+  APEX_Instruction *code_memory;
+
+  if (!filename) {
+    return NULL;
+  }
+  code_memory = create_code_memory(filename, &code_memory_size);
+  return create_sim(code_memory, code_memory_size);
+}
+
+/**
+ * Method to create a simulation of a program held in memory
+ *
+ * @param image - APEX assembly text, laid out like an input file
+ * @param size - bytes of image
+ * @return NULL if the program is empty or the cpu cannot be allocated
+ */
+APEX_Sim *
+APEX_sim_create_from_image(const char *image, size_t size) {
+  int code_memory_size = 0;
+  APEX_Instruction *code_memory;
+  FILE *fp;
+
+  if (!image || size == 0) {
+    return NULL;
+  }
+
+  fp = fmemopen((void *) image, size, "r");
+  if (!fp) {
+    return NULL;
+  }
+  code_memory = create_code_memory_from_stream(fp, &code_memory_size);
+  fclose(fp);
+  return create_sim(code_memory, code_memory_size);
+}
+
+void
+APEX_sim_destroy(APEX_Sim *sim) {
+  if (!sim) {
+    return;
+  }
+  APEX_cpu_stop(sim->cpu);
+  free(sim);
+}
+
+/* Same names and ranges as --set */
+bool
+APEX_sim_set(APEX_Sim *sim, const char *name, int value) {
+  return APEX_cpu_set(sim->cpu, name, value);
+}
+
+bool
+APEX_sim_load_memory(APEX_Sim *sim, const char *filename) {
+  bool loaded = load_data_memory(sim->cpu->data_memory, filename);
+
+  if (sim->cpu->replay) {
+    replay_input(sim->cpu, "load %016llx", memory_hash(sim->cpu->data_memory));
+  }
+  if (sim->cpu->snapshots) {
+    snapshots_reset(sim->cpu);
+  }
+  return loaded;
+}
+
+/* Writes data memory [start, end), end -1 for up to the highest page holding data */
+bool
+APEX_sim_dump_memory(APEX_Sim *sim, const char *filename, int start, int end) {
+  return dump_data_memory(sim->cpu->data_memory, filename, start, end);
+}
+
+/**
+ * Method to simulate a number of cycles
+ *
+ * @param sim - simulation
+ * @param cycles - to be simulated
+ * @return cycles elapsed, idle cycles skipped in event-driven mode included
+ */
+long
+APEX_sim_step(APEX_Sim *sim, long cycles) {
+  int start = sim->cpu->clock;
+
+  if (cycles <= 0) {
+    return 0;
+  }
+  APEX_cpu_run(sim->cpu, (cycles < INT_MAX) ? (int) cycles : INT_MAX, false);
+  return sim->cpu->clock - start;
+}
+
+/* Run-until predicates are evaluated by the pipeline itself */
+_Static_assert(APEX_UNTIL_PC == STOP_AT_PC && APEX_UNTIL_INSTRET == STOP_AT_INSTRET &&
+               APEX_UNTIL_CYCLE == STOP_AT_CYCLE && APEX_UNTIL_MEMORY_WRITE == STOP_ON_WRITE &&
+               APEX_UNTIL_REGISTER == STOP_ON_REGISTER && APEX_UNTIL_HALT == STOP_ON_HALT,
+               "APEX_UNTIL_* must match STOP_*");
+
+#define APEX_UNTIL_ALL (APEX_UNTIL_PC | APEX_UNTIL_INSTRET | APEX_UNTIL_CYCLE | APEX_UNTIL_MEMORY_WRITE | \
+                        APEX_UNTIL_REGISTER | APEX_UNTIL_HALT)
+
+static int
+clamp_int(long value) {
+  return (value > INT_MAX) ? INT_MAX : (value < INT_MIN) ? INT_MIN : (int) value;
+}
+
+/**
+ * Method to simulate until any of a set of conditions holds
+ *
+ * Each condition is armed in the stage that can make it true (commit, M2 or the end of a cycle) and the
+ * run stops right after the instruction or in the cycle that satisfied it, there is no check at all on
+ * stages whose conditions are not set.
+ *
+ * @param sim - simulation
+ * @param until - conditions, NULL to run until HALT
+ * @param max_cycles - limit of cycles simulated by this call
+ * @return APEX_STOP_* reason, APEX_sim_stop_conditions() tells which conditions hit
+ */
+int
+APEX_sim_run(APEX_Sim *sim, const APEX_Sim_Until *until, long max_cycles) {
+  APEX_CPU *cpu = sim->cpu;
+  Stop_Condition *stop = &cpu->stop;
+  int conditions = until ? until->conditions : 0;
+
+  sim->stop_conditions = 0;
+  if (conditions & ~APEX_UNTIL_ALL) {
+    fprintf(stderr, "APEX_Error: Invalid run-until conditions 0x%x\n", conditions);
+    return APEX_STOP_ERROR;
+  }
+
+  if (until) {
+    stop->pc = until->pc;
+    stop->instret = clamp_int(until->instret);
+    stop->cycle = clamp_int(until->cycle);
+    stop->address = until->address;
+    stop->reg = until->reg;
+    stop->value = until->value;
+  }
+
+  /* Counts that have already been reached */
+  if ((conditions & APEX_UNTIL_CYCLE) && cpu->clock >= stop->cycle) sim->stop_conditions |= APEX_UNTIL_CYCLE;
+  if ((conditions & APEX_UNTIL_INSTRET) && cpu->insn_completed >= stop->instret) {
+    sim->stop_conditions |= APEX_UNTIL_INSTRET;
+  }
+  if (sim->stop_conditions) {
+    return APEX_STOP_CONDITION;
+  }
+  if (cpu->halted) {
+    return APEX_STOP_HALTED;
+  }
+  if (max_cycles <= 0) {
+    return APEX_STOP_MAX_CYCLES;
+  }
+
+  /* The program is over once HALT retires, everything older has retired and nothing younger was fetched */
+  stop->armed = conditions | STOP_ON_HALT;
+  APEX_cpu_run(cpu, clamp_int(max_cycles), false);
+  stop->armed = 0;
+
+  sim->stop_conditions = stop->hit & conditions;
+  if (sim->stop_conditions) {
+    return APEX_STOP_CONDITION;
+  }
+  return cpu->halted ? APEX_STOP_HALTED : APEX_STOP_MAX_CYCLES;
+}
+
+/**
+ * Method to simulate until a single condition holds
+ *
+ * @param sim - simulation
+ * @param condition - APEX_UNTIL_PC, APEX_UNTIL_INSTRET, APEX_UNTIL_CYCLE, APEX_UNTIL_MEMORY_WRITE or
+ *                    APEX_UNTIL_HALT
+ * @param value - pc, retired instruction count, cycle or address to stop at, unused for HALT
+ * @param max_cycles - limit of cycles simulated by this call
+ * @return APEX_STOP_* reason
+ */
+int
+APEX_sim_run_until(APEX_Sim *sim, int condition, long value, long max_cycles) {
+  APEX_Sim_Until until = {condition, clamp_int(value), value, value, clamp_int(value), 0, 0};
+
+  if (condition == APEX_UNTIL_REGISTER || (condition & (condition - 1))) {
+    fprintf(stderr, "APEX_Error: Invalid run-until condition %d\n", condition);
+    return APEX_STOP_ERROR;
+  }
+  return APEX_sim_run(sim, &until, max_cycles);
+}
+
+/* Conditions that ended the last run */
+int
+APEX_sim_stop_conditions(const APEX_Sim *sim) {
+  return sim->stop_conditions;
+}
+
+/**
+ * Method to start recording the inputs and periodic state hashes of the simulation, call it once the
+ * program and data memory are in place
+ *
+ * @param sim - simulation
+ * @param filename - log to be written
+ * @param interval - cycles between state hashes, 0 for the default
+ * @return false if the log cannot be created
+ */
+bool
+APEX_sim_record(APEX_Sim *sim, const char *filename, int interval) {
+  return replay_open(sim->cpu, filename, false, interval);
+}
+
+/* Checks the simulation against a recorded log from now on, the first divergence goes to stderr */
+bool
+APEX_sim_replay(APEX_Sim *sim, const char *filename) {
+  return replay_open(sim->cpu, filename, true, 0);
+}
+
+/* Ends recording or replaying, false if the replayed run diverged from the log */
+bool
+APEX_sim_close_log(APEX_Sim *sim) {
+  return replay_close(sim->cpu);
+}
+
+/* Executes up to count instructions on the functional model, the pipeline must be empty */
+long
+APEX_sim_fast_forward(APEX_Sim *sim, long count) {
+  return APEX_cpu_fast_forward(sim->cpu, count);
+}
+
+void
+APEX_sim_get_stats(const APEX_Sim *sim, APEX_Sim_Stats *stats) {
+  const APEX_CPU *cpu = sim->cpu;
+
+  stats->cycles = cpu->clock;
+  stats->insn_retired = cpu->insn_completed;
+  stats->insn_fast_forwarded = cpu->insn_fast_forwarded;
+  stats->branch_mispredictions = cpu->branch_mispredictions;
+  stats->insn_squashed = cpu->insn_squashed;
+  stats->cycles_skipped = cpu->cycles_skipped;
+  stats->loads_speculated = cpu->loads_speculated;
+  stats->memory_violations = cpu->memory_violations;
+  stats->false_dependences = cpu->false_dependences;
+  stats->ops_eliminated = 0;
+  for (int i = ELIMINATED_CONSTANT; i <= ELIMINATED_MOVE; i++) {
+    stats->ops_eliminated += cpu->ops_eliminated[i];
+  }
+  stats->ops_fused = cpu->compare_branches_fused + cpu->address_loads_fused;
+  stats->run_allocations = cpu->run_allocations;
+  stats->halted = cpu->halted;
+}
+
+/* Pc of the next instruction to retire, every older instruction has retired */
+int
+APEX_sim_get_pc(const APEX_Sim *sim) {
+  APEX_CPU *cpu = sim->cpu;
+
+  if (!rob_empty(cpu)) {
+    return cpu->reorder_buffer.buffer[cpu->reorder_buffer.head].pc_value;
+  }
+  if (cpu->decode.has_insn) {
+    return cpu->decode.pc;
+  }
+  return cpu->pc;
+}
+
+/* Committed value of an architectural register */
+int
+APEX_sim_get_register(const APEX_Sim *sim, int reg) {
+  if (reg < 0 || reg >= RENAME_TABLE_SIZE) {
+    return 0;
+  }
+  return sim->cpu->regs[sim->cpu->r_rat[reg]];
+}
+
+/**
+ * Method to change an architectural register, only while no instruction is in flight
+ *
+ * @param sim - simulation
+ * @param reg - architectural register
+ * @param value - new value
+ * @return false if the register does not exist or the pipeline is not empty
+ */
+bool
+APEX_sim_set_register(APEX_Sim *sim, int reg, int value) {
+  APEX_CPU *cpu = sim->cpu;
+
+  if (reg < 0 || reg >= RENAME_TABLE_SIZE || !rob_empty(cpu) || cpu->decode.has_insn) {
+    return false;
+  }
+  if (cpu->replay) {
+    replay_input(cpu, "reg %d %d", reg, value);
+  }
+  cpu->regs[cpu->rat[reg]] = value;
+  if (cpu->snapshots) {
+    snapshots_reset(cpu);
+  }
+  return true;
+}
+
+int
+APEX_sim_read_memory(const APEX_Sim *sim, int address) {
+  return memory_read(sim->cpu->data_memory, address);
+}
+
+bool
+APEX_sim_write_memory(APEX_Sim *sim, int address, int value) {
+  if (address < 0 || address >= DATA_MEMORY_SIZE) {
+    return false;
+  }
+  if (sim->cpu->replay) {
+    replay_input(sim->cpu, "mem %d %d", address, value);
+  }
+  memory_write(sim->cpu->data_memory, address, value);
+  if (sim->cpu->snapshots) {
+    snapshots_reset(sim->cpu);
+  }
+  return true;
+}
+
+int
+APEX_sim_num_registers(void) {
+  return RENAME_TABLE_SIZE;
+}
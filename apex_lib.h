@@ -0,0 +1,93 @@
+#ifndef _APEX_LIB_H_
+#define _APEX_LIB_H_
+
+/*
+ * libapexsim: interface for embedding the APEX simulator in another program.
+ *
+ * A simulation is reached only through an opaque APEX_Sim handle, so the layout of the cpu can
+ * change without breaking callers. Nothing in this interface prints to stdout, errors are reported
+ * through return values (and an APEX_Error line on stderr).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct APEX_Sim APEX_Sim;
+
+/* Conditions of a run, any combination may be armed at once */
+#define APEX_UNTIL_PC 0x1                       /* Instruction at pc has retired */
+#define APEX_UNTIL_INSTRET 0x2                  /* instret instructions have retired */
+#define APEX_UNTIL_CYCLE 0x4                    /* Clock has reached cycle */
+#define APEX_UNTIL_MEMORY_WRITE 0x8             /* A store has written address */
+#define APEX_UNTIL_REGISTER 0x10                /* A retired instruction has written value to reg */
+#define APEX_UNTIL_HALT 0x20                    /* HALT has retired */
+
+/* Reasons for a run to return */
+#define APEX_STOP_CONDITION 0x0
+#define APEX_STOP_HALTED 0x1                    /* HALT retired first */
+#define APEX_STOP_MAX_CYCLES 0x2
+#define APEX_STOP_ERROR 0x3
+
+/* Predicates of APEX_sim_run(), only the fields of the conditions that are set are read */
+typedef struct APEX_Sim_Until {
+  int conditions;                               /* APEX_UNTIL_* bits */
+  int pc;
+  long instret;
+  long cycle;
+  int address;
+  int reg;
+  int value;
+} APEX_Sim_Until;
+
+/* Counters of a simulation */
+typedef struct APEX_Sim_Stats {
+  long cycles;
+  long insn_retired;
+  long insn_fast_forwarded;                     /* Executed by the functional model, not retired */
+  long branch_mispredictions;
+  long insn_squashed;
+  long cycles_skipped;                          /* Idle cycles advanced in bulk */
+  long loads_speculated;                        /* Loads executed ahead of an older store */
+  long memory_violations;                       /* Speculated loads squashed for reading a stale value */
+  long false_dependences;                       /* Loads the store set predictor held without need */
+  long ops_eliminated;                          /* Resolved at rename without a function unit */
+  long ops_fused;                               /* Pairs of instructions dispatched as one micro-op */
+  long run_allocations;                         /* Heap allocations inside runs, 0 in steady state */
+  bool halted;
+} APEX_Sim_Stats;
+
+APEX_Sim *APEX_sim_create(const char *filename);
+APEX_Sim *APEX_sim_create_from_image(const char *image, size_t size);
+void APEX_sim_destroy(APEX_Sim *sim);
+
+bool APEX_sim_set(APEX_Sim *sim, const char *name, int value);
+bool APEX_sim_load_memory(APEX_Sim *sim, const char *filename);
+bool APEX_sim_dump_memory(APEX_Sim *sim, const char *filename, int start, int end);
+
+long APEX_sim_step(APEX_Sim *sim, long cycles);
+int APEX_sim_run(APEX_Sim *sim, const APEX_Sim_Until *until, long max_cycles);
+int APEX_sim_run_until(APEX_Sim *sim, int condition, long value, long max_cycles);
+int APEX_sim_stop_conditions(const APEX_Sim *sim);
+long APEX_sim_fast_forward(APEX_Sim *sim, long count);
+
+bool APEX_sim_record(APEX_Sim *sim, const char *filename, int interval);
+bool APEX_sim_replay(APEX_Sim *sim, const char *filename);
+bool APEX_sim_close_log(APEX_Sim *sim);
+
+void APEX_sim_get_stats(const APEX_Sim *sim, APEX_Sim_Stats *stats);
+int APEX_sim_get_pc(const APEX_Sim *sim);
+int APEX_sim_get_register(const APEX_Sim *sim, int reg);
+bool APEX_sim_set_register(APEX_Sim *sim, int reg, int value);
+int APEX_sim_read_memory(const APEX_Sim *sim, int address);
+bool APEX_sim_write_memory(APEX_Sim *sim, int address, int value);
+int APEX_sim_num_registers(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,7 +5,20 @@
 #define TRUE 0x1
 
 /* Integers */
-#define DATA_MEMORY_SIZE 4096
+#define DATA_MEMORY_SIZE (1 << 24)
+
+/* Sparse data memory: 24 bit word address = 7 bit directory, 7 bit table, 10 bit page offset */
+#define MEMORY_PAGE_BITS 10
+#define MEMORY_TABLE_BITS 7
+#define PAGES_PER_CHUNK 16
+
+/*
+ * Arena of a simulation: bytes reserved up front, on top of a share per instruction of the program,
+ * and the size of each block it grows by once that is used up
+ */
+#define ARENA_RESERVE (1 << 20)
+#define ARENA_BYTES_PER_INSN 128
+#define ARENA_BLOCK_SIZE (1 << 20)
 
 /* Size of integer register file */
 #define REG_FILE_SIZE 48
@@ -13,6 +26,125 @@
 #define ROB_SIZE 64
 #define IQ_SIZE 24
 
+/* Cache line size of the host, the arrays scanned every cycle each start on a line of their own */
+#define HOST_CACHE_LINE 64
+
+/* Physical copies of the zero flag, one per flag producer in flight plus the architectural one */
+#define FLAG_FILE_SIZE 16
+
+/* Default number of instructions retired per cycle by the commit stage */
+#define COMMIT_WIDTH 4
+
+/* Branches in flight, each one holds a checkpoint of the rename table */
+#define MAX_BRANCHES 8
+
+/* Order in which ready IQ entries are selected for a function unit (issue_policy) */
+#define ISSUE_OLDEST_FIRST 0x0
+#define ISSUE_RANDOM 0x1
+#define ISSUE_CRITICAL_PATH 0x2
+
+/* Instructions resolved at rename (eliminate), their result is written to the register file right away */
+#define ELIMINATED_NONE 0x0
+#define ELIMINATED_CONSTANT 0x1                 /* MOVC */
+#define ELIMINATED_ZERO_IDIOM 0x2               /* EXOR Rx,Ry,Ry, AND or MUL with a constant 0 */
+#define ELIMINATED_FOLDED 0x3                   /* Every source holds a constant */
+#define ELIMINATED_MOVE 0x4                     /* Result is a source, e.g. ADDL Rx,Ry,#0 or OR Rx,Ry,Ry */
+
+/* Pairs of adjacent instructions fetched as one micro-op, bits of the fusion setting */
+#define FUSE_NONE 0x0
+#define FUSE_COMPARE_BRANCH 0x1                 /* CMP, SUB or SUBL followed by BZ or BNZ */
+#define FUSE_ADDRESS_LOAD 0x2                   /* ADDL followed by a LOAD from the register it wrote */
+#define FUSE_ALL (FUSE_COMPARE_BRANCH | FUSE_ADDRESS_LOAD)
+
+/* Order in which loads and older stores are sent to M1 (load_speculation) */
+#define LOAD_SPECULATION_NONE 0x0               /* Program order, a load waits for every older store */
+#define LOAD_SPECULATION_STORE_SETS 0x1         /* A load waits only for older stores of its store set */
+#define LOAD_SPECULATION_ALWAYS 0x2             /* A load never waits for older stores */
+
+/* Store set predictor, the pc indexed table holds store set ids, pending sets are kept in a bitmask */
+#define STORE_SET_TABLE_SIZE 256
+#define STORE_SET_COUNT 32
+
+/* Run-until predicates, bits of Stop_Condition armed and hit */
+#define STOP_AT_PC 0x1                          /* Instruction at pc retired */
+#define STOP_AT_INSTRET 0x2                     /* Retired instruction count reached */
+#define STOP_AT_CYCLE 0x4                       /* Clock reached */
+#define STOP_ON_WRITE 0x8                       /* Store wrote a data memory address */
+#define STOP_ON_REGISTER 0x10                   /* Retired instruction wrote a value to a register */
+#define STOP_ON_HALT 0x20                       /* HALT retired */
+#define STOP_AT_COMMIT (STOP_AT_PC | STOP_AT_INSTRET | STOP_ON_REGISTER | STOP_ON_HALT)
+
+/* Default cycles between state hashes of a replay log */
+#define REPLAY_INTERVAL 100000
+
+/*
+ * Time travel of the interactive simulator: default cycles between snapshots and the number of
+ * snapshots kept, every other one is dropped and the interval doubled once they are all in use
+ */
+#define SNAPSHOT_INTERVAL 10000
+#define SNAPSHOT_COUNT 32
+#define SNAPSHOT_POOL (SNAPSHOT_COUNT + 2)      /* Slots allocated up front, the periodic ones and two of a reverse search */
+
+/* Translator of the functional model (jit), code cache size in bytes */
+#define JIT_CODE_SIZE (1 << 22)
+#define JIT_HOT_THRESHOLD 16
+#define JIT_MAX_BLOCK_LENGTH 64
+
+/* Multi-core system */
+#define MAX_CORES 8
+#define DEFAULT_QUANTUM 100
+#define BUS_LATENCY 4                           /* Cycles of a bus transaction, or of a line moving between two L1s */
+
+/* Cycle limit of a batch run */
+#define DEFAULT_MAX_CYCLES 1000000
+
+/* Private L1 data cache of each core, sizes in lines and data memory words */
+#define CACHE_LINE_SIZE 16
+#define L1_SETS 16
+#define L1_WAYS 2
+
+/* Cache hierarchy of a single cpu (caches), hit latencies in cycles, L1 hits take no extra cycle */
+#define CACHES_NONE 0x0                         /* Single cycle data memory, as without caches */
+#define CACHES_L2 0x1                           /* L1I, L1D and L2 in front of the DRAM */
+#define CACHES_L3 0x2                           /* ... and an L3 */
+#define L1_LATENCY 1
+#define L2_SETS 64
+#define L2_WAYS 8
+#define L2_LATENCY 8
+#define L3_SETS 256
+#define L3_WAYS 16
+#define L3_LATENCY 24
+#define LATENCY_HISTOGRAM_SIZE 1024
+
+/* DRAM behind the last cache level, timings in cycles */
+#define DRAM_BANKS 8
+#define DRAM_MAX_BANKS 32
+#define DRAM_ROW_LINES 16                       /* Lines per row of a bank */
+#define DRAM_QUEUE_DEPTH 8
+#define DRAM_MAX_QUEUE 64
+#define DRAM_T_CAS 14
+#define DRAM_T_RCD 14
+#define DRAM_T_RP 14
+#define DRAM_T_BURST 4                          /* Data bus cycles per line */
+
+/* Prefetchers (prefetcher), numbers of the table in apex_prefetch.c */
+#define PREFETCH_NONE 0x0
+#define PREFETCH_NEXT_LINE 0x1
+#define PREFETCH_STRIDE 0x2
+#define PREFETCH_STREAM 0x3
+#define PREFETCH_DEGREE 2
+#define PREFETCH_MAX_DEGREE 8
+#define STRIDE_TABLE_SIZE 64
+#define STRIDE_MAX_CONFIDENCE 3
+#define STRIDE_CONFIDENT 2
+#define STREAM_COUNT 8
+#define STREAM_WINDOW 4                         /* Lines a miss may be away from a stream to extend it */
+#define STREAM_CONFIDENT 2
+
+/* Instruction cache of fetch, sizes in lines of CACHE_LINE_SIZE instructions */
+#define L1I_SETS 16
+#define L1I_WAYS 2
+
 /* Numeric OPCODE identifiers for instructions */
 #define OPCODE_ADD 0x0
 #define OPCODE_SUB 0x1
@@ -43,4 +175,7 @@
 /* Set this flag to 1 to enable cycle single-step mode */
 #define ENABLE_SINGLE_STEP 1
 
+/* Set this flag to 1 to skip idle cycles in bulk instead of ticking every stage */
+#define ENABLE_EVENT_DRIVEN 0
+
 #endif
@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "apex_memory.h"
+
+/*
+ * Creates an empty data memory in an arena, no page is allocated until it is written
+ */
+APEX_Memory *memory_create(APEX_Arena *arena) {
+  APEX_Memory *memory = arena_calloc(arena, 1, sizeof(APEX_Memory));
+
+  if (memory) {
+    memory->arena = arena;
+    memory->last_page_number = -1;
+  }
+  return memory;
+}
+
+/*
+ * Unmaps the images mapped into data memory, everything else goes away with the arena
+ */
+void memory_destroy(APEX_Memory *memory) {
+  for (Memory_Mapping *mapping = memory->mappings; mapping; mapping = mapping->next) {
+    munmap(mapping->base, mapping->size);
+  }
+  memory->mappings = NULL;
+}
+
+/*
+ * Hands out a zeroed page from the pool, a page given back is reused first and a new chunk is taken
+ * from the arena when the current one is used up
+ */
+static int *allocate_page(APEX_Memory *memory) {
+  if (memory->free_pages) {
+    int *page = memory->free_pages;
+
+    memcpy(&memory->free_pages, page, sizeof(int *));
+    memset(page, 0, MEMORY_PAGE_SIZE * sizeof(int));
+    return page;
+  }
+  if (!memory->chunks || memory->chunks->used == PAGES_PER_CHUNK) {
+    Page_Chunk *chunk = arena_calloc(memory->arena, 1, sizeof(Page_Chunk));
+    if (!chunk) {
+      fprintf(stderr, "APEX_Error: Unable to allocate data memory\n");
+      return NULL;
+    }
+    chunk->next = memory->chunks;
+    memory->chunks = chunk;
+  }
+  memory->pages_allocated++;
+  return memory->chunks->pages[memory->chunks->used++];
+}
+
+/* Whether a page lies in an image mapped into data memory rather than in the pool */
+static bool mapped_page(APEX_Memory *memory, const int *page) {
+  for (Memory_Mapping *mapping = memory->mappings; mapping; mapping = mapping->next) {
+    const char *base = mapping->base;
+
+    if ((const char *) page >= base && (const char *) page < base + mapping->size) return true;
+  }
+  return false;
+}
+
+/*
+ * Gives a page that has been replaced at page_number back to the pool, unless the memory or a live
+ * image still refers to it. A page only ever sits at its own page_number, so that is all there is to check.
+ */
+static void release_page(APEX_Memory *memory, int page_number, int *page) {
+  int index = page_number & (MEMORY_TABLE_SIZE - 1);
+  Memory_Table *table = memory->directory[page_number >> MEMORY_TABLE_BITS];
+
+  if (!page || mapped_page(memory, page) || (table && table->pages[index] == page)) {
+    return;
+  }
+  for (Memory_Image *image = memory->images; image; image = image->next) {
+    table = image->directory[page_number >> MEMORY_TABLE_BITS];
+    if (table && table->pages[index] == page) return;
+  }
+
+  memcpy(page, &memory->free_pages, sizeof(int *));
+  memory->free_pages = page;
+  memory->pages_reclaimed++;
+}
+
+/*
+ * Walks the page table, slow path of memory_page()
+ *
+ * Returns NULL for a page that has never been written unless allocate is set. With allocate set, a
+ * page shared with a saved image is replaced by a copy first.
+ */
+int *memory_translate(APEX_Memory *memory, int page_number, bool allocate) {
+  Memory_Table **table = &memory->directory[page_number >> MEMORY_TABLE_BITS];
+  int index = page_number & (MEMORY_TABLE_SIZE - 1);
+  int **page;
+
+  if (!*table) {
+    if (!allocate) return NULL;
+    *table = arena_calloc(memory->arena, 1, sizeof(Memory_Table));
+    if (!*table) return NULL;
+  }
+
+  page = &(*table)->pages[index];
+  if (!*page) {
+    if (!allocate) return NULL;
+    *page = allocate_page(memory);
+    if (!*page) return NULL;
+    (*table)->epoch[index] = memory->epoch;
+  } else if (allocate && (*table)->epoch[index] != memory->epoch) {
+    int *copy = allocate_page(memory);
+    int *shared = *page;
+
+    if (!copy) return NULL;
+    memcpy(copy, shared, MEMORY_PAGE_SIZE * sizeof(int));
+    *page = copy;
+    (*table)->epoch[index] = memory->epoch;
+    release_page(memory, page_number, shared);
+  }
+
+  memory->last_page_number = page_number;
+  memory->last_page = *page;
+  memory->last_page_writable = (*table)->epoch[index] == memory->epoch;
+  return *page;
+}
+
+/*
+ * Table of an image, one of a freed image is reused before the arena is asked for a new one
+ */
+static Memory_Table *allocate_image_table(APEX_Memory *memory) {
+  Memory_Table *table = memory->free_tables;
+
+  if (table) {
+    memory->free_tables = table->next;
+    return table;
+  }
+  return arena_alloc(memory->arena, sizeof(Memory_Table), _Alignof(Memory_Table));
+}
+
+/**
+ * Method to save the contents of data memory. Every page becomes shared with the image, the memory
+ * copies a page the first time it writes it afterwards.
+ *
+ * @param memory - data memory
+ * @param image - filled with copies of the page tables, freed with memory_image_free()
+ * @return false if the tables cannot be allocated
+ */
+bool memory_save(APEX_Memory *memory, Memory_Image *image) {
+  memset(image, 0, sizeof(Memory_Image));
+  image->faults = memory->faults;
+
+  for (int i = 0; i < MEMORY_DIRECTORY_SIZE; i++) {
+    if (!memory->directory[i]) continue;
+
+    image->directory[i] = allocate_image_table(memory);
+    if (!image->directory[i]) {
+      memory_image_free(memory, image);
+      return false;
+    }
+    memcpy(image->directory[i], memory->directory[i], sizeof(Memory_Table));
+  }
+  image->next = memory->images;
+  memory->images = image;
+
+  memory->epoch++;
+  memory->last_page_number = -1;
+  return true;
+}
+
+/**
+ * Method to bring data memory back to a saved image, the pages of the image stay shared
+ *
+ * @param memory - data memory
+ * @param image - saved by memory_save(), it can be restored any number of times
+ * @return false if a table cannot be allocated
+ */
+bool memory_restore(APEX_Memory *memory, const Memory_Image *image) {
+  for (int i = 0; i < MEMORY_DIRECTORY_SIZE; i++) {
+    Memory_Table replaced;
+
+    if (image->directory[i]) {
+      if (!memory->directory[i]) {
+        memory->directory[i] = arena_calloc(memory->arena, 1, sizeof(Memory_Table));
+        if (!memory->directory[i]) return false;
+      }
+      memcpy(&replaced, memory->directory[i], sizeof(Memory_Table));
+      memcpy(memory->directory[i], image->directory[i], sizeof(Memory_Table));
+    } else if (memory->directory[i]) {
+      memcpy(&replaced, memory->directory[i], sizeof(Memory_Table));
+      memset(memory->directory[i], 0, sizeof(Memory_Table));
+    } else {
+      continue;
+    }
+
+    /* Pages written since the image was saved are no longer referred to by the memory */
+    for (int index = 0; index < MEMORY_TABLE_SIZE; index++) {
+      release_page(memory, (i << MEMORY_TABLE_BITS) | index, replaced.pages[index]);
+    }
+  }
+  memory->faults = image->faults;
+
+  memory->epoch++;
+  memory->last_page_number = -1;
+  return true;
+}
+
+/**
+ * Method to free an image, its tables are kept for the next save and its pages that the memory has
+ * replaced since, and no other live image shares, go back to the pool
+ *
+ * @param memory - data memory the image was saved from
+ * @param image - saved by memory_save()
+ */
+void memory_image_free(APEX_Memory *memory, Memory_Image *image) {
+  for (Memory_Image **link = &memory->images; *link; link = &(*link)->next) {
+    if (*link == image) {
+      *link = image->next;
+      break;
+    }
+  }
+
+  for (int i = 0; i < MEMORY_DIRECTORY_SIZE; i++) {
+    Memory_Table *table = image->directory[i];
+
+    if (!table) continue;
+    for (int index = 0; index < MEMORY_TABLE_SIZE; index++) {
+      release_page(memory, (i << MEMORY_TABLE_BITS) | index, table->pages[index]);
+    }
+    table->next = memory->free_tables;
+    memory->free_tables = table;
+    image->directory[i] = NULL;
+  }
+}
+
+/*
+ * Handles an access outside of data memory, reads return 0 and writes are dropped
+ */
+int memory_fault(APEX_Memory *memory, int address) {
+  memory->faults++;
+  fprintf(stderr, "APEX_Error: Data memory address %d is outside of [0, %d)\n", address, DATA_MEMORY_SIZE);
+  return 0;
+}
+
+/*
+ * Returns the address just past the highest page that holds data
+ */
+int memory_extent(APEX_Memory *memory) {
+  for (int page_number = DATA_MEMORY_SIZE / MEMORY_PAGE_SIZE - 1; page_number >= 0; page_number--) {
+    if (!memory->directory[page_number >> MEMORY_TABLE_BITS]) {
+      page_number &= ~(MEMORY_TABLE_SIZE - 1);
+      continue;
+    }
+    if (memory_translate(memory, page_number, false)) {
+      return (page_number + 1) * MEMORY_PAGE_SIZE;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Makes page_number refer to a page of a mapped image, a page that already holds data gets a copy
+ */
+static bool map_page(APEX_Memory *memory, int page_number, int *image_page) {
+  int *page = memory_translate(memory, page_number, false);
+
+  if (page) {
+    page = memory_translate(memory, page_number, true);
+    if (!page) return false;
+    memcpy(page, image_page, MEMORY_PAGE_SIZE * sizeof(int));
+    return true;
+  }
+
+  Memory_Table **table = &memory->directory[page_number >> MEMORY_TABLE_BITS];
+  if (!*table) {
+    *table = arena_calloc(memory->arena, 1, sizeof(Memory_Table));
+    if (!*table) return false;
+  }
+  (*table)->pages[page_number & (MEMORY_TABLE_SIZE - 1)] = image_page;
+  (*table)->epoch[page_number & (MEMORY_TABLE_SIZE - 1)] = memory->epoch;
+  memory->pages_mapped++;
+  return true;
+}
+
+/*
+ * Data memory images ending in ".bin" are raw little endian 32 bit words starting at address 0,
+ * anything else is hex text
+ */
+static bool is_binary_image(const char *filename) {
+  const char *extension = strrchr(filename, '.');
+  return extension && strcmp(extension, ".bin") == 0;
+}
+
+/*
+ * Loads a data memory image in hex text format (same layout as Verilog $readmemh):
+ * one 32 bit hex word per token, stored at consecutive addresses starting at 0,
+ * "@<hex address>" moves the load address, everything after '#' or "//" on a line is ignored.
+ */
+static bool load_hex_image(APEX_Memory *memory, const char *filename) {
+  FILE *fp;
+  size_t len = 0;
+  char *line = NULL;
+  char *token, *end;
+  long address = 0;
+  int line_number = 0;
+  bool ok = true;
+
+  fp = fopen(filename, "r");
+  if (!fp) {
+    fprintf(stderr, "APEX_Error: Unable to open data memory image %s\n", filename);
+    return false;
+  }
+
+  while (ok && getline(&line, &len, fp) != -1) {
+    line_number++;
+    line[strcspn(line, "#")] = '\0';
+    if (strstr(line, "//")) *strstr(line, "//") = '\0';
+
+    for (token = strtok(line, " \t\r\n"); ok && token; token = strtok(NULL, " \t\r\n")) {
+      if (token[0] == '@') {
+        address = strtol(token + 1, &end, 16);
+      } else {
+        if (address < 0 || address >= DATA_MEMORY_SIZE) {
+          fprintf(stderr, "APEX_Error: %s:%d address %ld is outside of data memory\n", filename, line_number,
+                  address);
+          ok = false;
+          break;
+        }
+        memory_write(memory, (int) address++, (int) strtoul(token, &end, 16));
+      }
+
+      if (*end != '\0') {
+        fprintf(stderr, "APEX_Error: %s:%d invalid hex value [ %s ]\n", filename, line_number, token);
+        ok = false;
+      }
+    }
+  }
+
+  free(line);
+  fclose(fp);
+  return ok;
+}
+
+/*
+ * Loads a raw binary image. The file is mapped private (copy-on-write) and its whole pages become data
+ * memory pages in place: the kernel reads them in on first touch, stores only copy the touched pages,
+ * and the file itself is never modified. A trailing partial page is copied.
+ */
+static bool load_binary_image(APEX_Memory *memory, const char *filename) {
+  struct stat info;
+  Memory_Mapping *mapping;
+  int fd, words, full_pages;
+  int *image;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0 || fstat(fd, &info) < 0) {
+    fprintf(stderr, "APEX_Error: Unable to open data memory image %s\n", filename);
+    if (fd >= 0) close(fd);
+    return false;
+  }
+
+  if (info.st_size % sizeof(int) != 0 || info.st_size > (off_t) DATA_MEMORY_SIZE * (off_t) sizeof(int)) {
+    fprintf(stderr, "APEX_Error: %s must hold a whole number of words and at most %d words\n", filename,
+            DATA_MEMORY_SIZE);
+    close(fd);
+    return false;
+  }
+
+  if (info.st_size == 0) {
+    close(fd);
+    return true;
+  }
+
+  mapping = arena_calloc(memory->arena, 1, sizeof(Memory_Mapping));
+  image = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (!mapping || image == MAP_FAILED) {
+    fprintf(stderr, "APEX_Error: Unable to map data memory image %s\n", filename);
+    if (image != MAP_FAILED) munmap(image, info.st_size);
+    return false;
+  }
+  mapping->base = image;
+  mapping->size = info.st_size;
+  mapping->next = memory->mappings;
+  memory->mappings = mapping;
+
+  words = (int) (info.st_size / sizeof(int));
+  full_pages = words / MEMORY_PAGE_SIZE;
+
+  for (int page_number = 0; page_number < full_pages; page_number++) {
+    if (!map_page(memory, page_number, &image[page_number * MEMORY_PAGE_SIZE])) return false;
+  }
+  for (int address = full_pages * MEMORY_PAGE_SIZE; address < words; address++) {
+    memory_write(memory, address, image[address]);
+  }
+
+  /* Pages may have been replaced underneath the last translation */
+  memory->last_page_number = -1;
+  return true;
+}
+
+/*
+ * Loads a data memory image, ".bin" files are raw binary, anything else is hex text
+ *
+ * Returns false if the file cannot be read or writes outside of data memory
+ */
+bool load_data_memory(APEX_Memory *memory, const char *filename) {
+  if (is_binary_image(filename)) {
+    return load_binary_image(memory, filename);
+  }
+  return load_hex_image(memory, filename);
+}
+
+/*
+ * Writes data memory [start, end) to a file, ".bin" files get raw words, anything else gets hex text
+ * that load_data_memory() reads back: 8 words per line, all zero lines are skipped and an
+ * "@<hex address>" line precedes every run of non zero lines.
+ * A negative end stands for the end of the highest page holding data.
+ */
+bool dump_data_memory(APEX_Memory *memory, const char *filename, int start, int end) {
+  FILE *fp;
+  bool ok = true;
+  bool binary = is_binary_image(filename);
+  int next = -1;
+
+  if (end < 0) end = (memory_extent(memory) > start) ? memory_extent(memory) : start;
+  if (start < 0 || end > DATA_MEMORY_SIZE || start > end) {
+    fprintf(stderr, "APEX_Error: Invalid data memory range %d:%d\n", start, end);
+    return false;
+  }
+
+  fp = fopen(filename, binary ? "wb" : "w");
+  if (!fp) {
+    fprintf(stderr, "APEX_Error: Unable to create %s\n", filename);
+    return false;
+  }
+
+  for (int line = start; ok && line < end; line += 8) {
+    int words = (end - line < 8) ? end - line : 8;
+    int values[8];
+    bool empty = true;
+
+    /* A line in a page that was never written is empty, and so are the following ones up to the last
+     * line starting in that page, which is checked on its own as it may reach into the next page */
+    if (!binary && !memory_page(memory, line, false) && !memory_page(memory, line + words - 1, false)) {
+      int page_end = ((line >> MEMORY_PAGE_BITS) + 1) << MEMORY_PAGE_BITS;
+      int lines = (page_end - line - 1) / 8;
+      if (lines > 1) line += (lines - 1) * 8;
+      continue;
+    }
+
+    for (int i = 0; i < words; i++) {
+      values[i] = memory_read(memory, line + i);
+      if (values[i] != 0) empty = false;
+    }
+
+    if (binary) {
+      ok = fwrite(values, sizeof(int), words, fp) == (size_t) words;
+      continue;
+    }
+    if (empty) continue;
+
+    if (line != next) fprintf(fp, "@%x\n", line);
+    for (int i = 0; i < words; i++) {
+      fprintf(fp, "%08x%s", (unsigned int) values[i], (i == words - 1) ? "\n" : " ");
+    }
+    next = line + words;
+  }
+
+  if (fclose(fp) != 0) ok = false;
+  if (!ok) fprintf(stderr, "APEX_Error: Unable to write %s\n", filename);
+  return ok;
+}
+
+/*
+ * Parses "<start>:<end>" (decimal, end exclusive) into a data memory range
+ */
+bool parse_memory_range(const char *range, int *start, int *end) {
+  char *separator;
+
+  *start = (int) strtol(range, &separator, 10);
+  if (*separator != ':') return false;
+  *end = (int) strtol(separator + 1, &separator, 10);
+  return *separator == '\0' && *start >= 0 && *end <= DATA_MEMORY_SIZE && *start <= *end;
+}
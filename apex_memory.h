@@ -0,0 +1,116 @@
+#ifndef _APEX_MEMORY_H_
+#define _APEX_MEMORY_H_
+
+#include "apex_macros.h"
+#include "apex_arena.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Data memory word address = | directory index | table index | page offset | */
+#define MEMORY_PAGE_SIZE (1 << MEMORY_PAGE_BITS)
+#define MEMORY_TABLE_SIZE (1 << MEMORY_TABLE_BITS)
+#define MEMORY_DIRECTORY_SIZE (DATA_MEMORY_SIZE >> (MEMORY_PAGE_BITS + MEMORY_TABLE_BITS))
+
+/* Second level of the page table */
+typedef struct Memory_Table {
+  int *pages[MEMORY_TABLE_SIZE];                /* NULL until the page is first written */
+  unsigned int epoch[MEMORY_TABLE_SIZE];        /* Epoch the page was written in, older pages are shared */
+  struct Memory_Table *next;                    /* Free list of image tables, unused in a live table */
+} Memory_Table;
+
+/*
+ * Pages are carved out of chunks taken from the arena, so a large working set costs few allocations.
+ * A page that neither the memory nor a saved image refers to anymore goes back to a free list and is
+ * handed out again before the chunks grow.
+ */
+typedef struct Page_Chunk {
+  struct Page_Chunk *next;
+  int used;                                     /* Pages handed out from this chunk */
+  int pages[PAGES_PER_CHUNK][MEMORY_PAGE_SIZE];
+} Page_Chunk;
+
+/* Binary image mapped copy-on-write, its pages are used in place */
+typedef struct Memory_Mapping {
+  struct Memory_Mapping *next;
+  void *base;
+  size_t size;
+} Memory_Mapping;
+
+struct Memory_Image;
+
+/* Sparse data memory, only pages that have been written take up space */
+typedef struct APEX_Memory {
+  APEX_Arena *arena;                            /* Tables, pages and mappings are allocated from it */
+  Memory_Table *directory[MEMORY_DIRECTORY_SIZE];
+  int last_page_number;                         /* Last translation, checked before walking the table */
+  int *last_page;
+  Page_Chunk *chunks;                           /* Pool, most recent chunk first */
+  int *free_pages;                              /* Pages given back to the pool, linked through their first words */
+  Memory_Table *free_tables;                    /* Tables of freed images, reused by the next save */
+  struct Memory_Image *images;                  /* Live saved images, their pages are not given back */
+  Memory_Mapping *mappings;
+  int pages_allocated;
+  int pages_mapped;
+  int pages_reclaimed;                          /* Pages given back to the pool */
+  int faults;                                   /* Accesses outside of DATA_MEMORY_SIZE */
+  unsigned int epoch;                           /* Saves so far, a page of an older epoch is copied on write */
+  bool last_page_writable;                      /* last_page is of the current epoch */
+} APEX_Memory;
+
+/*
+ * Saved contents of a data memory. It holds copies of the page tables only, the pages themselves are
+ * shared with the memory until the memory writes them. An image must stay in place until it is freed,
+ * the memory keeps a list of its live images.
+ */
+typedef struct Memory_Image {
+  Memory_Table *directory[MEMORY_DIRECTORY_SIZE];
+  int faults;
+  struct Memory_Image *next;                    /* Next live image of the same memory */
+} Memory_Image;
+
+APEX_Memory *memory_create(APEX_Arena *arena);
+void memory_destroy(APEX_Memory *memory);
+int *memory_translate(APEX_Memory *memory, int page_number, bool allocate);
+int memory_fault(APEX_Memory *memory, int address);
+int memory_extent(APEX_Memory *memory);
+bool memory_save(APEX_Memory *memory, Memory_Image *image);
+bool memory_restore(APEX_Memory *memory, const Memory_Image *image);
+void memory_image_free(APEX_Memory *memory, Memory_Image *image);
+
+bool load_data_memory(APEX_Memory *memory, const char *filename);
+bool dump_data_memory(APEX_Memory *memory, const char *filename, int start, int end);
+bool parse_memory_range(const char *range, int *start, int *end);
+
+/*
+ * Returns the page holding address, a repeated access to the same page skips the table walk.
+ * Unwritten pages read as NULL unless allocate is set, which also makes the page writable.
+ */
+static inline int *memory_page(APEX_Memory *memory, int address, bool allocate) {
+  int page_number = address >> MEMORY_PAGE_BITS;
+
+  if (page_number == memory->last_page_number && (!allocate || memory->last_page_writable)) {
+    return memory->last_page;
+  }
+  return memory_translate(memory, page_number, allocate);
+}
+
+static inline int memory_read(APEX_Memory *memory, int address) {
+  if (address < 0 || address >= DATA_MEMORY_SIZE) {
+    return memory_fault(memory, address);
+  }
+
+  int *page = memory_page(memory, address, false);
+  return page ? page[address & (MEMORY_PAGE_SIZE - 1)] : 0;
+}
+
+static inline void memory_write(APEX_Memory *memory, int address, int value) {
+  if (address < 0 || address >= DATA_MEMORY_SIZE) {
+    memory_fault(memory, address);
+    return;
+  }
+
+  int *page = memory_page(memory, address, true);
+  if (page) page[address & (MEMORY_PAGE_SIZE - 1)] = value;
+}
+
+#endif
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include "apex_prefetch.h"
+
+/*
+ * Next-line: on a miss, or on the first use of a line it brought in, requests the following degree
+ * lines. Over code memory this is the next-N-line instruction prefetcher.
+ */
+static void
+next_line_train(APEX_Prefetcher *prefetcher, void *state, int pc, int address, int access) {
+  int line_address = cache_line_address(address);
+
+  (void) state;
+  (void) pc;
+  if (access == ACCESS_HIT) return;
+  for (int i = 1; i <= prefetcher->degree; i++) {
+    prefetch_line(prefetcher, line_address + i);
+  }
+}
+
+static const Prefetcher_Ops next_line_ops = {"next-line", 0, next_line_train};
+
+/* Stride: reference prediction table indexed by the pc of the load or store */
+typedef struct Stride_Entry {
+  int pc;
+  int last_address;
+  int stride;
+  int confidence;                               /* Saturating, prefetches from STRIDE_CONFIDENT on */
+} Stride_Entry;
+
+typedef struct Stride_State {
+  Stride_Entry table[STRIDE_TABLE_SIZE];
+} Stride_State;
+
+static void
+stride_train(APEX_Prefetcher *prefetcher, void *state, int pc, int address, int access) {
+  Stride_Entry *entry = &((Stride_State *) state)->table[(pc / 4) % STRIDE_TABLE_SIZE];
+  int stride = address - entry->last_address;
+  int last_line = cache_line_address(address);
+
+  (void) access;
+  if (entry->pc != pc) {
+    entry->pc = pc;
+    entry->last_address = address;
+    entry->stride = 0;
+    entry->confidence = 0;
+    return;
+  }
+  entry->last_address = address;
+
+  if (stride == entry->stride) {
+    if (entry->confidence < STRIDE_MAX_CONFIDENCE) entry->confidence++;
+  } else if (entry->confidence > 0) {
+    entry->confidence--;
+  } else {
+    entry->stride = stride;
+  }
+
+  if (entry->confidence < STRIDE_CONFIDENT || entry->stride == 0) return;
+
+  /* Strides shorter than a line would ask for the same line more than once */
+  for (int i = 1; i <= prefetcher->degree; i++) {
+    int line_address = cache_line_address(address + i * entry->stride);
+
+    if (line_address != last_line) prefetch_line(prefetcher, line_address);
+    last_line = line_address;
+  }
+}
+
+static const Prefetcher_Ops stride_ops = {"stride", sizeof(Stride_State), stride_train};
+
+/* Stream: follows up to STREAM_COUNT sequences of misses that move through nearby lines in one direction */
+typedef struct Stream {
+  int valid;
+  int last_line;
+  int direction;                                /* +1 ascending, -1 descending, 0 not known yet */
+  int confidence;
+  int lru;
+} Stream;
+
+typedef struct Stream_State {
+  Stream streams[STREAM_COUNT];
+  int stamp;
+} Stream_State;
+
+static void
+stream_train(APEX_Prefetcher *prefetcher, void *state, int pc, int address, int access) {
+  Stream_State *streams = state;
+  int line_address = cache_line_address(address);
+  Stream *stream = NULL;
+  Stream *victim = &streams->streams[0];
+
+  (void) pc;
+  if (access == ACCESS_HIT) return;
+
+  for (int i = 0; i < STREAM_COUNT; i++) {
+    Stream *s = &streams->streams[i];
+    int distance = line_address - s->last_line;
+
+    if (s->valid && distance != 0 && distance >= -STREAM_WINDOW && distance <= STREAM_WINDOW) {
+      stream = s;
+      break;
+    }
+    if (!s->valid || (victim->valid && s->lru < victim->lru)) victim = s;
+  }
+
+  if (!stream) {
+    victim->valid = TRUE;
+    victim->last_line = line_address;
+    victim->direction = 0;
+    victim->confidence = 0;
+    victim->lru = ++streams->stamp;
+    return;
+  }
+
+  int direction = (line_address > stream->last_line) ? 1 : -1;
+  stream->confidence = (direction == stream->direction) ? stream->confidence + 1 : 1;
+  stream->direction = direction;
+  stream->last_line = line_address;
+  stream->lru = ++streams->stamp;
+
+  if (stream->confidence < STREAM_CONFIDENT) return;
+  for (int i = 1; i <= prefetcher->degree; i++) {
+    prefetch_line(prefetcher, line_address + direction * i);
+  }
+}
+
+static const Prefetcher_Ops stream_ops = {"stream", sizeof(Stream_State), stream_train};
+
+/* Indexed by PREFETCH_* */
+static const Prefetcher_Ops *prefetchers[] = {NULL, &next_line_ops, &stride_ops, &stream_ops};
+
+/**
+ * Method to create a prefetcher in front of a cache
+ *
+ * @param arena - arena the prefetcher and its state are allocated from
+ * @param kind - PREFETCH_* number of the prefetcher
+ * @param degree - lines requested per trigger
+ * @param lines - lines of the address space covered by the cache
+ * @param cache - cache filled by the prefetcher
+ * @param cpu - cpu the cache belongs to, passed on to fill
+ * @param fill - brings a line into the cache
+ * @return NULL for PREFETCH_NONE, an unknown kind or if allocation fails
+ */
+APEX_Prefetcher *
+prefetcher_create(APEX_Arena *arena, int kind, int degree, int lines, APEX_Cache *cache, struct APEX_CPU *cpu,
+                  Prefetch_Fill fill) {
+  APEX_Prefetcher *prefetcher;
+
+  if (kind <= PREFETCH_NONE || kind >= (int) (sizeof(prefetchers) / sizeof(prefetchers[0]))) {
+    return NULL;
+  }
+
+  prefetcher = arena_calloc(arena, 1, sizeof(APEX_Prefetcher));
+  if (!prefetcher) {
+    return NULL;
+  }
+  prefetcher->ops = prefetchers[kind];
+  if (prefetcher->ops->state_size > 0) {
+    prefetcher->state = arena_calloc(arena, 1, prefetcher->ops->state_size);
+    if (!prefetcher->state) {
+      return NULL;
+    }
+  }
+  prefetcher->degree = degree;
+  prefetcher->lines = lines;
+  prefetcher->cache = cache;
+  prefetcher->cpu = cpu;
+  prefetcher->fill = fill;
+  return prefetcher;
+}
+
+/* Largest state of any prefetcher, a copy of the state of any one of them fits in it */
+size_t
+prefetcher_max_state_size(void) {
+  size_t size = 0;
+
+  for (size_t kind = PREFETCH_NONE + 1; kind < sizeof(prefetchers) / sizeof(prefetchers[0]); kind++) {
+    if (prefetchers[kind]->state_size > size) size = prefetchers[kind]->state_size;
+  }
+  return size;
+}
+
+/* Demand access of the cache, pc is that of the instruction that made it */
+void
+prefetch_train(APEX_Prefetcher *prefetcher, int pc, int address, int access) {
+  prefetcher->ops->train(prefetcher, prefetcher->state, pc, address, access);
+}
+
+/* Request of a prefetcher, lines outside of the address space are dropped */
+void
+prefetch_line(APEX_Prefetcher *prefetcher, int line_address) {
+  if (line_address < 0 || line_address >= prefetcher->lines) {
+    return;
+  }
+  prefetcher->requests++;
+  if (prefetcher->fill(prefetcher->cpu, line_address)) {
+    prefetcher->issued++;
+  }
+}
+
+static double
+percent(int part, int whole) {
+  return whole ? 100.0 * part / whole : 0.0;
+}
+
+/**
+ * Method to print the counters of a prefetcher. Accuracy is the share of issued prefetches that were
+ * used, coverage the share of would-be misses they removed and timeliness the share of used ones
+ * that had been filled in time.
+ *
+ * @param prefetcher pointer to the prefetcher
+ * @param name - of the cache it fills
+ */
+void
+print_prefetch_stats(APEX_Prefetcher *prefetcher, const char *name) {
+  APEX_Cache *cache = prefetcher->cache;
+  int useful = cache->prefetch_hits;
+
+  printf("|   %-3s prefetch : %-9s Degree   : %-2d       |\n", name, prefetcher->ops->name,
+         prefetcher->degree);
+  printf("|   Requests     : %-7d Issued   : %-7d    |\n", prefetcher->requests, prefetcher->issued);
+  printf("|   Useful       : %-7d Unused   : %-7d    |\n", useful, cache->prefetch_unused);
+  printf("|   Accuracy     : %5.1f%%  Coverage : %5.1f%%     |\n", percent(useful, prefetcher->issued),
+         percent(useful, useful + cache->misses));
+  printf("|   Timely       : %5.1f%%  Late     : %-7d    |\n", percent(useful - cache->prefetch_late, useful),
+         cache->prefetch_late);
+}
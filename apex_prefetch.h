@@ -0,0 +1,44 @@
+#ifndef _APEX_PREFETCH_H_
+#define _APEX_PREFETCH_H_
+
+#include "apex_cache.h"
+
+struct APEX_CPU;
+typedef struct APEX_Prefetcher APEX_Prefetcher;
+
+/*
+ * A prefetcher is a train function over a private state of state_size bytes, zeroed at creation. It
+ * sees the address and ACCESS_* outcome of every demand access of the cache it sits in front of and
+ * asks for lines with prefetch_line(). A new prefetcher is an instance of Prefetcher_Ops added to
+ * the table of apex_prefetch.c under a PREFETCH_* number.
+ */
+typedef struct Prefetcher_Ops {
+  const char *name;
+  size_t state_size;
+  void (*train)(APEX_Prefetcher *prefetcher, void *state, int pc, int address, int access);
+} Prefetcher_Ops;
+
+/* Fills a line into the cache as prefetched, returns false if the line is already present */
+typedef bool (*Prefetch_Fill)(struct APEX_CPU *cpu, int line_address);
+
+struct APEX_Prefetcher {
+  const Prefetcher_Ops *ops;
+  void *state;
+  int degree;                                   /* Lines requested per trigger */
+  int lines;                                    /* Lines of the address space, requests beyond it are dropped */
+  APEX_Cache *cache;                            /* Cache filled, it counts useful, late and unused prefetches */
+  struct APEX_CPU *cpu;
+  Prefetch_Fill fill;
+
+  int requests;                                 /* Lines asked for */
+  int issued;                                   /* Requests that were not already in the cache */
+};
+
+APEX_Prefetcher *prefetcher_create(APEX_Arena *arena, int kind, int degree, int lines, APEX_Cache *cache,
+                                   struct APEX_CPU *cpu, Prefetch_Fill fill);
+size_t prefetcher_max_state_size(void);
+void prefetch_train(APEX_Prefetcher *prefetcher, int pc, int address, int access);
+void prefetch_line(APEX_Prefetcher *prefetcher, int line_address);
+void print_prefetch_stats(APEX_Prefetcher *prefetcher, const char *name);
+
+#endif
@@ -0,0 +1,251 @@
+#include "apex_replay.h"
+#include "apex_memory.h"
+#include "apex_hierarchy.h"
+#include "apex_prefetch.h"
+#include <stdarg.h>
+
+#define REPLAY_VERSION 1
+#define REPLAY_LINE_SIZE 256
+
+#define HASH_SEED 0xcbf29ce484222325ULL
+#define HASH_PRIME 0x100000001b3ULL
+
+/* 64 bit FNV-1a over the bytes of 32 bit words, independent of host byte order */
+static unsigned long long
+hash_words(unsigned long long hash, const int *words, int count) {
+  for (int i = 0; i < count; i++) {
+    unsigned int word = (unsigned int) words[i];
+
+    for (int byte = 0; byte < 4; byte++) {
+      hash ^= (word >> (8 * byte)) & 0xff;
+      hash *= HASH_PRIME;
+    }
+  }
+  return hash;
+}
+
+static unsigned long long
+program_hash(APEX_CPU *cpu) {
+  unsigned long long hash = HASH_SEED;
+
+  for (int i = 0; i < cpu->code_memory_size; i++) {
+    const APEX_Instruction *ins = &cpu->code_memory[i];
+    int fields[] = {ins->opcode, ins->rd, ins->rs1, ins->rs2, ins->rs3, ins->imm};
+
+    hash = hash_words(hash, fields, 6);
+  }
+  return hash;
+}
+
+/* Pages holding only zeros are skipped, so the hash does not depend on which pages were allocated */
+unsigned long long
+memory_hash(APEX_Memory *memory) {
+  unsigned long long hash = HASH_SEED;
+
+  for (int d = 0; d < MEMORY_DIRECTORY_SIZE; d++) {
+    if (!memory->directory[d]) continue;
+
+    for (int t = 0; t < MEMORY_TABLE_SIZE; t++) {
+      const int *page = memory->directory[d]->pages[t];
+      int page_number = d * MEMORY_TABLE_SIZE + t;
+      int i = 0;
+
+      if (!page) continue;
+      while (i < MEMORY_PAGE_SIZE && page[i] == 0) i++;
+      if (i == MEMORY_PAGE_SIZE) continue;
+
+      hash = hash_words(hash, &page_number, 1);
+      hash = hash_words(hash, page, MEMORY_PAGE_SIZE);
+    }
+  }
+  return hash;
+}
+
+/*
+ * Hash of the state that timing differences show up in: physical registers, both rename tables,
+ * ROB head and tail, clock, retired instructions, pc and architectural zero flag
+ */
+unsigned long long
+cpu_state_hash(APEX_CPU *cpu) {
+  int scalars[] = {cpu->reorder_buffer.head, cpu->reorder_buffer.tail, cpu->clock, cpu->insn_completed,
+                   cpu->pc, cpu->flags[cpu->flag_r_rat]};
+  unsigned long long hash = HASH_SEED;
+
+  hash = hash_words(hash, cpu->regs, REG_FILE_SIZE);
+  hash = hash_words(hash, cpu->rat, RENAME_TABLE_SIZE);
+  hash = hash_words(hash, cpu->r_rat, RENAME_TABLE_SIZE);
+  return hash_words(hash, scalars, 6);
+}
+
+/*
+ * Writes a line of the log, or when replaying compares it with the next line of the log and
+ * reports the first one that differs
+ */
+static void
+replay_line(APEX_CPU *cpu, const char *line) {
+  APEX_Replay *replay = cpu->replay;
+  char expected[REPLAY_LINE_SIZE];
+
+  if (!replay->replaying) {
+    fprintf(replay->log, "%s\n", line);
+    return;
+  }
+  if (replay->diverged) {
+    return;
+  }
+
+  if (fgets(expected, sizeof(expected), replay->log)) {
+    expected[strcspn(expected, "\n")] = '\0';
+  } else {
+    strcpy(expected, "<end of log>");
+  }
+  if (strcmp(expected, line) == 0) {
+    return;
+  }
+
+  replay->diverged = TRUE;
+  if (strncmp(line, "state", 5) == 0 && strncmp(expected, "state", 5) == 0) {
+    fprintf(stderr, "APEX_Replay: First divergence in cycles (%d, %d] of %s\n", replay->last_checkpoint,
+            cpu->clock, replay->filename);
+  } else {
+    fprintf(stderr, "APEX_Replay: First divergence at cycle %d of %s\n", cpu->clock, replay->filename);
+  }
+  fprintf(stderr, "APEX_Replay:   run: %s\nAPEX_Replay:   log: %s\n", line, expected);
+}
+
+/**
+ * Method to start recording a run to a log, or replaying a run against one
+ *
+ * @param cpu pointer to current instance of cpu, with its settings and data memory in place
+ * @param filename - log
+ * @param replaying - compare with the log instead of writing it
+ * @param interval - cycles between state hashes when recording, replay takes it from the log
+ * @return false if the log cannot be opened or is not a replay log
+ */
+bool
+replay_open(APEX_CPU *cpu, const char *filename, bool replaying, int interval) {
+  APEX_Replay *replay;
+  char line[REPLAY_LINE_SIZE];
+  int version;
+
+  if (cpu->replay) {
+    fprintf(stderr, "APEX_Error: A replay log is already open\n");
+    return false;
+  }
+
+  replay = calloc(1, sizeof(APEX_Replay));
+  if (!replay) {
+    return false;
+  }
+  replay->log = fopen(filename, replaying ? "r" : "w");
+  replay->filename = strdup(filename);
+  if (!replay->log || !replay->filename) {
+    fprintf(stderr, "APEX_Error: Unable to open replay log %s\n", filename);
+    if (replay->log) fclose(replay->log);
+    free(replay->filename);
+    free(replay);
+    return false;
+  }
+
+  if (replaying) {
+    if (!fgets(line, sizeof(line), replay->log) ||
+        sscanf(line, "apex-replay %d %d", &version, &interval) != 2 || version != REPLAY_VERSION) {
+      fprintf(stderr, "APEX_Error: %s is not a replay log\n", filename);
+      fclose(replay->log);
+      free(replay->filename);
+      free(replay);
+      return false;
+    }
+  } else {
+    fprintf(replay->log, "apex-replay %d %d\n", REPLAY_VERSION, interval);
+  }
+
+  replay->replaying = replaying;
+  replay->interval = (interval > 0) ? interval : REPLAY_INTERVAL;
+  replay->last_checkpoint = cpu->clock;
+  replay->next_checkpoint = (cpu->clock / replay->interval + 1) * replay->interval;
+  cpu->replay = replay;
+
+  /* Everything the run depends on, event mode is left out since it must not change timing */
+  snprintf(line, sizeof(line), "config commit_width=%d issue_policy=%d issue_seed=%u load_speculation=%d eliminate=%d "
+           "fusion=%d jit=%d caches=%d "
+           "dram_banks=%d dram_queue=%d prefetcher=%s prefetch_degree=%d iprefetch=%d",
+           cpu->commit_width, cpu->issue_policy, cpu->issue_seed, cpu->load_speculation, cpu->eliminate, cpu->fusion, cpu->use_jit, cpu->caches,
+           cpu->hierarchy->dram.banks, cpu->hierarchy->dram.queue_depth,
+           cpu->data_prefetcher ? cpu->data_prefetcher->ops->name : "none", cpu->prefetch_degree,
+           cpu->inst_prefetcher ? cpu->inst_prefetcher->degree : 0);
+  replay_line(cpu, line);
+  snprintf(line, sizeof(line), "program %d %016llx", cpu->code_memory_size, program_hash(cpu));
+  replay_line(cpu, line);
+  snprintf(line, sizeof(line), "memory %016llx", memory_hash(cpu->data_memory));
+  replay_line(cpu, line);
+  snprintf(line, sizeof(line), "start %d %d %016llx", cpu->clock, cpu->insn_completed, cpu_state_hash(cpu));
+  replay_line(cpu, line);
+  return true;
+}
+
+/*
+ * Records or checks the state hash once the clock has reached the next checkpoint
+ */
+void
+replay_checkpoint(APEX_CPU *cpu) {
+  APEX_Replay *replay = cpu->replay;
+  char line[REPLAY_LINE_SIZE];
+
+  snprintf(line, sizeof(line), "state %d %d %016llx", cpu->clock, cpu->insn_completed, cpu_state_hash(cpu));
+  replay_line(cpu, line);
+
+  if (!replay->diverged) replay->last_checkpoint = cpu->clock;
+  replay->checkpoints++;
+  replay->next_checkpoint = (cpu->clock / replay->interval + 1) * replay->interval;
+}
+
+/*
+ * Records an input the host gave the cpu after the log was opened, e.g. a setting or a memory write
+ */
+void
+replay_input(APEX_CPU *cpu, const char *format, ...) {
+  char input[REPLAY_LINE_SIZE - 32];
+  char line[REPLAY_LINE_SIZE];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(input, sizeof(input), format, args);
+  va_end(args);
+
+  snprintf(line, sizeof(line), "input %d %s", cpu->clock, input);
+  replay_line(cpu, line);
+}
+
+/**
+ * Method to end recording or replaying, with a final state hash
+ *
+ * @param cpu pointer to current instance of cpu
+ * @return false if the replayed run diverged from the log
+ */
+bool
+replay_close(APEX_CPU *cpu) {
+  APEX_Replay *replay = cpu->replay;
+  char line[REPLAY_LINE_SIZE];
+  bool matched;
+
+  if (!replay) {
+    return true;
+  }
+
+  snprintf(line, sizeof(line), "end %d %d %016llx %016llx", cpu->clock, cpu->insn_completed, cpu_state_hash(cpu),
+           memory_hash(cpu->data_memory));
+  replay_line(cpu, line);
+
+  matched = !replay->diverged;
+  if (replay->replaying && matched) {
+    fprintf(stderr, "APEX_Replay: %d state hashes and the final state match %s\n", replay->checkpoints,
+            replay->filename);
+  }
+
+  fclose(replay->log);
+  free(replay->filename);
+  free(replay);
+  cpu->replay = NULL;
+  return matched;
+}
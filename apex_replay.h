@@ -0,0 +1,31 @@
+#ifndef _APEX_REPLAY_H_
+#define _APEX_REPLAY_H_
+
+#include "apex_cpu.h"
+
+/*
+ * Record and replay of a run. Recording writes one line per input the run depends on (settings,
+ * program, initial data memory, anything the host changes later) and a hash of the cpu state every
+ * interval cycles. Replaying produces the same lines from the new run and compares them with the log,
+ * the first line that differs is reported, for a state hash as the interval it diverged in.
+ */
+
+typedef struct APEX_Replay {
+  FILE *log;
+  char *filename;
+  int replaying;                                /* Compare with the log instead of writing it */
+  int interval;                                 /* Cycles between state hashes */
+  int next_checkpoint;                          /* Clock of the next state hash */
+  int last_checkpoint;                          /* Clock of the last state hash that matched */
+  int diverged;                                 /* First divergence has been reported, stop comparing */
+  int checkpoints;                              /* State hashes written or matched */
+} APEX_Replay;
+
+bool replay_open(APEX_CPU *cpu, const char *filename, bool replaying, int interval);
+void replay_checkpoint(APEX_CPU *cpu);
+void replay_input(APEX_CPU *cpu, const char *format, ...);
+bool replay_close(APEX_CPU *cpu);
+unsigned long long cpu_state_hash(APEX_CPU *cpu);
+unsigned long long memory_hash(struct APEX_Memory *memory);
+
+#endif
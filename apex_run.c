@@ -0,0 +1,160 @@
+#include "apex_lib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Thin command line front end of libapexsim, uses nothing but the library interface. Runs a program
+ * non-interactively and prints the result as <name>=<value> lines.
+ */
+
+#define DEFAULT_RUN_CYCLES 1000000
+
+static const char *stop_reason[] = {"condition", "halted", "max-cycles", "error"};
+
+static void usage() {
+  fprintf(stderr, "usage: apex_run [--set <name>=<value>]... [--mem-in <image>] [--mem-out <file>]\n"
+                  "                [--record <log> [--interval <cycles>] | --replay <log>]\n"
+                  "                [--ff <count>] [--until <condition>]... [--max-cycles <n>]\n"
+                  "                [--expect-zero-allocations] <input_file>\n"
+                  "conditions: pc=<pc> instret=<n> cycle=<n> write=<address> reg=<r>:<value> halt\n");
+}
+
+/* Adds a condition of --until, returns false if it cannot be parsed */
+static bool parse_until(const char *arg, APEX_Sim_Until *until) {
+  if (sscanf(arg, "pc=%d", &until->pc) == 1) {
+    until->conditions |= APEX_UNTIL_PC;
+  } else if (sscanf(arg, "instret=%ld", &until->instret) == 1) {
+    until->conditions |= APEX_UNTIL_INSTRET;
+  } else if (sscanf(arg, "cycle=%ld", &until->cycle) == 1) {
+    until->conditions |= APEX_UNTIL_CYCLE;
+  } else if (sscanf(arg, "write=%d", &until->address) == 1) {
+    until->conditions |= APEX_UNTIL_MEMORY_WRITE;
+  } else if (sscanf(arg, "reg=%d:%d", &until->reg, &until->value) == 2 ||
+             sscanf(arg, "reg=R%d:%d", &until->reg, &until->value) == 2) {
+    until->conditions |= APEX_UNTIL_REGISTER;
+  } else if (strcmp(arg, "halt") == 0) {
+    until->conditions |= APEX_UNTIL_HALT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char const *argv[]) {
+  const char *settings[argc];
+  int num_settings = 0;
+  const char *mem_in = NULL;
+  const char *mem_out = NULL;
+  const char *filename = NULL;
+  const char *record = NULL;
+  const char *replay = NULL;
+  int interval = 0;
+  bool matched = true;
+  long fast_forward = 0;
+  long max_cycles = DEFAULT_RUN_CYCLES;
+  APEX_Sim_Until until = {0};
+  bool expect_zero_allocations = false;
+  bool valid = true;
+  APEX_Sim *sim;
+  APEX_Sim_Stats stats;
+  int reason;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--set") == 0 && i + 1 < argc) {
+      settings[num_settings++] = argv[++i];
+    } else if (strcmp(argv[i], "--mem-in") == 0 && i + 1 < argc) {
+      mem_in = argv[++i];
+    } else if (strcmp(argv[i], "--mem-out") == 0 && i + 1 < argc) {
+      mem_out = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      replay = argv[++i];
+    } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+      interval = atoi(argv[++i]);
+      valid = interval > 0 && valid;
+    } else if (strcmp(argv[i], "--ff") == 0 && i + 1 < argc) {
+      fast_forward = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--until") == 0 && i + 1 < argc) {
+      valid = parse_until(argv[++i], &until) && valid;
+    } else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc) {
+      max_cycles = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--expect-zero-allocations") == 0) {
+      expect_zero_allocations = true;
+    } else if (argv[i][0] != '-' && !filename) {
+      filename = argv[i];
+    } else {
+      valid = false;
+    }
+  }
+
+  if (!filename || !valid || max_cycles <= 0 || (record && replay)) {
+    usage();
+    return 2;
+  }
+
+  sim = APEX_sim_create(filename);
+  if (!sim) {
+    return 2;
+  }
+
+  for (int i = 0; i < num_settings; i++) {
+    char name[64];
+    int setting;
+
+    if (sscanf(settings[i], "%63[^=]=%d", name, &setting) != 2 || !APEX_sim_set(sim, name, setting)) {
+      APEX_sim_destroy(sim);
+      return 2;
+    }
+  }
+  if (mem_in && !APEX_sim_load_memory(sim, mem_in)) {
+    APEX_sim_destroy(sim);
+    return 2;
+  }
+
+  if ((record && !APEX_sim_record(sim, record, interval)) || (replay && !APEX_sim_replay(sim, replay))) {
+    APEX_sim_destroy(sim);
+    return 2;
+  }
+
+  APEX_sim_fast_forward(sim, fast_forward);
+
+  /* Without --until the run ends at HALT or max_cycles */
+  reason = APEX_sim_run(sim, &until, max_cycles);
+
+  matched = APEX_sim_close_log(sim);
+
+  APEX_sim_get_stats(sim, &stats);
+  printf("stop=%s\n", stop_reason[reason]);
+  printf("stop_conditions=0x%x\n", APEX_sim_stop_conditions(sim));
+  printf("pc=%d\n", APEX_sim_get_pc(sim));
+  printf("cycles=%ld\n", stats.cycles);
+  printf("insn_retired=%ld\n", stats.insn_retired);
+  printf("insn_fast_forwarded=%ld\n", stats.insn_fast_forwarded);
+  printf("branch_mispredictions=%ld\n", stats.branch_mispredictions);
+  printf("insn_squashed=%ld\n", stats.insn_squashed);
+  printf("loads_speculated=%ld\n", stats.loads_speculated);
+  printf("memory_violations=%ld\n", stats.memory_violations);
+  printf("false_dependences=%ld\n", stats.false_dependences);
+  printf("ops_eliminated=%ld\n", stats.ops_eliminated);
+  printf("ops_fused=%ld\n", stats.ops_fused);
+  printf("run_allocations=%ld\n", stats.run_allocations);
+  printf("halted=%d\n", stats.halted);
+  if (replay) printf("replay=%s\n", matched ? "match" : "diverged");
+  for (int i = 0; i < APEX_sim_num_registers(); i++) {
+    printf("R%d=%d\n", i, APEX_sim_get_register(sim, i));
+  }
+
+  if (mem_out) {
+    APEX_sim_dump_memory(sim, mem_out, 0, -1);
+  }
+  APEX_sim_destroy(sim);
+
+  /* A steady state run must not go to the heap */
+  if (expect_zero_allocations && stats.run_allocations != 0) {
+    fprintf(stderr, "APEX_Error: %ld heap allocations inside the run, expected none\n", stats.run_allocations);
+    return 1;
+  }
+  return ((reason == APEX_STOP_CONDITION || reason == APEX_STOP_HALTED) && matched) ? 0 : 1;
+}
@@ -0,0 +1,421 @@
+#include "apex_snapshot.h"
+
+/* Gives a snapshot back to the pool and frees its memory image, NULL is ignored */
+static void
+snapshot_free(APEX_Snapshots *snapshots, Snapshot *snapshot) {
+  if (!snapshot) {
+    return;
+  }
+  memory_image_free(snapshot->cpu.data_memory, &snapshot->memory);
+  snapshots->unused[snapshots->unused_count++] = snapshot;
+}
+
+/* Copies everything a snapshot holds besides the cpu itself into its slot, false if the image fails */
+static bool
+snapshot_copy(APEX_CPU *cpu, Snapshot *snapshot) {
+  APEX_Prefetcher *prefetchers[2] = {cpu->data_prefetcher, cpu->inst_prefetcher};
+
+  snapshot->hierarchy = *cpu->hierarchy;
+  for (int i = 0; i < LEVEL_COUNT; i++) {
+    const APEX_Cache *cache = &cpu->hierarchy->level[i].cache;
+
+    if (!snapshot->lines[i]) continue;
+    memcpy(snapshot->lines[i], cache->lines, (size_t) cache->sets * cache->ways * sizeof(Cache_Line));
+  }
+
+  for (int i = 0; i < 2; i++) {
+    if (!prefetchers[i]) continue;
+
+    snapshot->prefetcher[i] = *prefetchers[i];
+    if (prefetchers[i]->state) {
+      memcpy(snapshot->prefetch_state[i], prefetchers[i]->state, prefetchers[i]->ops->state_size);
+    }
+  }
+  return memory_save(cpu->data_memory, &snapshot->memory);
+}
+
+/* Takes a snapshot of the cpu as it is now into an unused slot, NULL if there is none left */
+static Snapshot *
+snapshot_take(APEX_CPU *cpu) {
+  APEX_Snapshots *snapshots = cpu->snapshots;
+  Snapshot *snapshot;
+
+  if (snapshots->unused_count == 0) {
+    return NULL;
+  }
+  snapshot = snapshots->unused[--snapshots->unused_count];
+  snapshot->cpu = *cpu;
+  if (!snapshot_copy(cpu, snapshot)) {
+    snapshots->unused[snapshots->unused_count++] = snapshot;
+    return NULL;
+  }
+  return snapshot;
+}
+
+/*
+ * Carves the slots out of the pool, each one followed by the copies of the cache lines of the
+ * hierarchy and of the prefetcher states. False if the pool cannot be allocated.
+ */
+static bool
+allocate_pool(APEX_CPU *cpu, APEX_Snapshots *snapshots) {
+  size_t state_size = prefetcher_max_state_size();
+  size_t lines_size[LEVEL_COUNT];
+  size_t size = sizeof(Snapshot);
+
+  for (int i = 0; i < LEVEL_COUNT; i++) {
+    const APEX_Cache *cache = &cpu->hierarchy->level[i].cache;
+
+    lines_size[i] = cache->lines ? (size_t) cache->sets * cache->ways * sizeof(Cache_Line) : 0;
+    size += lines_size[i];
+  }
+  size += 2 * state_size;
+  snapshots->slot_size = (size + HOST_CACHE_LINE - 1) & ~(size_t) (HOST_CACHE_LINE - 1);
+
+  snapshots->pool = aligned_alloc(HOST_CACHE_LINE, SNAPSHOT_POOL * snapshots->slot_size);
+  if (!snapshots->pool) {
+    return false;
+  }
+  memset(snapshots->pool, 0, SNAPSHOT_POOL * snapshots->slot_size);
+
+  for (int slot = 0; slot < SNAPSHOT_POOL; slot++) {
+    Snapshot *snapshot = (Snapshot *) ((char *) snapshots->pool + slot * snapshots->slot_size);
+    char *copies = (char *) (snapshot + 1);
+
+    for (int i = 0; i < LEVEL_COUNT; i++) {
+      snapshot->lines[i] = lines_size[i] ? (Cache_Line *) copies : NULL;
+      copies += lines_size[i];
+    }
+    for (int i = 0; i < 2; i++) {
+      snapshot->prefetch_state[i] = copies;
+      copies += state_size;
+    }
+    snapshots->unused[snapshots->unused_count++] = snapshot;
+  }
+  return true;
+}
+
+/*
+ * Brings the cpu back to a snapshot. What the host owns, the breakpoints, replay log, translated code
+ * and the snapshots themselves, is kept as it is now.
+ */
+static void
+snapshot_load(APEX_CPU *cpu, const Snapshot *snapshot) {
+  APEX_Prefetcher *prefetchers[2];
+  Stop_Condition stop = cpu->stop;
+  struct APEX_Replay *replay = cpu->replay;
+  struct APEX_Jit *jit = cpu->jit;
+  struct Func_Insn *threaded_code = cpu->threaded_code;
+  APEX_Snapshots *snapshots = cpu->snapshots;
+  int run_allocations = cpu->run_allocations;
+  int single_step = cpu->single_step;
+  int debug_messages = cpu->debug_messages;
+  int event_driven = cpu->event_driven;
+
+  *cpu = snapshot->cpu;
+  cpu->stop = stop;
+  cpu->replay = replay;
+  cpu->jit = jit;
+  cpu->threaded_code = threaded_code;
+  cpu->snapshots = snapshots;
+  cpu->run_allocations = run_allocations;
+  cpu->single_step = single_step;
+  cpu->debug_messages = debug_messages;
+  cpu->event_driven = event_driven;
+
+  /* Settings reset the snapshots, so the hierarchy and prefetchers are still the ones saved */
+  *cpu->hierarchy = snapshot->hierarchy;
+  for (int i = 0; i < LEVEL_COUNT; i++) {
+    const APEX_Cache *cache = &cpu->hierarchy->level[i].cache;
+
+    if (!snapshot->lines[i]) continue;
+    memcpy(cache->lines, snapshot->lines[i], (size_t) cache->sets * cache->ways * sizeof(Cache_Line));
+  }
+
+  prefetchers[0] = cpu->data_prefetcher;
+  prefetchers[1] = cpu->inst_prefetcher;
+  for (int i = 0; i < 2; i++) {
+    if (!prefetchers[i]) continue;
+
+    *prefetchers[i] = snapshot->prefetcher[i];
+    if (prefetchers[i]->state) {
+      memcpy(prefetchers[i]->state, snapshot->prefetch_state[i], prefetchers[i]->ops->state_size);
+    }
+  }
+
+  if (!memory_restore(cpu->data_memory, &snapshot->memory)) {
+    fprintf(stderr, "APEX_Error: Unable to restore data memory of cycle %d\n", cpu->clock);
+  }
+}
+
+/* Frees the snapshots taken after the given cycle, they belong to a future that is being rewritten */
+static void
+drop_newer(APEX_Snapshots *snapshots, int clock) {
+  while (snapshots->count > 0 && snapshots->slots[snapshots->count - 1]->cpu.clock > clock) {
+    snapshot_free(snapshots, snapshots->slots[--snapshots->count]);
+  }
+}
+
+/* Takes up periodic snapshots again after time travel has landed */
+static void
+resume(APEX_CPU *cpu) {
+  APEX_Snapshots *snapshots = cpu->snapshots;
+
+  drop_newer(snapshots, cpu->clock);
+  if (snapshots->count == 0) {
+    snapshot_periodic(cpu);
+    return;
+  }
+  snapshots->next_cycle = snapshots->slots[snapshots->count - 1]->cpu.clock + snapshots->interval;
+}
+
+/**
+ * Method to take the periodic snapshot, called by APEX_cpu_run() at the start of a cycle once the
+ * clock reaches next_cycle
+ *
+ * @param cpu pointer to current instance of cpu
+ */
+void
+snapshot_periodic(APEX_CPU *cpu) {
+  APEX_Snapshots *snapshots = cpu->snapshots;
+  Snapshot *snapshot;
+
+  drop_newer(snapshots, cpu->clock - 1);
+  if (snapshots->count == SNAPSHOT_COUNT) {
+    int kept = 0;
+
+    for (int i = 0; i < snapshots->count; i++) {
+      if (i % 2) {
+        snapshot_free(snapshots, snapshots->slots[i]);
+      } else {
+        snapshots->slots[kept++] = snapshots->slots[i];
+      }
+    }
+    snapshots->count = kept;
+    snapshots->interval *= 2;
+  }
+
+  snapshot = snapshot_take(cpu);
+  if (snapshot) {
+    snapshots->slots[snapshots->count++] = snapshot;
+  } else {
+    fprintf(stderr, "APEX_Error: Unable to allocate the snapshot of cycle %d\n", cpu->clock);
+  }
+  snapshots->next_cycle = cpu->clock + snapshots->interval;
+}
+
+/**
+ * Method to turn snapshots on or off, the first snapshot is of the current cycle
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param interval - cycles between snapshots, 0 to turn them off
+ * @return false if the interval is negative or the cpu is a core of a system
+ */
+bool
+snapshots_enable(APEX_CPU *cpu, int interval) {
+  if (interval < 0) {
+    return false;
+  }
+  snapshots_destroy(cpu);
+  if (interval == 0) {
+    return true;
+  }
+  if (cpu->system) {
+    fprintf(stderr, "APEX_Error: Snapshots are only available with one core\n");
+    return false;
+  }
+
+  cpu->snapshots = calloc(1, sizeof(APEX_Snapshots));
+  if (!cpu->snapshots) {
+    return false;
+  }
+  if (!allocate_pool(cpu, cpu->snapshots)) {
+    fprintf(stderr, "APEX_Error: Unable to allocate %d snapshots\n", SNAPSHOT_POOL);
+    snapshots_destroy(cpu);
+    return false;
+  }
+  cpu->snapshots->base_interval = interval;
+  snapshots_reset(cpu);
+  return true;
+}
+
+/**
+ * Method to forget every snapshot and start over from the current cycle. Called whenever the host
+ * changes the cpu, since going back across the change would simulate something else.
+ *
+ * @param cpu pointer to current instance of cpu, with snapshots on
+ */
+void
+snapshots_reset(APEX_CPU *cpu) {
+  APEX_Snapshots *snapshots = cpu->snapshots;
+
+  drop_newer(snapshots, INT_MIN);
+  snapshots->interval = snapshots->base_interval;
+  snapshot_periodic(cpu);
+}
+
+/*
+ * Frees all snapshots, NULL snapshots are ignored
+ */
+void
+snapshots_destroy(APEX_CPU *cpu) {
+  if (!cpu->snapshots) {
+    return;
+  }
+  drop_newer(cpu->snapshots, INT_MIN);
+  free(cpu->snapshots->pool);
+  free(cpu->snapshots);
+  cpu->snapshots = NULL;
+}
+
+/* Checks that time travel is possible, with an error message if it is not */
+static bool
+can_travel(APEX_CPU *cpu) {
+  if (!cpu->snapshots || cpu->snapshots->count == 0) {
+    fprintf(stderr, "APEX_Error: Snapshots are off, turn them on with set snapshots <interval>\n");
+    return false;
+  }
+  if (cpu->replay) {
+    fprintf(stderr, "APEX_Error: Time travel is not available while a replay log is open\n");
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Simulates up to the given number of cycles with the condition as the only breakpoint, NULL for
+ * none, and periodic snapshots held back. Returns the STOP_* bits that hit.
+ */
+static int
+run_with(APEX_CPU *cpu, int cycles, const Stop_Condition *condition) {
+  Stop_Condition stop = cpu->stop;
+  int single_step = cpu->single_step;
+  int debug_messages = cpu->debug_messages;
+  int hit;
+
+  if (condition) {
+    cpu->stop = *condition;
+  }
+  cpu->stop.armed = condition ? condition->armed : 0;
+  if (cycles > 0) {
+    APEX_cpu_run(cpu, cycles, false);
+  }
+  hit = cpu->stop.hit;
+
+  cpu->stop = stop;
+  cpu->stop.hit = 0;
+  cpu->single_step = single_step;
+  cpu->debug_messages = debug_messages;
+  return hit;
+}
+
+/**
+ * Method to bring the cpu to the start of a cycle, back from the nearest older snapshot or forward
+ * by simulating. Breakpoints are not checked on the way.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param cycle - clock to stop at
+ * @return false if there is no snapshot to go back from
+ */
+bool
+time_travel_goto(APEX_CPU *cpu, int cycle) {
+  APEX_Snapshots *snapshots = cpu->snapshots;
+  int slot;
+
+  if (!can_travel(cpu)) {
+    return false;
+  }
+  if (cycle < 0) {
+    fprintf(stderr, "APEX_Error: Cycle %d is before the start of the run\n", cycle);
+    return false;
+  }
+
+  if (cycle < cpu->clock) {
+    for (slot = snapshots->count - 1; slot >= 0 && snapshots->slots[slot]->cpu.clock > cycle; slot--) {}
+    if (slot < 0) {
+      fprintf(stderr, "APEX_Error: The oldest snapshot is of cycle %d\n", snapshots->slots[0]->cpu.clock);
+      return false;
+    }
+    snapshot_load(cpu, snapshots->slots[slot]);
+    snapshots->next_cycle = INT_MAX;
+  }
+  run_with(cpu, cycle - cpu->clock, NULL);
+  resume(cpu);
+  return true;
+}
+
+/*
+ * Last cycle in [start, end) in which the condition hits, -1 if it never does. Every hit ends a run
+ * part way through the cycle, so the search goes on from a scratch snapshot of the run with no
+ * breakpoint at the end of that cycle.
+ */
+static int
+last_hit(APEX_CPU *cpu, const Snapshot *start, const Stop_Condition *condition, int end) {
+  const Snapshot *from = start;
+  Snapshot *scratch = NULL;
+  int hit = -1;
+
+  snapshot_load(cpu, from);
+  while (cpu->clock < end && run_with(cpu, end - cpu->clock, condition)) {
+    hit = cpu->clock - 1;
+    snapshot_load(cpu, from);
+    run_with(cpu, hit + 1 - cpu->clock, NULL);
+    snapshot_free(cpu->snapshots, scratch);
+    scratch = snapshot_take(cpu);
+    if (!scratch) break;
+    from = scratch;
+  }
+  snapshot_free(cpu->snapshots, scratch);
+  return hit;
+}
+
+/**
+ * Method to go back to the latest cycle, before the one last simulated, in which a breakpoint
+ * condition hits. The cpu is left as a forward run stopped by that breakpoint would leave it.
+ *
+ * @param cpu pointer to current instance of cpu
+ * @param condition - STOP_AT_PC, STOP_ON_WRITE, STOP_ON_REGISTER or STOP_ON_HALT predicates
+ * @return clock of the cycle the condition hit in, -1 if it did not hit since the oldest snapshot
+ */
+int
+time_travel_reverse_until(APEX_CPU *cpu, const Stop_Condition *condition) {
+  APEX_Snapshots *snapshots = cpu->snapshots;
+  Snapshot *home;
+  int end = cpu->clock - 1;
+  int hit = -1;
+  int slot;
+
+  if (!can_travel(cpu)) {
+    return -1;
+  }
+  if (condition->armed & ~(STOP_AT_PC | STOP_ON_WRITE | STOP_ON_REGISTER | STOP_ON_HALT)) {
+    fprintf(stderr, "APEX_Error: Only pc, write, reg and halt conditions can be searched backwards\n");
+    return -1;
+  }
+  home = snapshot_take(cpu);
+  if (!home) {
+    fprintf(stderr, "APEX_Error: Unable to allocate the snapshot of cycle %d\n", cpu->clock);
+    return -1;
+  }
+  snapshots->next_cycle = INT_MAX;
+
+  /* Newest segment first, the first segment with a hit holds the latest one */
+  for (slot = snapshots->count - 1; slot >= 0; slot--) {
+    const Snapshot *start = snapshots->slots[slot];
+
+    if (start->cpu.clock >= end) continue;
+    hit = last_hit(cpu, start, condition, end);
+    if (hit >= 0) break;
+    end = start->cpu.clock;
+  }
+
+  if (hit >= 0) {
+    snapshot_load(cpu, snapshots->slots[slot]);
+    run_with(cpu, hit - cpu->clock, NULL);
+    cpu->stop.hit = run_with(cpu, 1, condition);
+  } else {
+    snapshot_load(cpu, home);
+  }
+  snapshot_free(snapshots, home);
+  resume(cpu);
+  return hit;
+}
@@ -0,0 +1,50 @@
+#ifndef _APEX_SNAPSHOT_H_
+#define _APEX_SNAPSHOT_H_
+
+#include "apex_cpu.h"
+#include "apex_memory.h"
+#include "apex_hierarchy.h"
+#include "apex_prefetch.h"
+
+/*
+ * Time travel over periodic snapshots. A snapshot is taken at the start of every interval cycles and
+ * holds a full copy of the cpu, its cache hierarchy and prefetchers; data memory pages are shared with
+ * the running cpu and copied on write. Going back restores the nearest older snapshot and simulates
+ * forward to the cycle asked for, the simulation being deterministic.
+ */
+
+/* State of a cpu at the start of a cycle, a slot of the pool */
+typedef struct Snapshot {
+  APEX_CPU cpu;                                 /* Pointers into the arena are kept as they were */
+  APEX_Hierarchy hierarchy;
+  Cache_Line *lines[LEVEL_COUNT];               /* Lines of each level of the hierarchy, in the slot */
+  APEX_Prefetcher prefetcher[2];                /* Data and instruction prefetchers, if any */
+  void *prefetch_state[2];                      /* In the slot, large enough for any prefetcher */
+  Memory_Image memory;
+} Snapshot;
+
+/*
+ * Every slot and the copies it holds are allocated when snapshots are turned on, so taking and
+ * dropping snapshots inside a run never goes to the heap. The tables of the memory images are
+ * recycled by the data memory.
+ */
+typedef struct APEX_Snapshots {
+  void *pool;                                   /* SNAPSHOT_POOL slots of slot_size bytes */
+  size_t slot_size;
+  Snapshot *unused[SNAPSHOT_POOL];
+  int unused_count;
+  Snapshot *slots[SNAPSHOT_COUNT];              /* Oldest first */
+  int count;
+  int base_interval;                            /* Interval set by the host */
+  int interval;                                 /* Doubles every time the slots run out */
+  int next_cycle;                               /* Clock of the next periodic snapshot, INT_MAX while paused */
+} APEX_Snapshots;
+
+bool snapshots_enable(APEX_CPU *cpu, int interval);
+void snapshots_destroy(APEX_CPU *cpu);
+void snapshots_reset(APEX_CPU *cpu);
+void snapshot_periodic(APEX_CPU *cpu);
+bool time_travel_goto(APEX_CPU *cpu, int cycle);
+int time_travel_reverse_until(APEX_CPU *cpu, const Stop_Condition *condition);
+
+#endif
@@ -0,0 +1,344 @@
+#include "apex_system.h"
+
+typedef struct Core_Thread {
+  APEX_System *system;
+  APEX_CPU *cpu;
+  int count;
+  pthread_barrier_t *barrier;
+} Core_Thread;
+
+/**
+ * Method to broadcast a bus transaction to every L1 except the requester's
+ *
+ * @param system pointer to current instance of system
+ * @param core_id - requesting core
+ * @param line_address - line being requested
+ * @param is_write - true for BusRdX/BusUpgr (invalidate), false for BusRd (downgrade)
+ * @param supplied - set if a remote L1 held the line MODIFIED and supplies it over the bus
+ * @return true if another core still holds a copy of the line
+ */
+static bool snoop(APEX_System *system, int core_id, int line_address, bool is_write, bool *supplied) {
+  bool shared = false;
+
+  for (int i = 0; i < system->num_cores; i++) {
+    if (i == core_id) continue;
+
+    Cache_Line *line = cache_find(&system->l1[i], line_address);
+    if (!line) continue;
+
+    if (line->state == LINE_MODIFIED) {
+      system->l1[i].writebacks++;
+      *supplied = true;
+    }
+
+    if (is_write) {
+      line->state = LINE_INVALID;
+      system->invalidations++;
+    } else {
+      if (line->state == LINE_MODIFIED || line->state == LINE_EXCLUSIVE) {
+        line->state = LINE_SHARED;
+        system->interventions++;
+      }
+      shared = true;
+    }
+  }
+  return shared;
+}
+
+/*
+ * Cycles until a missing line is in the L1 after its BusRd/BusRdX, the line comes from the remote L1
+ * that held it MODIFIED or else from the shared L2
+ */
+static int fill_latency(APEX_System *system, int line_address, bool supplied, int clock) {
+  if (supplied) {
+    system->transfers++;
+    return BUS_LATENCY + BUS_LATENCY;
+  }
+  return BUS_LATENCY + hierarchy_access(system->hierarchy, LEVEL_L2, line_address, false, clock + BUS_LATENCY);
+}
+
+/**
+ * Method to run the bus transaction of a data access of M2 through the L1 of the given core and time
+ * it. A hit takes L1_LATENCY cycles, a write to a SHARED line waits for its BusUpgr and a miss for its
+ * BusRd/BusRdX and the fill of the line.
+ *
+ * @param system pointer to current instance of system
+ * @param core_id - core issuing the access
+ * @param address - data memory address
+ * @param is_write - store, the line ends up MODIFIED
+ * @param clock - cycle of the core the access starts in
+ * @return cycles the access keeps M2 busy
+ */
+int APEX_system_access(APEX_System *system, int core_id, int address, bool is_write, int clock) {
+  APEX_Cache *l1 = &system->l1[core_id];
+  int line_address = cache_line_address(address);
+  int latency = L1_LATENCY;
+  bool supplied = false;
+
+  if (system->threaded) pthread_mutex_lock(&system->bus_lock);
+
+  Cache_Line *line = cache_find(l1, line_address);
+  if (line) {
+    cache_hit(l1, line, clock);
+
+    /* The fill of a prefetch may still be on its way */
+    if (line->ready > clock + latency) latency = line->ready - clock;
+    if (is_write && line->state == LINE_SHARED) {
+      system->bus_upgrades++;
+      snoop(system, core_id, line_address, true, &supplied);
+      latency += BUS_LATENCY;
+    }
+  } else {
+    cache_miss(l1);
+    if (is_write) {
+      system->bus_read_exclusives++;
+    } else {
+      system->bus_reads++;
+    }
+    bool shared = snoop(system, core_id, line_address, is_write, &supplied);
+    latency += fill_latency(system, line_address, supplied, clock + latency);
+    line = cache_allocate(l1, line_address);
+    line->state = shared ? LINE_SHARED : LINE_EXCLUSIVE;
+  }
+  if (is_write) line->state = LINE_MODIFIED;
+
+  system->accesses++;
+  system->latency_total += latency;
+  if (latency > system->latency_max) system->latency_max = latency;
+
+  if (system->threaded) pthread_mutex_unlock(&system->bus_lock);
+  return latency;
+}
+
+/**
+ * Method to read a data memory location, the bus transaction has been made by APEX_system_access()
+ *
+ * @param system pointer to current instance of system
+ * @param address - data memory address
+ * @return value stored at the address
+ */
+int APEX_system_load(APEX_System *system, int address) {
+  int value;
+
+  if (system->threaded) pthread_mutex_lock(&system->bus_lock);
+  value = memory_read(system->data_memory, address);
+  if (system->threaded) pthread_mutex_unlock(&system->bus_lock);
+  return value;
+}
+
+/**
+ * Method to write a data memory location, the bus transaction has been made by APEX_system_access()
+ *
+ * @param system pointer to current instance of system
+ * @param address - data memory address
+ * @param value - value to be stored
+ */
+void APEX_system_store(APEX_System *system, int address, int value) {
+  if (system->threaded) pthread_mutex_lock(&system->bus_lock);
+  memory_write(system->data_memory, address, value);
+  if (system->threaded) pthread_mutex_unlock(&system->bus_lock);
+}
+
+/**
+ * Method to fill a line into the L1 of the given core ahead of a demand access, a prefetch is a BusRd
+ * like a read miss
+ *
+ * @param system pointer to current instance of system
+ * @param core_id - core issuing the prefetch
+ * @param line_address - line to be prefetched
+ * @param clock - cycle of the request
+ * @return false if the line is already present
+ */
+bool APEX_system_prefetch(APEX_System *system, int core_id, int line_address, int clock) {
+  APEX_Cache *l1 = &system->l1[core_id];
+  bool supplied = false;
+  bool filled = false;
+
+  if (system->threaded) pthread_mutex_lock(&system->bus_lock);
+
+  if (!cache_find(l1, line_address)) {
+    system->bus_reads++;
+    bool shared = snoop(system, core_id, line_address, false, &supplied);
+    int latency = fill_latency(system, line_address, supplied, clock);
+    cache_prefetch_fill(l1, line_address, shared ? LINE_SHARED : LINE_EXCLUSIVE, clock + latency);
+    filled = true;
+  }
+
+  if (system->threaded) pthread_mutex_unlock(&system->bus_lock);
+  return filled;
+}
+
+/*
+ * This function creates one APEX cpu per input file and connects all of them to a shared data memory.
+ */
+APEX_System *
+APEX_system_init(int num_cores, const char **filenames) {
+  APEX_Arena *arena;
+  APEX_System *system;
+
+  if (num_cores < 1 || num_cores > MAX_CORES) {
+    fprintf(stderr, "APEX_Error: Number of cores must be between 1 and %d\n", MAX_CORES);
+    return NULL;
+  }
+
+  arena = arena_create(ARENA_RESERVE);
+  if (!arena) {
+    return NULL;
+  }
+  system = arena_calloc(arena, 1, sizeof(APEX_System));
+  if (!system) {
+    arena_destroy(arena);
+    return NULL;
+  }
+  system->arena = arena;
+
+  system->data_memory = memory_create(arena);
+  system->hierarchy = hierarchy_create(arena);
+  if (!system->data_memory || !system->hierarchy) {
+    arena_destroy(arena);
+    return NULL;
+  }
+  system->quantum = DEFAULT_QUANTUM;
+  pthread_mutex_init(&system->bus_lock, NULL);
+
+  for (int i = 0; i < num_cores; i++) {
+    system->cores[i] = APEX_cpu_init(filenames[i]);
+    if (!system->cores[i]) {
+      APEX_system_stop(system);
+      return NULL;
+    }
+    system->num_cores++;
+
+    if (!cache_init(&system->l1[i], arena, L1_SETS, L1_WAYS)) {
+      APEX_system_stop(system);
+      return NULL;
+    }
+
+    /* Replace the private data memory with the shared one */
+    memory_destroy(system->cores[i]->data_memory);
+    system->cores[i]->data_memory = system->data_memory;
+    system->cores[i]->system = system;
+    system->cores[i]->core_id = i;
+    system->cores[i]->l1d = &system->l1[i];
+  }
+
+  fprintf(stderr, "APEX_System: Initialized %d cores sharing %d words of data memory\n", num_cores,
+          DATA_MEMORY_SIZE);
+  return system;
+}
+
+static void *run_core_thread(void *arg) {
+  Core_Thread *thread = arg;
+  int quantum = thread->system->quantum;
+
+  for (int done = 0; done < thread->count; done += quantum) {
+    int cycles = (thread->count - done < quantum) ? thread->count - done : quantum;
+    APEX_cpu_run(thread->cpu, cycles, false);
+
+    /* No core starts the next quantum until every core has finished this one */
+    pthread_barrier_wait(thread->barrier);
+  }
+  return NULL;
+}
+
+/* Blocks the shared arena has taken from the heap, the cores grow it under the bus lock */
+static int
+shared_heap_allocations(APEX_System *system) {
+  int blocks;
+
+  if (system->threaded) pthread_mutex_lock(&system->bus_lock);
+  blocks = system->arena->heap_allocations;
+  if (system->threaded) pthread_mutex_unlock(&system->bus_lock);
+  return blocks;
+}
+
+/*
+ * System simulation loop.
+ *
+ * By default cores are stepped one cycle at a time in core order, which makes bus ordering and
+ * therefore results deterministic. In threaded mode every core runs on its own host thread and the
+ * cores synchronize at the end of every quantum, so the order of bus transactions inside a quantum
+ * depends on host scheduling.
+ */
+void
+APEX_system_run(APEX_System *system, int count, bool print_contents) {
+  int cycles = (count > 0) ? count : 1;
+  int heap_allocations = shared_heap_allocations(system);
+
+  if (system->threaded && system->num_cores > 1) {
+    pthread_t threads[MAX_CORES];
+    Core_Thread args[MAX_CORES];
+    pthread_barrier_t barrier;
+
+    pthread_barrier_init(&barrier, NULL, system->num_cores);
+    for (int i = 0; i < system->num_cores; i++) {
+      args[i].system = system;
+      args[i].cpu = system->cores[i];
+      args[i].count = cycles;
+      args[i].barrier = &barrier;
+      pthread_create(&threads[i], NULL, run_core_thread, &args[i]);
+    }
+    for (int i = 0; i < system->num_cores; i++) {
+      pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+  } else {
+    for (int cycle = 0; cycle < cycles; cycle++) {
+      for (int i = 0; i < system->num_cores; i++) {
+        if (print_contents) {
+          printf("\n================ Core %d ================", i);
+        }
+        APEX_cpu_run(system->cores[i], 1, print_contents);
+      }
+    }
+  }
+  system->clock += cycles;
+  system->run_allocations += shared_heap_allocations(system) - heap_allocations;
+}
+
+/*
+ * This function deallocates all cores, caches and the shared data memory.
+ */
+void
+APEX_system_stop(APEX_System *system) {
+  for (int i = 0; i < system->num_cores; i++) {
+    APEX_cpu_stop(system->cores[i]);
+  }
+  pthread_mutex_destroy(&system->bus_lock);
+  memory_destroy(system->data_memory);
+  arena_destroy(system->arena);
+}
+
+/**
+ * Method to print bus traffic, the shared L2 and DRAM and L1 statistics of every core
+ *
+ * @param system pointer to current instance of system
+ */
+void print_coherence_stats(APEX_System *system) {
+  Cache_Level *l2 = &system->hierarchy->level[LEVEL_L2];
+  int l2_accesses = l2->cache.hits + l2->cache.misses;
+
+  printf("\n---------------------------------------------------------\n");
+  printf("|                 Coherence (MESI) State                |\n");
+  printf("---------------------------------------------------------\n");
+  printf("|   Cores  : %-3d   Cycles : %-8d Mode : %-12s|\n", system->num_cores, system->clock,
+         system->threaded ? "threaded" : "round-robin");
+  printf("|   BusRd  : %-7d BusRdX : %-7d BusUpgr : %-7d |\n", system->bus_reads,
+         system->bus_read_exclusives, system->bus_upgrades);
+  printf("|   Invalidations : %-7d  Interventions : %-7d    |\n", system->invalidations,
+         system->interventions);
+  printf("|   Run allocs : %-5d (shared memory)                 |\n", system->run_allocations);
+  printf("|   L1 to L1 : %-7d Data latency avg : %-6.1f max : %-5d|\n", system->transfers,
+         system->accesses ? (double) system->latency_total / system->accesses : 0.0, system->latency_max);
+  printf("|   Shared L2 accesses: %-8d hit rate: %6.1f%%        |\n", l2_accesses,
+         l2_accesses ? 100.0 * l2->cache.hits / l2_accesses : 0.0);
+  print_dram_stats(&system->hierarchy->dram, system->clock);
+  printf("---------------------------------------------------------\n");
+
+  for (int i = 0; i < system->num_cores; i++) {
+    char name[16];
+    sprintf(name, "L1[%d]", i);
+    print_cache_stats(&system->l1[i], name);
+  }
+  printf("---------------------------------------------------------\n");
+}
@@ -0,0 +1,47 @@
+#ifndef _APEX_SYSTEM_H_
+#define _APEX_SYSTEM_H_
+
+#include "apex_cpu.h"
+#include "apex_cache.h"
+#include "apex_memory.h"
+#include "apex_hierarchy.h"
+#include <pthread.h>
+
+/* Model of several APEX cores sharing one data memory over a snooping bus */
+typedef struct APEX_System {
+  APEX_Arena *arena;                            /* Holds the system, its L1s and the shared data memory */
+  int num_cores;
+  APEX_CPU *cores[MAX_CORES];
+  APEX_Cache l1[MAX_CORES];                     /* Private L1 data cache of each core (MESI) */
+  APEX_Memory *data_memory;                     /* Data Memory shared by all cores */
+  APEX_Hierarchy *hierarchy;                    /* Shared L2 and DRAM behind the bus, its L1 levels are unused */
+  int clock;                                    /* System cycles elapsed */
+  int threaded;                                 /* Step each core on its own host thread */
+  int run_allocations;                          /* Blocks the shared arena took from the heap inside runs */
+  int quantum;                                  /* Max cycles a core may run ahead of the others when threaded */
+  pthread_mutex_t bus_lock;                     /* Serializes bus transactions of threaded cores */
+
+  /* Bus traffic */
+  int bus_reads;                                /* BusRd: read miss */
+  int bus_read_exclusives;                      /* BusRdX: write miss */
+  int bus_upgrades;                             /* BusUpgr: write hit on a SHARED line */
+  int invalidations;                            /* Remote copies invalidated */
+  int interventions;                            /* Remote MODIFIED/EXCLUSIVE copies downgraded to SHARED */
+  int transfers;                                /* Misses supplied by the remote L1 holding the line MODIFIED */
+
+  /* Data accesses of M2 */
+  int accesses;
+  long latency_total;
+  int latency_max;
+} APEX_System;
+
+APEX_System *APEX_system_init(int num_cores, const char **filenames);
+void APEX_system_run(APEX_System *system, int count, bool print_contents);
+void APEX_system_stop(APEX_System *system);
+int APEX_system_access(APEX_System *system, int core_id, int address, bool is_write, int clock);
+int APEX_system_load(APEX_System *system, int address);
+void APEX_system_store(APEX_System *system, int address, int value);
+bool APEX_system_prefetch(APEX_System *system, int core_id, int line_address, int clock);
+void print_coherence_stats(APEX_System *system);
+
+#endif
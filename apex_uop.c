@@ -0,0 +1,66 @@
+#include "apex_cpu.h"
+#include "apex_uop.h"
+
+const Opcode_Info opcode_info[NUM_OPCODES] = {
+    [OPCODE_ADD] = {"ADD", OPERAND_RD | OPERAND_RS1 | OPERAND_RS2, FU_INTU},
+    [OPCODE_SUB] = {"SUB", OPERAND_RD | OPERAND_RS1 | OPERAND_RS2 | OPERAND_FLAG_OUT, FU_INTU},
+    [OPCODE_MUL] = {"MUL", OPERAND_RD | OPERAND_RS1 | OPERAND_RS2, FU_MULU},
+    [OPCODE_DIV] = {"DIV", 0, FU_INTU},
+    [OPCODE_AND] = {"AND", OPERAND_RD | OPERAND_RS1 | OPERAND_RS2, FU_INTU},
+    [OPCODE_OR] = {"OR", OPERAND_RD | OPERAND_RS1 | OPERAND_RS2, FU_INTU},
+    [OPCODE_EXOR] = {"EXOR", OPERAND_RD | OPERAND_RS1 | OPERAND_RS2, FU_INTU},
+    [OPCODE_MOVC] = {"MOVC", OPERAND_RD | OPERAND_IMM, FU_INTU},
+    [OPCODE_LOAD] = {"LOAD", OPERAND_RD | OPERAND_RS1 | OPERAND_IMM, FU_MEM},
+    [OPCODE_STORE] = {"STORE", OPERAND_RS1 | OPERAND_RS2 | OPERAND_IMM, FU_MEM},
+    [OPCODE_BZ] = {"BZ", OPERAND_IMM | OPERAND_FLAG_IN, FU_INTU},
+    [OPCODE_BNZ] = {"BNZ", OPERAND_IMM | OPERAND_FLAG_IN, FU_INTU},
+    [OPCODE_HALT] = {"HALT", 0, FU_NONE},
+    [OPCODE_ADDL] = {"ADDL", OPERAND_RD | OPERAND_RS1 | OPERAND_IMM, FU_INTU},
+    [OPCODE_SUBL] = {"SUBL", OPERAND_RD | OPERAND_RS1 | OPERAND_IMM | OPERAND_FLAG_OUT, FU_INTU},
+    [OPCODE_LDR] = {"LDR", OPERAND_RD | OPERAND_RS1 | OPERAND_RS2, FU_MEM},
+    [OPCODE_STR] = {"STR", OPERAND_RS1 | OPERAND_RS2 | OPERAND_RS3, FU_MEM},
+    [OPCODE_CMP] = {"CMP", OPERAND_RS1 | OPERAND_RS2 | OPERAND_FLAG_OUT, FU_INTU},
+    [OPCODE_NOP] = {"NOP", 0, FU_NONE},
+    [OPCODE_JUMP] = {"JUMP", OPERAND_RS1 | OPERAND_IMM, FU_JBU},
+    [OPCODE_JAL] = {"JAL", OPERAND_RD | OPERAND_RS1 | OPERAND_IMM, FU_JBU},
+};
+
+/* Fetched from any pc outside of code memory, stops the front end like the HALT of a program */
+const APEX_Uop halt_uop = {OPCODE_HALT, 0, FU_NONE, -1, -1, -1, -1, 0};
+
+/**
+ * Method to decode one instruction of code memory into a micro-op
+ *
+ * @param uop - micro-op to be filled in
+ * @param ins - parsed instruction
+ */
+static void decode_uop(APEX_Uop *uop, const APEX_Instruction *ins) {
+  const Opcode_Info *info = &opcode_info[ins->opcode];
+
+  uop->opcode = ins->opcode;
+  uop->operands = info->operands;
+  uop->function_unit = info->function_unit;
+  uop->rd = (info->operands & OPERAND_RD) ? ins->rd : -1;
+  uop->rs1 = (info->operands & OPERAND_RS1) ? ins->rs1 : -1;
+  uop->rs2 = (info->operands & OPERAND_RS2) ? ins->rs2 : -1;
+  uop->rs3 = (info->operands & OPERAND_RS3) ? ins->rs3 : -1;
+  uop->imm = (info->operands & OPERAND_IMM) ? ins->imm : 0;
+}
+
+/*
+ * This function converts code memory into micro-ops allocated from the arena of the cpu, fetch reads
+ * them instead of the parsed instructions so that no stage has to look at the instruction format again.
+ */
+APEX_Uop *
+create_uop_cache(APEX_Arena *arena, const APEX_Instruction *code_memory, int code_memory_size) {
+  APEX_Uop *uops = arena_calloc(arena, code_memory_size > 0 ? code_memory_size : 1, sizeof(APEX_Uop));
+
+  if (!uops) {
+    return NULL;
+  }
+
+  for (int i = 0; i < code_memory_size; i++) {
+    decode_uop(&uops[i], &code_memory[i]);
+  }
+  return uops;
+}
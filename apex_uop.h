@@ -0,0 +1,47 @@
+#ifndef _APEX_UOP_H_
+#define _APEX_UOP_H_
+
+#include "apex_macros.h"
+
+/* Operand classes of an instruction, bits of operands */
+#define OPERAND_RD 0x1
+#define OPERAND_RS1 0x2
+#define OPERAND_RS2 0x4
+#define OPERAND_RS3 0x8
+#define OPERAND_IMM 0x10
+#define OPERAND_FLAG_IN 0x20                    /* Reads the zero flag (BZ, BNZ) */
+#define OPERAND_FLAG_OUT 0x40                   /* Sets the zero flag (SUB, SUBL, CMP) */
+#define OPERAND_SOURCES (OPERAND_RS1 | OPERAND_RS2 | OPERAND_RS3 | OPERAND_FLAG_IN)
+
+/* Function unit an instruction is dispatched to */
+#define FU_NONE 0x0                             /* Nothing to execute, ready to retire at dispatch */
+#define FU_INTU 0x1
+#define FU_MULU 0x2
+#define FU_JBU 0x3
+#define FU_MEM 0x4                              /* Waits in the ROB for M1 instead of the issue queue */
+
+#define NUM_OPCODES (OPCODE_JAL + 1)
+
+/* Properties shared by every instruction with the same opcode */
+typedef struct Opcode_Info {
+  const char *name;
+  unsigned char operands;                       /* OPERAND_* bits */
+  unsigned char function_unit;                  /* FU_* */
+} Opcode_Info;
+
+/* Instruction of code memory decoded once when the cpu is created, unused registers are -1 */
+typedef struct APEX_Uop {
+  unsigned char opcode;
+  unsigned char operands;
+  unsigned char function_unit;
+  signed char rd;
+  signed char rs1;
+  signed char rs2;
+  signed char rs3;
+  int imm;
+} APEX_Uop;
+
+extern const Opcode_Info opcode_info[NUM_OPCODES];
+extern const APEX_Uop halt_uop;
+
+#endif
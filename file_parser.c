@@ -239,13 +239,10 @@ create_APEX_instruction(APEX_Instruction *ins, char *buffer) {
 }
 
 /*
- * This function is related to parsing input file
- *
- * Note : You are not supposed to edit this function
+ * This function parses one instruction per line of an input stream, the stream must be seekable
  */
 APEX_Instruction *
-create_code_memory(const char *filename, int *size) {
-  FILE *fp;
+create_code_memory_from_stream(FILE *fp, int *size) {
   ssize_t nread;
   size_t len = 0;
   char *line = NULL;
@@ -253,37 +250,51 @@ create_code_memory(const char *filename, int *size) {
   int current_instruction = 0;
   APEX_Instruction *code_memory;
 
-  if (!filename) {
-    return NULL;
-  }
-
-  fp = fopen(filename, "r");
-  if (!fp) {
-    return NULL;
-  }
-
   while ((nread = getline(&line, &len, fp)) != -1) {
     code_memory_size++;
   }
   *size = code_memory_size;
   if (!code_memory_size) {
-    fclose(fp);
+    free(line);
     return NULL;
   }
 
   code_memory = calloc(code_memory_size, sizeof(APEX_Instruction));
   if (!code_memory) {
-    fclose(fp);
+    free(line);
     return NULL;
   }
 
   rewind(fp);
-  while ((nread = getline(&line, &len, fp)) != -1) {
+  while ((nread = getline(&line, &len, fp)) != -1 && current_instruction < code_memory_size) {
     create_APEX_instruction(&code_memory[current_instruction], line);
     current_instruction++;
   }
 
   free(line);
+  return code_memory;
+}
+
+/*
+ * This function is related to parsing input file
+ *
+ * Note : You are not supposed to edit this function
+ */
+APEX_Instruction *
+create_code_memory(const char *filename, int *size) {
+  FILE *fp;
+  APEX_Instruction *code_memory;
+
+  if (!filename) {
+    return NULL;
+  }
+
+  fp = fopen(filename, "r");
+  if (!fp) {
+    return NULL;
+  }
+
+  code_memory = create_code_memory_from_stream(fp, size);
   fclose(fp);
   return code_memory;
 }
@@ -1,15 +1,56 @@
 #include "apex_cpu.h"
+#include "apex_system.h"
+#include "apex_batch.h"
+#include "apex_memory.h"
+#include "apex_func.h"
+#include "apex_jit.h"
+#include "apex_replay.h"
+#include "apex_snapshot.h"
+#include "apex_hierarchy.h"
+#include <time.h>
+
+/* Command line options */
+typedef struct Sim_Options {
+  int num_files;                                /* One input file per core, or program and data images */
+  const char **filenames;
+  int threaded;                                 /* Step cores on separate host threads */
+  int quantum;                                  /* Cycles between core synchronizations when threaded */
+  int batch_threads;                            /* Run program against each data image, 0 for interactive */
+  int functional;                               /* Run program to HALT on the functional model only */
+  int max_cycles;                               /* Cycle limit of each batch run */
+  const char *mem_in;                           /* Data memory image loaded at init */
+  const char *mem_out;                          /* Data memory dump written at exit (suffix in batch mode) */
+  int mem_start;                                /* Dumped data memory range [mem_start, mem_end), */
+  int mem_end;                                  /* -1 for up to the highest page holding data */
+  int num_settings;                             /* cpu parameters given as <name>=<value> */
+  const char **settings;
+  const char *record;                           /* Replay log written from init on */
+  const char *replay;                           /* Replay log the run is checked against */
+  int replay_interval;                          /* Cycles between state hashes of a recording */
+} Sim_Options;
 
 // forward declarations
-void generate_prompt(APEX_CPU *cpu, const char *filename);
+void generate_prompt(APEX_CPU *cpu, Sim_Options *options);
+void parse_options(int argc, char const *argv[], Sim_Options *options);
+int run_functional(Sim_Options *options);
 void clear_buffer();
+void set_breakpoint(APEX_CPU *cpu, const char *condition);
+bool read_condition(const char *condition, Stop_Condition *stop);
 
 int main(int argc, char const *argv[]) {
   APEX_CPU *cpu = NULL;
+  Sim_Options options;
 
-  if (argc < 2) {
-    fprintf(stderr, "APEX_Help: Usage %s <input_file>\n", argv[0]);
-    exit(1);
+  parse_options(argc, argv, &options);
+
+  if (options.batch_threads > 0) {
+    return APEX_batch_run(options.filenames[0], options.num_files - 1, &options.filenames[1],
+                          options.batch_threads, options.max_cycles, options.mem_out, options.mem_start,
+                          options.mem_end, options.num_settings, options.settings) ? 1 : 0;
+  }
+
+  if (options.functional) {
+    return run_functional(&options);
   }
 
   printf("\n-----------------------------------------------------------------------------------------------");
@@ -18,21 +59,161 @@ int main(int argc, char const *argv[]) {
   printf("\n  commands: [init | initialize] [s|Simulate <count>] [d|Display] [showmem <address>] [n] \n");
   printf("-----------------------------------------------------------------------------------------------\n");
 
-  generate_prompt(cpu, argv[1]);
+  generate_prompt(cpu, &options);
 
   if (cpu != NULL) APEX_cpu_stop(cpu);
   return 0;
 }
 
+/**
+ * Method to parse command line, options are followed by one input file per core,
+ * or in batch mode by the input file and the data memory images to run it against
+ *
+ * @param argc - number of arguments
+ * @param argv - arguments
+ * @param options - parsed options
+ */
+void parse_options(int argc, char const *argv[], Sim_Options *options) {
+  bool valid = true;
+
+  options->num_files = 0;
+  options->filenames = calloc(argc, sizeof(char *));
+  options->threaded = FALSE;
+  options->quantum = DEFAULT_QUANTUM;
+  options->batch_threads = 0;
+  options->functional = FALSE;
+  options->max_cycles = DEFAULT_MAX_CYCLES;
+  options->mem_in = NULL;
+  options->mem_out = NULL;
+  options->mem_start = 0;
+  options->mem_end = -1;
+  options->num_settings = 0;
+  options->settings = calloc(argc, sizeof(char *));
+  options->record = NULL;
+  options->replay = NULL;
+  options->replay_interval = REPLAY_INTERVAL;
+
+  for (int i = 1; i < argc && valid; i++) {
+    if (strcmp(argv[i], "--threads") == 0) {
+      options->threaded = TRUE;
+    } else if (strcmp(argv[i], "--quantum") == 0 && i + 1 < argc) {
+      options->quantum = atoi(argv[++i]);
+      valid = options->quantum > 0;
+    } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+      options->batch_threads = atoi(argv[++i]);
+      valid = options->batch_threads > 0;
+    } else if (strcmp(argv[i], "--functional") == 0) {
+      options->functional = TRUE;
+    } else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc) {
+      options->max_cycles = atoi(argv[++i]);
+      valid = options->max_cycles > 0;
+    } else if (strcmp(argv[i], "--mem-in") == 0 && i + 1 < argc) {
+      options->mem_in = argv[++i];
+    } else if (strcmp(argv[i], "--mem-out") == 0 && i + 1 < argc) {
+      options->mem_out = argv[++i];
+    } else if (strcmp(argv[i], "--mem-range") == 0 && i + 1 < argc) {
+      valid = parse_memory_range(argv[++i], &options->mem_start, &options->mem_end);
+    } else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc) {
+      options->settings[options->num_settings++] = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      options->record = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      options->replay = argv[++i];
+    } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+      options->replay_interval = atoi(argv[++i]);
+      valid = options->replay_interval > 0;
+    } else if (argv[i][0] == '-') {
+      valid = false;
+    } else {
+      options->filenames[options->num_files++] = argv[i];
+    }
+  }
+
+  if (options->batch_threads > 0) {
+    valid = valid && options->num_files >= 2;
+  } else if (options->functional) {
+    valid = valid && options->num_files == 1;
+  } else {
+    valid = valid && options->num_files >= 1 && options->num_files <= MAX_CORES;
+  }
+  valid = valid && !(options->record && options->replay);
+  valid = valid && (options->num_files == 1 || (!options->record && !options->replay));
+
+  if (!valid) {
+    fprintf(stderr, "APEX_Help: Usage %s [--threads] [--quantum <cycles>] <input_file> [<input_file> ...]\n"
+                    "           one input file per core, at most %d cores\n"
+                    "       %s --batch <threads> [--max-cycles <cycles>] <input_file> <data_image> ...\n"
+                    "           run input file once per data memory image on a pool of threads\n"
+                    "       %s --functional <input_file>\n"
+                    "           run input file to HALT on the functional model and print the final state\n"
+                    "  memory:  [--mem-in <image>] [--mem-out <file>] [--mem-range <start>:<end>]\n"
+                    "           preload data memory at init, dump it at exit (.bin raw words, else hex text);\n"
+                    "           in batch mode --mem-out is a suffix appended to each data image name\n"
+                    "  cpu:     [--set <name>=<value>] ...\n"
+                    "           change a cpu parameter of every core, e.g. --set commit_width=2\n"
+                    "  replay:  [--record <log> [--interval <cycles>] | --replay <log>]\n"
+                    "           with one core, log the run from init to q or check it against a log\n",
+            argv[0], MAX_CORES, argv[0], argv[0]);
+    exit(1);
+  }
+}
+
+/**
+ * Method to run the input file to HALT on the functional model, without any timing, and print the
+ * architectural registers. Data memory is loaded and dumped as in the interactive mode.
+ *
+ * @param options - command line options
+ * @return 0 if the program halted
+ */
+int run_functional(Sim_Options *options) {
+  struct timespec start, end;
+  APEX_CPU *cpu;
+  double seconds;
+  long executed;
+  int halted;
+
+  cpu = APEX_cpu_init(options->filenames[0]);
+  if (!cpu) {
+    fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
+    return 1;
+  }
+  if ((options->mem_in != NULL && !load_data_memory(cpu->data_memory, options->mem_in)) ||
+      !APEX_cpu_apply_settings(cpu, options->num_settings, options->settings)) {
+    APEX_cpu_stop(cpu);
+    return 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  executed = APEX_cpu_fast_forward(cpu, LONG_MAX);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+  printf("APEX_Func: %ld instructions in %.3f s (%.1f MIPS)\n", executed, seconds,
+         (seconds > 0) ? executed / seconds / 1e6 : 0.0);
+  print_jit_stats(cpu);
+  print_arf(cpu);
+
+  if (options->mem_out != NULL) {
+    dump_data_memory(cpu->data_memory, options->mem_out, options->mem_start, options->mem_end);
+  }
+  halted = cpu->halted;
+  APEX_cpu_stop(cpu);
+  return halted ? 0 : 1;
+}
+
 /**
  * Method to return user prompt, parse user input and call appropriate methods in apex_cpu.c & apex_cpu_b.c
  *
  * @param cpu pointer to the current instance of cpu
- * @param filename name of the input file
+ * @param options - command line options
  */
-void generate_prompt(APEX_CPU *cpu, const char *filename) {
+void generate_prompt(APEX_CPU *cpu, Sim_Options *options) {
+  APEX_System *system = NULL;
   char user_prompt_val[50];
-  int count, address;
+  char mode[50];
+  char filename[256];
+  char name[64];
+  int count, address, core, value;
 
   while (TRUE) {
     printf("\nAPEX:> ");
@@ -40,38 +221,204 @@ void generate_prompt(APEX_CPU *cpu, const char *filename) {
 
     if (strcmp(user_prompt_val, "Q") == 0 || strcmp(user_prompt_val, "q") == 0) {
       printf("APEX_CPU: Simulation Stopped\n");
-      if (cpu != NULL) APEX_cpu_stop(cpu);
+      if (cpu != NULL && options->mem_out != NULL) {
+        dump_data_memory(cpu->data_memory, options->mem_out, options->mem_start, options->mem_end);
+      }
+      if (cpu != NULL && options->replay != NULL && cpu->replay != NULL) {
+        printf("APEX_Replay: Run %s %s\n", replay_close(cpu) ? "matches" : "diverged from", options->replay);
+      }
+      if (system != NULL) APEX_system_stop(system);
+      else if (cpu != NULL) APEX_cpu_stop(cpu);
       break;
     } else if (strcmp(user_prompt_val, "initialize") == 0 || strcmp(user_prompt_val, "init") == 0) {
-      cpu = APEX_cpu_init(filename);
-      if (!cpu) {
-        fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
+      if (options->num_files > 1) {
+        system = APEX_system_init(options->num_files, options->filenames);
+        if (!system) {
+          fprintf(stderr, "APEX_Error: Unable to initialize System\n");
+          exit(1);
+        }
+        system->threaded = options->threaded;
+        system->quantum = options->quantum;
+        for (int i = 0; i < system->num_cores; i++) {
+          if (!APEX_cpu_apply_settings(system->cores[i], options->num_settings, options->settings)) exit(1);
+        }
+        cpu = system->cores[0];
+      } else {
+        cpu = APEX_cpu_init(options->filenames[0]);
+        if (!cpu) {
+          fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
+          exit(1);
+        }
+        /* Time travel is on by default, settings given on the command line may turn it off */
+        APEX_cpu_set(cpu, "snapshots", SNAPSHOT_INTERVAL);
+        if (!APEX_cpu_apply_settings(cpu, options->num_settings, options->settings)) exit(1);
+      }
+      /* Cores of a system share one data memory, loading through any of them is enough */
+      if (options->mem_in != NULL && !load_data_memory(cpu->data_memory, options->mem_in)) {
+        exit(1);
+      }
+      if (cpu->snapshots) snapshots_reset(cpu);
+      if ((options->record != NULL && !replay_open(cpu, options->record, false, options->replay_interval)) ||
+          (options->replay != NULL && !replay_open(cpu, options->replay, true, 0))) {
         exit(1);
       }
     } else if (strcmp(user_prompt_val, "n") == 0 || strcmp(user_prompt_val, "next") == 0) {
-      APEX_cpu_run(cpu, 0, true);
+      if (!cpu) printf("APEX_CPU: Not initialized, run init first\n");
+      else if (system != NULL) APEX_system_run(system, 0, true);
+      else APEX_cpu_run(cpu, 0, true);
     } else {
 
       if (strcmp(user_prompt_val, "display") == 0 || strcmp(user_prompt_val, "Display") == 0) {
-        display(cpu);
+        if (!cpu) printf("APEX_CPU: Not initialized, run init first\n");
+        else display(cpu);
         clear_buffer();
 
       } else if (strcmp(user_prompt_val, "print_rob") == 0 || strcmp(user_prompt_val, "PrintROB") == 0) {
-        print_reorder_buffer(cpu);
+        if (!cpu) printf("APEX_CPU: Not initialized, run init first\n");
+        else print_reorder_buffer(cpu);
         clear_buffer();
 
       } else if (strcmp(user_prompt_val, "print_iq") == 0 || strcmp(user_prompt_val, "PrintIQ") == 0) {
-        print_issue_queue(cpu);
+        if (!cpu) printf("APEX_CPU: Not initialized, run init first\n");
+        else print_issue_queue(cpu);
         clear_buffer();
 
       } else if (strcmp(user_prompt_val, "simulate") == 0 || strcmp(user_prompt_val, "Simulate") == 0) {
         scanf("%d", &count);
-        APEX_cpu_run(cpu, count, true);
+        if (!cpu) printf("APEX_CPU: Not initialized, run init first\n");
+        else if (system != NULL) APEX_system_run(system, count, true);
+        else APEX_cpu_run(cpu, count, true);
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "fastforward") == 0 || strcmp(user_prompt_val, "ff") == 0) {
+        scanf("%d", &count);
+        if (!cpu) {
+          printf("APEX_CPU: Not initialized, run init first\n");
+        } else if (system != NULL) {
+          printf("Fast forward is only available with one core\n");
+        } else {
+          printf("APEX_Func: %ld instructions executed\n", APEX_cpu_fast_forward(cpu, count));
+        }
         clear_buffer();
 
       } else if (strcmp(user_prompt_val, "showmem") == 0 || strcmp(user_prompt_val, "ShowMem") == 0) {
         scanf("%d", &address);
-        show_mem(cpu, address);
+        if (!cpu) printf("APEX_CPU: Not initialized, run init first\n");
+        else show_mem(cpu, address);
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "dumpmem") == 0 || strcmp(user_prompt_val, "DumpMem") == 0) {
+        scanf("%255s", filename);
+        if (!cpu) {
+          printf("APEX_CPU: Not initialized, run init first\n");
+        } else if (dump_data_memory(cpu->data_memory, filename, options->mem_start, options->mem_end)) {
+          printf("APEX_CPU: Data memory written to %s\n", filename);
+        }
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "mode") == 0 || strcmp(user_prompt_val, "Mode") == 0) {
+        scanf("%49s", mode);
+        if (!cpu) {
+          printf("APEX_CPU: Not initialized, run init first\n");
+        } else if (strcmp(mode, "event") == 0 || strcmp(mode, "tick") == 0) {
+          if (system != NULL) {
+            for (int i = 0; i < system->num_cores; i++) {
+              system->cores[i]->event_driven = (strcmp(mode, "event") == 0);
+            }
+          } else {
+            cpu->event_driven = (strcmp(mode, "event") == 0);
+          }
+        } else {
+          printf("Invalid Mode: [ %s ] expected [tick | event]\n", mode);
+        }
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "core") == 0 || strcmp(user_prompt_val, "Core") == 0) {
+        scanf("%d", &core);
+        if (system != NULL && core >= 0 && core < system->num_cores) {
+          cpu = system->cores[core];
+          printf("APEX_System: Core %d selected\n", core);
+        } else {
+          printf("Invalid Core: [ %d ]\n", core);
+        }
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "set") == 0 || strcmp(user_prompt_val, "Set") == 0) {
+        scanf("%63s %d", name, &value);
+        if (!cpu) {
+          printf("APEX_CPU: Not initialized, run init first\n");
+        } else if (system != NULL) {
+          for (int i = 0; i < system->num_cores; i++) {
+            APEX_cpu_set(system->cores[i], name, value);
+          }
+        } else {
+          APEX_cpu_set(cpu, name, value);
+        }
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "break") == 0 || strcmp(user_prompt_val, "Break") == 0) {
+        scanf("%49s", mode);
+        if (!cpu) {
+          printf("APEX_CPU: Not initialized, run init first\n");
+        } else if (system != NULL) {
+          printf("Breakpoints are only available with one core\n");
+        } else {
+          set_breakpoint(cpu, mode);
+        }
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "back") == 0 || strcmp(user_prompt_val, "Back") == 0) {
+        scanf("%d", &count);
+        if (!cpu) {
+          printf("APEX_CPU: Not initialized, run init first\n");
+        } else if (system != NULL) {
+          printf("Time travel is only available with one core\n");
+        } else if (time_travel_goto(cpu, cpu->clock - count)) {
+          printf("APEX_CPU: Back at cycle %d, instructions retired = %d\n", cpu->clock, cpu->insn_completed);
+        }
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "goto") == 0 || strcmp(user_prompt_val, "Goto") == 0) {
+        scanf("%d", &count);
+        if (!cpu) {
+          printf("APEX_CPU: Not initialized, run init first\n");
+        } else if (system != NULL) {
+          printf("Time travel is only available with one core\n");
+        } else if (time_travel_goto(cpu, count)) {
+          printf("APEX_CPU: At cycle %d, instructions retired = %d\n", cpu->clock, cpu->insn_completed);
+        }
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "reverse-until") == 0 || strcmp(user_prompt_val, "ReverseUntil") == 0) {
+        Stop_Condition condition = {0};
+
+        scanf("%49s", mode);
+        if (!cpu) {
+          printf("APEX_CPU: Not initialized, run init first\n");
+        } else if (system != NULL) {
+          printf("Time travel is only available with one core\n");
+        } else if (read_condition(mode, &condition)) {
+          count = time_travel_reverse_until(cpu, &condition);
+          if (count >= 0) {
+            printf("APEX_CPU: Condition hit in cycle %d, cycles = %d instructions retired = %d\n", count,
+                   cpu->clock, cpu->insn_completed);
+          } else {
+            printf("APEX_CPU: Condition not hit in the history, still at cycle %d\n", cpu->clock);
+          }
+        } else {
+          printf("Invalid Condition: [ %s ] expected [pc | write | reg | halt]\n", mode);
+        }
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "coherence") == 0 || strcmp(user_prompt_val, "Coherence") == 0) {
+        if (system != NULL) print_coherence_stats(system);
+        else printf("Coherence statistics are only available with more than one core\n");
+        clear_buffer();
+
+      } else if (strcmp(user_prompt_val, "caches") == 0 || strcmp(user_prompt_val, "Caches") == 0) {
+        if (!cpu) printf("APEX_CPU: Not initialized, run init first\n");
+        else if (system != NULL) printf("Cache hierarchy statistics are only available with one core\n");
+        else print_hierarchy_stats(cpu->hierarchy, cpu->clock);
         clear_buffer();
 
       } else {
@@ -85,14 +432,32 @@ void generate_prompt(APEX_CPU *cpu, const char *filename) {
                "   [s|Simulate <count>]    - to simulate <count> cycles\n"
                "   [d|Display]             - to display stage contents\n"
                "   [showmem <address>]     - to show contents in memory <address>\n"
+               "   [dumpmem <file>]        - to write data memory (--mem-range) to <file>\n"
                "   [PrintROB | print_rob]  - to print contents of ROB\n"
                "   [PrintIQ | print_iq]    - to print contents of Issue Queue\n"
+               "   [mode <tick|event>]     - to tick every cycle or skip idle cycles in bulk\n"
+               "   [core <id>]             - to select the core other commands act on\n"
+               "   [coherence]             - to print bus and L1 statistics of all cores\n"
+               "   [caches]                - to print cache, DRAM and load latency statistics\n"
+               "   [set <name> <value>]    - to change a cpu parameter, e.g. set commit_width 2\n"
+               "   [ff|fastforward <count>] - to execute <count> instructions on the functional model\n"
+               "   [break <condition>]     - to stop simulate once pc <pc>, instret <n>, cycle <n>,\n"
+               "                             write <address>, reg <r> <value> or halt is reached\n"
+               "   [break clear]           - to remove all breakpoints\n"
+               "   [back <n>]              - to go back <n> cycles\n"
+               "   [goto <cycle>]          - to go to the start of <cycle>, back or forward\n"
+               "   [reverse-until <condition>] - to go back to the last earlier cycle in which pc <pc>,\n"
+               "                             write <address>, reg <r> <value> or halt hit\n"
                "   [n|next]                - proceed by one cycle\n");
         printf("--------------------------------------------------------------------\n");
       }
     }
     if (cpu != NULL) {
-      if ((cpu->insn_completed == cpu->code_memory_size) &&
+      if (cpu->stop.hit && (strcmp(user_prompt_val, "simulate") == 0 || strcmp(user_prompt_val, "Simulate") == 0)) {
+        printf("\nAPEX_CPU: Breakpoint hit, cycles = %d instructions retired = %d\n", cpu->clock,
+               cpu->insn_completed);
+      }
+      if (cpu->halted &&
           ((strcmp(user_prompt_val, "simulate") == 0 || strcmp(user_prompt_val, "Simulate") == 0) ||
               strcmp(user_prompt_val, "n") == 0 || strcmp(user_prompt_val, "N") == 0)) {
         printf("\nAPEX_CPU: Simulation Complete, cycles = %d instructions retired = %d\n",
@@ -102,6 +467,47 @@ void generate_prompt(APEX_CPU *cpu, const char *filename) {
   }
 }
 
+/**
+ * Method to arm a run-until predicate of the cpu, simulate stops right after it hits. Each breakpoint
+ * fires once.
+ *
+ * @param cpu pointer to the current instance of cpu
+ * @param condition - kind of breakpoint, its operands are read from the prompt
+ */
+void set_breakpoint(APEX_CPU *cpu, const char *condition) {
+  if (strcmp(condition, "clear") == 0) {
+    cpu->stop.armed = 0;
+  } else if (!read_condition(condition, &cpu->stop)) {
+    printf("Invalid Breakpoint: [ %s ] expected [pc | instret | cycle | write | reg | halt | clear]\n", condition);
+  }
+}
+
+/**
+ * Method to read the operands of a run-until predicate from the prompt and arm it
+ *
+ * @param condition - kind of predicate
+ * @param stop - predicates it is added to
+ * @return false if the kind is unknown or its operands are missing
+ */
+bool read_condition(const char *condition, Stop_Condition *stop) {
+  if (strcmp(condition, "pc") == 0 && scanf("%d", &stop->pc) == 1) {
+    stop->armed |= STOP_AT_PC;
+  } else if (strcmp(condition, "instret") == 0 && scanf("%d", &stop->instret) == 1) {
+    stop->armed |= STOP_AT_INSTRET;
+  } else if (strcmp(condition, "cycle") == 0 && scanf("%d", &stop->cycle) == 1) {
+    stop->armed |= STOP_AT_CYCLE;
+  } else if (strcmp(condition, "write") == 0 && scanf("%d", &stop->address) == 1) {
+    stop->armed |= STOP_ON_WRITE;
+  } else if (strcmp(condition, "reg") == 0 && scanf("%d %d", &stop->reg, &stop->value) == 2) {
+    stop->armed |= STOP_ON_REGISTER;
+  } else if (strcmp(condition, "halt") == 0) {
+    stop->armed |= STOP_ON_HALT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 /**
  * Method to remove extraneous characters after necessary user input has been read by scanf()
  */